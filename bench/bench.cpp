@@ -0,0 +1,366 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Microbenchmarks of the hot paths, printed as JSON for tracking across
+// releases:
+//
+//   convert      bus <-> float and bus <-> RTP L16/L24, scalar and SIMD
+//   interleave   planar float -> bus, and back
+//   queue        MpscQueue push/pop throughput and latency, 1..4 producers
+//   driver       CPU the paced null driver spends per period outside the
+//                callback, alone and with the WAV recorder tapping it
+//
+// Cycles come from the CPU cycle counter (perf_event) when the kernel
+// allows it, else the TSC; "cycle_source" says which. Each kernel result
+// is the median of several timed repetitions.
+//
+// Build with TINYAUDIO_NULL_PACED=1.
+
+#include <algorithm>
+#include <atomic>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_record.h>
+#include "tinyaudio_kernels.h"
+#include "tinyaudio_queue.h"
+#include "tinyaudio_rtp_packet.h"
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_frames = 512; // per kernel call; everything stays in L1
+static const int c_calls = 4000; // per repetition
+static const int c_repetitions = 7;
+static const int c_queue_items = 200000;
+static const int c_driver_ms = 1500;
+
+static bool g_first = true;
+
+static uint64_t now_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t thread_cpu_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Cycle counter for the calling thread
+static int cycles_open()
+{
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t cycles_read(int fd)
+{
+	uint64_t count = 0;
+	if (fd >= 0 && sizeof(count) == read(fd, &count, sizeof(count)))
+		return count;
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static int g_cycles = -1;
+
+static const char* cycle_source()
+{
+	if (g_cycles >= 0)
+		return "perf";
+#if defined(__x86_64__) || defined(__i386__)
+	return "tsc";
+#else
+	return "none";
+#endif
+}
+
+// A negative cycle count is reported as null
+static void emit(const char* group, const char* name, const char* variant, double ns_per_frame, double cycles_per_frame)
+{
+	char cycles[32] = "null";
+	if (cycles_per_frame >= 0)
+		snprintf(cycles, sizeof(cycles), "%.3f", cycles_per_frame);
+
+	printf("%s\n    {\"group\": \"%s\", \"name\": \"%s\", \"variant\": \"%s\", \"ns_per_frame\": %.4f, \"cycles_per_frame\": %s}",
+		g_first ? "" : ",", group, name, variant, ns_per_frame, cycles);
+	g_first = false;
+}
+
+// Kernel inputs and outputs, sized for the widest format
+struct Buffers {
+	float in_float[c_frames * 2];
+	float left[c_frames];
+	float right[c_frames];
+	sample_type bus[c_frames * 2];
+	uint8_t packet[c_frames * 6];
+};
+
+static Buffers g_buffers;
+
+typedef void (*kernel)(Buffers* b);
+
+static void run_kernel(const char* group, const char* name, const char* variant, kernel k)
+{
+	double ns[c_repetitions];
+	double cycles[c_repetitions];
+
+	for (int ii = 0; ii < c_calls / 10; ++ii)
+		k(&g_buffers);
+
+	for (int rep = 0; rep < c_repetitions; ++rep) {
+		const uint64_t c0 = cycles_read(g_cycles);
+		const uint64_t t0 = now_ns();
+		for (int ii = 0; ii < c_calls; ++ii)
+			k(&g_buffers);
+		const uint64_t t1 = now_ns();
+		const uint64_t c1 = cycles_read(g_cycles);
+
+		const double frames = (double)c_calls * c_frames;
+		ns[rep] = (t1 - t0) / frames;
+		cycles[rep] = (c1 - c0) / frames;
+	}
+
+	std::sort(ns, ns + c_repetitions);
+	std::sort(cycles, cycles + c_repetitions);
+	emit(group, name, variant, ns[c_repetitions / 2], cycles[c_repetitions / 2]);
+}
+
+static void k_float_to_bus_scalar(Buffers* b) { float_to_bus_scalar(b->in_float, b->bus, c_frames * 2); }
+static void k_float_to_bus(Buffers* b) { float_to_bus(b->in_float, b->bus, c_frames * 2); }
+static void k_bus_to_l16(Buffers* b) { rtp_encode(rtp_l16, b->bus, c_frames, b->packet); }
+static void k_bus_to_l24(Buffers* b) { rtp_encode(rtp_l24, b->bus, c_frames, b->packet); }
+static void k_l16_to_bus(Buffers* b) { rtp_decode(rtp_l16, b->packet, c_frames, b->bus); }
+static void k_l24_to_bus(Buffers* b) { rtp_decode(rtp_l24, b->packet, c_frames, b->bus); }
+static void k_interleave_scalar(Buffers* b) { stereo_to_bus_scalar(b->left, b->right, b->bus, c_frames); }
+static void k_interleave(Buffers* b) { stereo_to_bus(b->left, b->right, b->bus, c_frames); }
+static void k_deinterleave_scalar(Buffers* b) { bus_to_stereo_scalar(b->bus, b->left, b->right, c_frames); }
+static void k_deinterleave(Buffers* b) { bus_to_stereo(b->bus, b->left, b->right, c_frames); }
+
+// queue: items carry their push time so the consumer can measure latency
+
+struct Item {
+	uint64_t pushed_ns;
+	uint32_t producer;
+};
+
+static MpscQueue<Item, 1024> g_queue;
+static std::atomic<bool> g_go;
+static bool g_paced; // latency mode: producers leave gaps instead of saturating
+
+struct Producer {
+	pthread_t thread;
+	uint32_t index;
+	int count;
+};
+
+static void* producer_thread(void* arg)
+{
+	Producer* p = (Producer*)arg;
+	while (!g_go.load(std::memory_order_acquire))
+		;
+
+	for (int ii = 0; ii < p->count; ++ii) {
+		Item item = { now_ns(), p->index };
+		while (!g_queue.push(item))
+			sched_yield();
+
+		if (g_paced) {
+			const uint64_t until = now_ns() + 2000;
+			while (now_ns() < until)
+				;
+		}
+	}
+
+	return NULL;
+}
+
+static void run_queue(int nproducers, bool paced)
+{
+	Producer producers[4];
+	g_queue.reset();
+	g_go.store(false);
+	g_paced = paced;
+
+	const int per_producer = (paced ? c_queue_items / 10 : c_queue_items) / nproducers;
+	const int total = per_producer * nproducers;
+	for (int ii = 0; ii < nproducers; ++ii) {
+		producers[ii].index = (uint32_t)ii;
+		producers[ii].count = per_producer;
+		pthread_create(&producers[ii].thread, NULL, &producer_thread, &producers[ii]);
+	}
+
+	static uint32_t latency[c_queue_items];
+	const uint64_t c0 = cycles_read(g_cycles);
+	const uint64_t t0 = now_ns();
+	g_go.store(true, std::memory_order_release);
+
+	for (int popped = 0; popped < total; ) {
+		Item item;
+		if (g_queue.pop(&item)) {
+			const uint64_t age = now_ns() - item.pushed_ns;
+			latency[popped++] = (uint32_t)std::min<uint64_t>(age, 0xffffffffu);
+		} else {
+			sched_yield();
+		}
+	}
+
+	const uint64_t t1 = now_ns();
+	const uint64_t c1 = cycles_read(g_cycles);
+	for (int ii = 0; ii < nproducers; ++ii)
+		pthread_join(producers[ii].thread, NULL);
+
+	if (paced) {
+		std::sort(latency, latency + total);
+		printf(",\n    {\"group\": \"queue\", \"name\": \"latency\", \"variant\": \"%d_producers\", \"ns_p50\": %u, \"ns_p99\": %u}",
+			nproducers, latency[total / 2], latency[total * 99 / 100]);
+	} else {
+		printf(",\n    {\"group\": \"queue\", \"name\": \"throughput\", \"variant\": \"%d_producers\", \"ns_per_op\": %.2f, \"cycles_per_op\": %.1f}",
+			nproducers, (double)(t1 - t0) / total, (double)(c1 - c0) / total);
+	}
+}
+
+// driver: CPU spent on the audio thread between one callback returning and
+// the next starting, i.e. everything the driver does except sleeping
+
+static uint64_t g_callback_exit_ns;
+static uint64_t g_callback_exit_cycles;
+static uint64_t g_overhead_ns;
+static uint64_t g_overhead_cycles;
+static int64_t g_overhead_frames;
+static int g_driver_cycles = -2; // opened on the audio thread
+
+static void driver_callback(sample_type* samples, int nsamples)
+{
+	if (g_driver_cycles == -2)
+		g_driver_cycles = cycles_open();
+
+	const uint64_t cpu = thread_cpu_ns();
+	const uint64_t cycles = cycles_read(g_driver_cycles);
+	if (g_callback_exit_ns) {
+		g_overhead_ns += cpu - g_callback_exit_ns;
+		g_overhead_cycles += cycles - g_callback_exit_cycles;
+		g_overhead_frames += nsamples;
+	}
+
+	memset(samples, 0, sizeof(sample_type) * 2 * nsamples);
+	g_callback_exit_cycles = cycles_read(g_driver_cycles);
+	g_callback_exit_ns = thread_cpu_ns();
+}
+
+static void run_driver(const char* variant, bool record)
+{
+	g_callback_exit_ns = 0;
+	g_overhead_ns = 0;
+	g_overhead_cycles = 0;
+	g_overhead_frames = 0;
+
+	static const char* const path = "/tmp/tinyaudio_bench.wav";
+	if (!init(c_sample_rate, &driver_callback))
+		return;
+	if (record)
+		record_start(path, c_sample_rate);
+
+	usleep(c_driver_ms * 1000);
+
+	if (record) {
+		record_stop();
+		unlink(path);
+	}
+	release();
+
+	// the TSC keeps counting while the thread sleeps, so only a real cycle
+	// counter means anything here
+	if (g_overhead_frames) {
+		const double cycles = (g_driver_cycles >= 0) ? (double)g_overhead_cycles / g_overhead_frames : -1.0;
+		emit("driver", "null", variant, (double)g_overhead_ns / g_overhead_frames, cycles);
+	}
+	if (g_driver_cycles >= 0)
+		close(g_driver_cycles);
+	g_driver_cycles = -2;
+}
+
+int main()
+{
+	g_cycles = cycles_open();
+
+	for (int ii = 0; ii < c_frames * 2; ++ii)
+		g_buffers.in_float[ii] = (float)rand() / RAND_MAX * 2.2f - 1.1f; // some out of range
+	for (int ii = 0; ii < c_frames; ++ii) {
+		g_buffers.left[ii] = g_buffers.in_float[ii * 2];
+		g_buffers.right[ii] = g_buffers.in_float[ii * 2 + 1];
+	}
+	float_to_bus_scalar(g_buffers.in_float, g_buffers.bus, c_frames * 2);
+	rtp_encode(rtp_l24, g_buffers.bus, c_frames, g_buffers.packet);
+
+	printf("{\n  \"simd\": \"%s\",\n  \"bus\": \"%s\",\n  \"cycle_source\": \"%s\",\n  \"frames_per_call\": %d,\n  \"results\": [",
+		c_simd_name, TINYAUDIO_FLOAT_BUS ? "f32" : "s16", cycle_source(), c_frames);
+
+	run_kernel("convert", "float_to_bus", "scalar", &k_float_to_bus_scalar);
+	run_kernel("convert", "float_to_bus", c_simd_name, &k_float_to_bus);
+	run_kernel("convert", "bus_to_l16", "scalar", &k_bus_to_l16);
+	run_kernel("convert", "bus_to_l24", "scalar", &k_bus_to_l24);
+	run_kernel("convert", "l16_to_bus", "scalar", &k_l16_to_bus);
+	run_kernel("convert", "l24_to_bus", "scalar", &k_l24_to_bus);
+	run_kernel("interleave", "stereo_to_bus", "scalar", &k_interleave_scalar);
+	run_kernel("interleave", "stereo_to_bus", c_simd_name, &k_interleave);
+	run_kernel("interleave", "bus_to_stereo", "scalar", &k_deinterleave_scalar);
+	run_kernel("interleave", "bus_to_stereo", c_simd_name, &k_deinterleave);
+
+	for (int nproducers = 1; nproducers <= 4; nproducers *= 2) {
+		run_queue(nproducers, false);
+		run_queue(nproducers, true);
+	}
+
+	run_driver("plain", false);
+	run_driver("record", true);
+
+	printf("\n  ]\n}\n");
+	return 0;
+}
@@ -0,0 +1,141 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Sound bank decode cost: how many ADPCM (and PCM) voices one core decodes
+// in real time, and how much memory the bank saves over 16-bit PCM. Small
+// periods that do not line up with the ADPCM blocks are run with and
+// without a per-voice cursor.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_bank.h>
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_max_period = 512;
+static const int c_nsounds = 256;
+static const int c_sound_frames = 24000; // half a second each
+static const int c_nframes = 102400; // decoded per voice per run
+static const char* c_path = "bench_bank.tmp";
+
+static double now_ms()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static const bank* build(bank_codec codec, const short* pcm)
+{
+	bank_sound sounds[c_nsounds];
+	for (int ii = 0; ii < c_nsounds; ++ii) {
+		sounds[ii].samples = pcm;
+		sounds[ii].nframes = c_sound_frames;
+		sounds[ii].channels = 2;
+		sounds[ii].codec = codec;
+	}
+
+	if (!bank_write(c_path, sounds, c_nsounds))
+		return NULL;
+
+	const bank* b = bank_open(c_path);
+	remove(c_path);
+	return b;
+}
+
+static double bench_decode(const bank* b, int nvoices, int period, bool cursors)
+{
+	static sample_type out[c_max_period * 2];
+	static bank_cursor voices[c_nsounds];
+	memset(voices, 0, sizeof(voices));
+
+	const double start = now_ms();
+	int position = 0;
+	for (int done = 0; done < c_nframes; done += period) {
+		for (int voice = 0; voice < nvoices; ++voice)
+			bank_decode(b, voice % c_nsounds, position, out, period, cursors ? &voices[voice % c_nsounds] : NULL);
+
+		position += period;
+		if (position + period > c_sound_frames)
+			position = 0;
+	}
+
+	volatile sample_type sink = out[0];
+	(void)sink;
+	return now_ms() - start;
+}
+
+static void report(const char* name, int nvoices, int period, double elapsed_ms)
+{
+	const int nframes = (c_nframes + period - 1) / period * period;
+	const double audio_ms = 1000.0 * nframes / c_sample_rate;
+	const double voices_per_core = nvoices * audio_ms / elapsed_ms;
+	const double ns_per_voice_frame = elapsed_ms * 1000000.0 / ((double)nvoices * nframes);
+	printf("%-14s %4d frames %6d voices %10.0f voices/core %8.3f ns/voice-frame\n", name, period, nvoices, voices_per_core, ns_per_voice_frame);
+}
+
+int main()
+{
+	short* pcm = (short*)malloc(sizeof(short) * 2 * c_sound_frames);
+	for (int ii = 0; ii < c_sound_frames; ++ii) {
+		const float noise = (float)rand() / RAND_MAX - 0.5f;
+		pcm[ii * 2 + 0] = (short)(16000.0f * sinf(ii * 0.031f) + 4000.0f * noise);
+		pcm[ii * 2 + 1] = (short)(16000.0f * sinf(ii * 0.017f) - 4000.0f * noise);
+	}
+
+	const bank* adpcm = build(bank_adpcm, pcm);
+	const bank* raw = build(bank_pcm16, pcm);
+	if (!adpcm || !raw) {
+		fprintf(stderr, "failed to build the banks\n");
+		return 1;
+	}
+
+	printf("%d stereo sounds of %d frames: pcm %zu KiB, adpcm %zu KiB (%.2fx smaller)\n",
+		c_nsounds, c_sound_frames, bank_bytes(raw) / 1024, bank_bytes(adpcm) / 1024,
+		(double)bank_bytes(raw) / bank_bytes(adpcm));
+	printf("%d Hz\n", c_sample_rate);
+
+	static const int periods[] = {512, 100, 64};
+	static const int nvoices[] = {16, 64, 256};
+	for (unsigned jj = 0; jj < sizeof(periods) / sizeof(periods[0]); ++jj) {
+		const int period = periods[jj];
+		for (unsigned ii = 0; ii < sizeof(nvoices) / sizeof(nvoices[0]); ++ii) {
+			report("pcm", nvoices[ii], period, bench_decode(raw, nvoices[ii], period, false));
+			report("adpcm", nvoices[ii], period, bench_decode(adpcm, nvoices[ii], period, false));
+			report("adpcm cursor", nvoices[ii], period, bench_decode(adpcm, nvoices[ii], period, true));
+		}
+	}
+
+	bank_close(adpcm);
+	bank_close(raw);
+	free(pcm);
+	return 0;
+}
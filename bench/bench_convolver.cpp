@@ -0,0 +1,119 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Convolver cost: CPU time per second of audio against impulse response
+// length, with and without the tail worker thread. Worker runs are paced in
+// real time so the worker gets the slack a device would leave it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_convolver.h>
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_period = 512;
+static const int c_block = 128;
+static const int c_seconds = 4; // of audio per run
+
+static double now_ms(clockid_t clock)
+{
+	timespec ts;
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void render_noise(sample_type* samples, int nsamples)
+{
+	for (int ii = 0; ii < nsamples * 2; ++ii) {
+#if TINYAUDIO_FLOAT_BUS
+		samples[ii] = (float)rand() / RAND_MAX - 0.5f;
+#else
+		samples[ii] = (sample_type)(rand() % 16384 - 8192);
+#endif
+	}
+}
+
+static void bench(const float* ir, int ir_frames, bool worker)
+{
+	if (!convolver_init(&render_noise, ir, ir, ir_frames, c_block, worker)) {
+		fprintf(stderr, "convolver_init failed\n");
+		return;
+	}
+
+	static sample_type out[c_period * 2];
+	const int nperiods = c_seconds * c_sample_rate / c_period;
+
+	timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	double wall_ms = 0.0;
+	const double cpu = now_ms(CLOCK_PROCESS_CPUTIME_ID);
+	for (int ii = 0; ii < nperiods; ++ii) {
+		const double start = now_ms(CLOCK_MONOTONIC);
+		convolver_render(out, c_period);
+		wall_ms += now_ms(CLOCK_MONOTONIC) - start;
+
+		if (worker) {
+			deadline.tv_nsec += 1000000000L / c_sample_rate * c_period;
+			while (deadline.tv_nsec >= 1000000000L) {
+				deadline.tv_nsec -= 1000000000L;
+				++deadline.tv_sec;
+			}
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+		}
+	}
+	const double cpu_ms = now_ms(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+	const unsigned misses = convolver_worker_misses();
+
+	convolver_release();
+
+	printf("ir %5.2f s %-9s %8.2f ms/s audio thread %8.2f ms/s cpu %6u misses\n",
+		(double)ir_frames / c_sample_rate, worker ? "worker" : "inline",
+		wall_ms / c_seconds, cpu_ms / c_seconds, misses);
+}
+
+int main()
+{
+	const int max_frames = 4 * c_sample_rate;
+	float* ir = (float*)malloc(sizeof(float) * max_frames);
+	for (int ii = 0; ii < max_frames; ++ii)
+		ir[ii] = ((float)rand() / RAND_MAX - 0.5f) * 0.01f;
+
+	printf("stereo, block %d, period %d frames @ %d Hz (including the noise callback)\n", c_block, c_period, c_sample_rate);
+
+	static const float seconds[] = {0.25f, 0.5f, 1.0f, 2.0f, 4.0f};
+	for (unsigned ii = 0; ii < sizeof(seconds) / sizeof(seconds[0]); ++ii) {
+		const int frames = (int)(seconds[ii] * c_sample_rate);
+		bench(ir, frames, false);
+		bench(ir, frames, true);
+	}
+
+	free(ir);
+	return 0;
+}
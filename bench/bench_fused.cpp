@@ -0,0 +1,245 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Fused render loop against the indirect one: the same stereo processor
+// played through fused_backend, and through a function pointer into planar
+// float blocks that are then converted to the bus format, each driven the
+// way a driver calls its samples_callback.
+
+#include <stdio.h>
+#include <time.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_fused.h>
+#include "tinyaudio_kernels.h"
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_period = 500; // not a multiple of the vector width
+static const int c_nperiods = 40000;
+static const int c_block = 64;
+
+static double now_ms()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// sin(2 pi t) for t in [-0.25, 0.25]
+static inline vfloat sin_quarter(vfloat t)
+{
+	const vfloat x = vmul(t, vset1(6.283185307f));
+	const vfloat x2 = vmul(x, x);
+	vfloat p = vset1(1.0f / 362880.0f);
+	p = vmadd(p, x2, vset1(-1.0f / 5040.0f));
+	p = vmadd(p, x2, vset1(1.0f / 120.0f));
+	p = vmadd(p, x2, vset1(-1.0f / 6.0f));
+	p = vmadd(p, x2, vset1(1.0f));
+	return vmul(p, x);
+}
+
+// cos(2 pi phase), phase in cycles
+static inline vfloat cos_cycles(vfloat phase)
+{
+	const vfloat t = vsub(phase, vround(phase));
+	return sin_quarter(vsub(vset1(0.25f), vabs(t)));
+}
+
+// Two slightly detuned tones, one per channel, with a gain that glides at
+// control rate
+struct Chorus {
+	static constexpr int channels = 2;
+	static constexpr int block_frames = c_block;
+	typedef sample_type sample;
+
+	vfloat phase_l, phase_r;
+	vfloat step_l, step_r;
+	float gain, target, glide;
+	vfloat vgain;
+
+	void reset(float left_hz, float right_hz)
+	{
+		phase_l = vmul(vramp(), vset1(left_hz / c_sample_rate));
+		phase_r = vmul(vramp(), vset1(right_hz / c_sample_rate));
+		step_l = vset1(left_hz / c_sample_rate * c_simd_width);
+		step_r = vset1(right_hz / c_sample_rate * c_simd_width);
+		gain = 0.0f;
+		target = 0.5f;
+		glide = 0.01f;
+		vgain = vset1(gain);
+	}
+
+	void block()
+	{
+		gain += (target - gain) * glide;
+		vgain = vset1(gain);
+	}
+
+	void next(vfloat* out)
+	{
+		out[0] = vmul(cos_cycles(phase_l), vgain);
+		out[1] = vmul(cos_cycles(phase_r), vgain);
+		phase_l = vadd(phase_l, step_l);
+		phase_l = vsub(phase_l, vround(phase_l));
+		phase_r = vadd(phase_r, step_r);
+		phase_r = vsub(phase_r, vround(phase_r));
+	}
+};
+
+// Naive sawtooth at a fixed gain: so little work per frame that the
+// passes over memory dominate
+struct Saw {
+	static constexpr int channels = 1;
+	static constexpr int block_frames = c_block;
+	typedef sample_type sample;
+
+	vfloat phase, step, gain;
+
+	void reset(float hz)
+	{
+		phase = vmul(vramp(), vset1(hz / c_sample_rate));
+		step = vset1(hz / c_sample_rate * c_simd_width);
+		gain = vset1(0.5f);
+	}
+
+	void block()
+	{
+	}
+
+	void next(vfloat* out)
+	{
+		out[0] = vmul(vadd(phase, phase), gain);
+		phase = vadd(phase, step);
+		phase = vsub(phase, vround(phase));
+	}
+};
+
+// Indirect path: the processor behind a C-style block callback, into planar
+// float, then converted to the bus format
+typedef void (*float_render)(void* context, float* left, float* right, int nframes);
+
+template<typename Processor>
+static void block_render(void* context, float* left, float* right, int nframes)
+{
+	Processor* processor = (Processor*)context;
+	processor->block();
+	for (int ii = 0; ii < nframes; ii += c_simd_width) {
+		vfloat v[Processor::channels];
+		processor->next(v);
+		vstore(left + ii, v[0]);
+		vstore(right + ii, v[Processor::channels - 1]);
+	}
+}
+
+template<typename Processor>
+struct indirect {
+	static Processor processor;
+	static float_render volatile render;
+
+	static void callback(sample_type* samples, int nsamples)
+	{
+		// carried-over frames keep the block boundaries aligned across periods
+		static float left[c_block], right[c_block];
+		static int ncarry;
+
+		while (nsamples) {
+			if (!ncarry) {
+				render(&processor, left, right, c_block);
+				ncarry = c_block;
+			}
+			const int n = (ncarry < nsamples) ? ncarry : nsamples;
+			stereo_to_bus(left + c_block - ncarry, right + c_block - ncarry, samples, n);
+			ncarry -= n;
+			samples += n * 2;
+			nsamples -= n;
+		}
+	}
+};
+
+template<typename Processor>
+Processor indirect<Processor>::processor;
+
+template<typename Processor>
+float_render volatile indirect<Processor>::render = &block_render<Processor>;
+
+// Best of a few runs, in ns per frame
+static double run(samples_callback volatile callback, sample_type* out)
+{
+	double best = 1e30;
+	for (int rep = 0; rep < 5; ++rep) {
+		callback(out, c_period);
+		const double start = now_ms();
+		for (int period = 0; period < c_nperiods; ++period)
+			callback(out, c_period);
+		const double elapsed = now_ms() - start;
+		if (elapsed < best)
+			best = elapsed;
+	}
+	return best * 1000000.0 / ((double)c_period * c_nperiods);
+}
+
+// Both paths render the same frames, so their last periods should agree
+template<typename Processor>
+static bool compare(const char* name, const Processor& initial)
+{
+	static sample_type indirect_out[c_period * 2];
+	static sample_type fused_out[c_period * 2];
+	static Processor processor;
+
+	indirect<Processor>::processor = initial;
+	processor = initial;
+	fused_instance<Processor>::backend.reset(&processor);
+
+	const double indirect_ns = run(&indirect<Processor>::callback, indirect_out);
+	const double fused_ns = run(&fused_instance<Processor>::render, fused_out);
+
+	int mismatches = 0;
+	for (int ii = 0; ii < c_period * 2; ++ii) {
+		const float d = (float)indirect_out[ii] - (float)fused_out[ii];
+		if (d > 1.0f || d < -1.0f)
+			++mismatches;
+	}
+
+	printf("%-8s indirect %7.3f ns/frame, fused %7.3f ns/frame, %5.2fx\n", name, indirect_ns, fused_ns, indirect_ns / fused_ns);
+	if (mismatches)
+		printf("%-8s outputs differ in %d samples\n", name, mismatches);
+	return !mismatches;
+}
+
+int main()
+{
+	printf("simd: %s, period %d frames, processor block %d frames\n", c_simd_name, c_period, c_block);
+
+	Chorus chorus;
+	chorus.reset(440.0f, 441.5f);
+	Saw saw;
+	saw.reset(440.0f);
+
+	bool ok = compare("chorus", chorus);
+	ok = compare("saw", saw) && ok;
+	return ok ? 0 : 1;
+}
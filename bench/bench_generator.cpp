@@ -0,0 +1,124 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Generator throughput in frames per second on one core, against the
+// per-frame sinf loop of example_sin.cpp.
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_generator.h>
+#include <TINYAUDIO/tinyaudio_simd.h>
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_period = 512;
+static const int c_nperiods = 20000;
+
+static double now_ms()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// example_sin.cpp's loop, in the bus format
+static float g_angle;
+
+static void sinf_baseline(sample_type* samples, int nsamples)
+{
+	static const float two_pi = 6.283185307f;
+	static const float angle_delta = two_pi * 440.0f / c_sample_rate;
+
+	for (; nsamples; --nsamples, samples += 2, g_angle += angle_delta) {
+		if (g_angle > two_pi)
+			g_angle -= two_pi;
+
+#if TINYAUDIO_FLOAT_BUS
+		const sample_type sample = sinf(g_angle) * 0.5f;
+#else
+		const sample_type sample = (sample_type)(sinf(g_angle) * 0x3FFF);
+#endif
+		samples[0] = sample;
+		samples[1] = sample;
+	}
+}
+
+static void report(const char* name, double elapsed_ms, double baseline_ms)
+{
+	const double frames = (double)c_period * c_nperiods;
+	printf("%-16s %8.1f Mframes/s %8.3f ns/frame %6.1fx sinf\n", name,
+		frames / elapsed_ms / 1000.0, elapsed_ms * 1000000.0 / frames, baseline_ms / elapsed_ms);
+}
+
+int main()
+{
+	static sample_type out[c_period * 2];
+
+	printf("simd: %s, period %d frames @ %d Hz\n", c_simd_name, c_period, c_sample_rate);
+
+	sinf_baseline(out, c_period);
+	double start = now_ms();
+	for (int period = 0; period < c_nperiods; ++period)
+		sinf_baseline(out, c_period);
+	const double baseline_ms = now_ms() - start;
+	report("sinf", baseline_ms, baseline_ms);
+
+	struct {
+		const char* name;
+		generator_waveform waveform;
+		float end_frequency;
+	} const cases[] = {
+		{ "sine", generator_sine, 0.0f },
+		{ "sine sweep", generator_sine, 20000.0f },
+		{ "saw", generator_saw, 0.0f },
+		{ "square", generator_square, 0.0f },
+		{ "white", generator_white, 0.0f },
+		{ "pink", generator_pink, 0.0f },
+	};
+
+	for (unsigned ii = 0; ii < sizeof(cases) / sizeof(cases[0]); ++ii) {
+		generator_settings settings = generator_default_settings();
+		settings.waveform = cases[ii].waveform;
+		settings.end_frequency = cases[ii].end_frequency;
+
+		generator g;
+		generator_reset(&g, c_sample_rate, &settings);
+		generator_fill(&g, out, c_period);
+
+		start = now_ms();
+		for (int period = 0; period < c_nperiods; ++period)
+			generator_fill(&g, out, c_period);
+		report(cases[ii].name, now_ms() - start, baseline_ms);
+	}
+
+	// keep the output alive
+	volatile sample_type sink = out[0];
+	(void)sink;
+	return 0;
+}
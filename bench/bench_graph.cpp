@@ -0,0 +1,168 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Render graph scaling: the same graph on 1..N threads, driven by the
+// wall-clock-paced null driver so every period has a real deadline.
+//
+// Build with TINYAUDIO_NULL_PACED=1.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_graph.h>
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_nvoices = 64;
+static const int c_nbuses = 8;
+static const int c_nfilters = 24; // biquad passes per voice node: the "work"
+static const int c_run_ms = 2000;
+
+struct VoiceNode {
+	unsigned seed;
+	float z1[2], z2[2];
+};
+
+static VoiceNode g_voices[c_nvoices];
+
+static uint64_t now_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void voice_process(void* context, const float* const*, int, float* output, int nframes)
+{
+	VoiceNode* v = (VoiceNode*)context;
+
+	for (int ii = 0; ii < nframes * 2; ++ii) {
+		v->seed = v->seed * 1664525u + 1013904223u;
+		output[ii] = (float)(int)v->seed * (1.0f / 2147483648.0f) * 0.01f;
+	}
+
+	// a cascade of identical low-pass biquads
+	const float b0 = 0.0675f, b1 = 0.135f, b2 = 0.0675f, a1 = -1.143f, a2 = 0.413f;
+	for (int pass = 0; pass < c_nfilters; ++pass) {
+		for (int ch = 0; ch < 2; ++ch) {
+			float z1 = v->z1[ch], z2 = v->z2[ch];
+			for (int ii = ch; ii < nframes * 2; ii += 2) {
+				const float x = output[ii];
+				const float y = b0 * x + z1;
+				z1 = b1 * x - a1 * y + z2;
+				z2 = b2 * x - a2 * y;
+				output[ii] = y;
+			}
+			v->z1[ch] = z1;
+			v->z2[ch] = z2;
+		}
+	}
+}
+
+static void sum_process(void*, const float* const* inputs, int ninputs, float* output, int nframes)
+{
+	for (int ii = 0; ii < nframes * 2; ++ii) {
+		float sum = 0.0f;
+		for (int jj = 0; jj < ninputs; ++jj)
+			sum += inputs[jj][ii];
+		output[ii] = sum;
+	}
+}
+
+static uint64_t g_total_ns;
+static uint64_t g_max_ns;
+static int g_nperiods;
+static int g_period_frames;
+
+static void timed_render(sample_type* samples, int nsamples)
+{
+	const uint64_t start = now_ns();
+	graph_render(samples, nsamples);
+	const uint64_t elapsed = now_ns() - start;
+
+	g_total_ns += elapsed;
+	if (elapsed > g_max_ns)
+		g_max_ns = elapsed;
+	++g_nperiods;
+	g_period_frames = nsamples;
+}
+
+static bool build_graph()
+{
+	const graph_node master = graph_add_node(&sum_process, NULL);
+	for (int bus = 0; bus < c_nbuses; ++bus) {
+		const graph_node sum = graph_add_node(&sum_process, NULL);
+		graph_connect(sum, master);
+
+		for (int ii = bus; ii < c_nvoices; ii += c_nbuses) {
+			g_voices[ii].seed = ii + 1;
+			const graph_node voice = graph_add_node(&voice_process, &g_voices[ii]);
+			graph_connect(voice, sum);
+		}
+	}
+
+	return graph_set_output(master) && graph_compile();
+}
+
+int main()
+{
+	long maxthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (maxthreads < 1)
+		maxthreads = 1;
+
+	printf("%d voice nodes x %d biquads, %d buses\n", c_nvoices, c_nfilters, c_nbuses);
+	printf("threads  mean us  max us  period us  speedup\n");
+
+	double baseline = 0.0;
+	for (int nthreads = 1; nthreads <= maxthreads; ++nthreads) {
+		if (!graph_init(nthreads, 1 + c_nbuses + c_nvoices) || !build_graph()) {
+			fprintf(stderr, "failed to build the graph\n");
+			return -1;
+		}
+
+		g_total_ns = g_max_ns = 0;
+		g_nperiods = 0;
+		if (!init(c_sample_rate, &timed_render)) {
+			fprintf(stderr, "failed to initialize audio device: %s\n", last_error());
+			return -1;
+		}
+
+		usleep(c_run_ms * 1000);
+		release();
+		graph_release();
+
+		const double mean = g_nperiods ? g_total_ns / 1000.0 / g_nperiods : 0.0;
+		if (nthreads == 1)
+			baseline = mean;
+		printf("%7d %8.1f %7.1f %10.1f %8.2f\n", nthreads, mean, g_max_ns / 1000.0,
+			1000000.0 * g_period_frames / c_sample_rate, mean > 0.0 ? baseline / mean : 0.0);
+	}
+
+	return 0;
+}
@@ -0,0 +1,124 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Mixer throughput: how many voices fit in real time on one core, SIMD
+// kernels against the scalar reference.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_mixer.h>
+#include "tinyaudio_kernels.h"
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_period = 512;
+static const int c_source_frames = 48000;
+static const int c_nperiods = 2000;
+
+static double now_ms()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+typedef void (*mix_kernel)(float*, float*, const float*, int, float, float, float, float);
+
+static double bench_kernel(mix_kernel kernel, const float* source, int nvoices)
+{
+	static float left[c_period];
+	static float right[c_period];
+
+	const double start = now_ms();
+	int position = 0;
+	for (int period = 0; period < c_nperiods; ++period) {
+		for (int voice = 0; voice < nvoices; ++voice) {
+			// every other voice is mid-ramp
+			const float ramp = (voice & 1) ? 1.0f / c_period : 0.0f;
+			kernel(left, right, source + position, c_period, 0.5f, 0.25f, ramp, -ramp);
+		}
+
+		position += c_period;
+		if (position + c_period > c_source_frames)
+			position = 0;
+	}
+
+	// keep the result alive
+	volatile float sink = left[0] + right[c_period - 1];
+	(void)sink;
+	return now_ms() - start;
+}
+
+static double bench_mixer(const float* source, int nvoices)
+{
+	static sample_type out[c_period * 2];
+
+	mixer_init(nvoices);
+	for (int voice = 0; voice < nvoices; ++voice)
+		mixer_play(source, c_source_frames, 0.01f, (voice % 3) - 1.0f, true);
+
+	mixer_render(out, c_period);
+
+	const double start = now_ms();
+	for (int period = 0; period < c_nperiods; ++period)
+		mixer_render(out, c_period);
+	const double elapsed = now_ms() - start;
+
+	mixer_release();
+	return elapsed;
+}
+
+static void report(const char* name, int nvoices, double elapsed_ms)
+{
+	// voices/ms: voice-milliseconds of audio mixed per millisecond of CPU,
+	// i.e. how many voices one core keeps up with in real time
+	const double audio_ms = 1000.0 * c_period * c_nperiods / c_sample_rate;
+	const double voices_per_ms = nvoices * audio_ms / elapsed_ms;
+	const double ns_per_voice_frame = elapsed_ms * 1000000.0 / ((double)nvoices * c_period * c_nperiods);
+	printf("%-16s %6d voices %10.1f voices/ms %8.3f ns/voice-frame\n", name, nvoices, voices_per_ms, ns_per_voice_frame);
+}
+
+int main()
+{
+	float* source = (float*)malloc(sizeof(float) * c_source_frames);
+	for (int ii = 0; ii < c_source_frames; ++ii)
+		source[ii] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+
+	printf("simd: %s, period %d frames @ %d Hz\n", c_simd_name, c_period, c_sample_rate);
+
+	static const int nvoices[] = {64, 256, 1024};
+	for (unsigned ii = 0; ii < sizeof(nvoices) / sizeof(nvoices[0]); ++ii) {
+		report("kernel scalar", nvoices[ii], bench_kernel(&mix_mono_scalar, source, nvoices[ii]));
+		report("kernel simd", nvoices[ii], bench_kernel(&mix_mono, source, nvoices[ii]));
+		report("mixer_render", nvoices[ii], bench_mixer(source, nvoices[ii]));
+	}
+
+	free(source);
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Server capacity: how many 48 kHz sine streams the server's worker pool
+// renders before periods start finishing late, reported per core.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_generator.h>
+#include <TINYAUDIO/tinyaudio_server.h>
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_period = 480; // 10ms
+static const int c_nmaxstreams = 16384;
+static const int c_run_ms = 2000;
+static const double c_max_miss_rate = 0.001;
+
+static generator g_generators[c_nmaxstreams];
+static server_stream g_streams[c_nmaxstreams];
+
+static void render_sine(void* context, sample_type* samples, int nframes)
+{
+	generator_fill((generator*)context, samples, nframes);
+}
+
+int main(int argc, char** argv)
+{
+	const int nthreads = (argc > 1) ? atoi(argv[1]) : 0;
+	if (!server_init(nthreads, c_nmaxstreams))
+		return -1;
+
+	const int ncores = server_threads();
+	printf("%d worker(s), %d frame periods @ %d Hz\n", ncores, c_period, c_sample_rate);
+	printf("%8s %12s %10s %10s %12s %10s\n", "streams", "Mframes/s", "cpu %", "misses", "max late ms", "resyncs");
+
+	generator_settings settings = generator_default_settings();
+	int capacity = 0;
+
+	for (int nstreams = 64; nstreams <= c_nmaxstreams; nstreams += nstreams / 2) {
+		for (int ii = 0; ii < nstreams; ++ii) {
+			generator_reset(&g_generators[ii], c_sample_rate, &settings);
+			g_streams[ii] = server_open(c_sample_rate, c_period, &render_sine, &g_generators[ii]);
+		}
+
+		usleep(c_run_ms * 1000);
+
+		server_stream_stats total = {};
+		for (int ii = 0; ii < nstreams; ++ii) {
+			server_stream_stats stats;
+			if (server_read_stats(g_streams[ii], &stats)) {
+				total.periods += stats.periods;
+				total.frames += stats.frames;
+				total.deadline_misses += stats.deadline_misses;
+				total.resyncs += stats.resyncs;
+				total.render_ns += stats.render_ns;
+				if (stats.max_lateness_ns > total.max_lateness_ns)
+					total.max_lateness_ns = stats.max_lateness_ns;
+			}
+		}
+
+		for (int ii = 0; ii < nstreams; ++ii)
+			server_close(g_streams[ii]);
+
+		const double cpu = total.render_ns / (c_run_ms * 10000.0 * ncores);
+		printf("%8d %12.2f %10.1f %10llu %12.2f %10llu\n", nstreams,
+			total.frames / (c_run_ms * 1000.0), cpu, (unsigned long long)total.deadline_misses,
+			total.max_lateness_ns / 1000000.0, (unsigned long long)total.resyncs);
+
+		if (total.deadline_misses > total.periods * c_max_miss_rate)
+			break;
+		capacity = nstreams;
+	}
+
+	server_release();
+
+	printf("capacity: %d streams on %d worker(s), %.0f streams per core\n",
+		capacity, ncores, (double)capacity / ncores);
+	return 0;
+}
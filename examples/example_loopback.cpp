@@ -0,0 +1,156 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Plays the sin example through the loopback driver and checks what the
+// device would have played, so CI can catch glitches and latency
+// regressions without sound hardware. Exits non-zero on any glitch, or if
+// the worst callback-to-output latency is over the limit.
+//
+//     loopback_check [seconds] [max_latency_ms]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_loopback.h>
+#include <TINYAUDIO/tinyaudio_stats.h>
+#include <TINYAUDIO/tinyaudio_verify.h>
+
+using namespace tinyaudio;
+
+extern bool start_sample();
+
+// the signal example_sin.cpp plays
+static const int c_sample_rate = 44100;
+static const float c_frequency = 440.0f;
+
+static const int c_min_block_frames = 64;
+
+// Runs the verifier on a synthetic 48 kHz sine in 256-frame blocks, with
+// block 12 optionally replaced by a replay of block 11, and checks that it
+// reports exactly the expected number of duplicates and nothing else.
+static bool check_verifier(int frequency, bool replay, int expected_duplicates)
+{
+	static const int c_rate = 48000;
+	static const int c_block = 256;
+	static const int c_nblocks = 32;
+	static sample_type samples[2 * c_block * c_nblocks];
+	loopback_block blocks[c_nblocks];
+
+	for (int ii = 0; ii < c_block * c_nblocks; ++ii) {
+		// exact phase, so a whole number of cycles per block repeats exactly
+		const float v = 0.5f * (float)sin(6.283185307179586 * ((ii * frequency) % c_rate) / c_rate);
+#if TINYAUDIO_FLOAT_BUS
+		samples[2 * ii] = samples[2 * ii + 1] = v;
+#else
+		samples[2 * ii] = samples[2 * ii + 1] = (short)lrintf(v * 32767.0f);
+#endif
+	}
+	memset(blocks, 0, sizeof(blocks));
+	for (int ii = 0; ii < c_nblocks; ++ii) {
+		blocks[ii].frame = ii * c_block;
+		blocks[ii].nframes = c_block;
+	}
+	if (replay)
+		memcpy(samples + 2 * 12 * c_block, samples + 2 * 11 * c_block, sizeof(sample_type) * 2 * c_block);
+
+	verify_sine_report report;
+	verify_sine(samples, c_block * c_nblocks, (float)frequency, c_rate, blocks, c_nblocks, &report);
+	return report.duplicated_blocks == expected_duplicates && !report.discontinuities && !report.dropouts;
+}
+
+int main(int argc, char** argv)
+{
+	const int seconds = (argc > 1) ? atoi(argv[1]) : 5;
+	const double max_latency_ms = (argc > 2) ? atof(argv[2]) : 20.0;
+	if (seconds < 1 || max_latency_ms <= 0.0) {
+		fprintf(stderr, "usage: loopback_check [seconds] [max_latency_ms]\n");
+		return -1;
+	}
+
+	// 750 Hz is exactly four cycles per block, so every block repeats
+	if (!check_verifier(750, false, 0) || !check_verifier(440, false, 0) || !check_verifier(440, true, 1)) {
+		printf("FAIL: the verifier misreports synthetic signals\n");
+		return 1;
+	}
+
+	const int max_frames = seconds * c_sample_rate;
+	const int max_blocks = max_frames / c_min_block_frames;
+	sample_type* samples = (sample_type*)malloc(sizeof(sample_type) * 2 * max_frames);
+	loopback_block* blocks = (loopback_block*)malloc(sizeof(loopback_block) * max_blocks);
+	if (!samples || !blocks) {
+		fprintf(stderr, "Failed to allocate the capture\n");
+		return -1;
+	}
+
+	set_loopback_capture(samples, max_frames, blocks, max_blocks);
+	if (!start_sample()) {
+		fprintf(stderr, "Failed to initialize audio device: %s\n", last_error());
+		return -1;
+	}
+
+	int nframes = 0, nblocks = 0;
+	for (int waited_ms = 0; nframes < max_frames && waited_ms < (seconds + 2) * 1000; waited_ms += 50) {
+		usleep(50 * 1000);
+		loopback_captured(&nframes, &nblocks);
+	}
+
+	driver_stats stats;
+	read_driver_stats(&stats);
+	release();
+	loopback_captured(&nframes, &nblocks);
+
+	verify_sine_report sine;
+	verify_sine(samples, nframes, c_frequency, c_sample_rate, blocks, nblocks, &sine);
+
+	verify_latency_report latency;
+	verify_latency(blocks, nblocks, &latency);
+
+	printf("frames %d, blocks %d, underruns %llu\n", sine.frames, latency.blocks, (unsigned long long)stats.underruns);
+	printf("discontinuities %d, dropouts %d (%d frames), duplicated blocks %d",
+		sine.discontinuities, sine.dropouts, sine.dropout_frames, sine.duplicated_blocks);
+	if (sine.first_error >= 0)
+		printf(", first at frame %d", sine.first_error);
+	printf("\nlatency us: min %.0f, mean %.0f, p99 %.0f, max %.0f\n",
+		latency.min_us, latency.mean_us, latency.p99_us, latency.max_us);
+
+	const bool glitched = sine.discontinuities || sine.dropouts || sine.duplicated_blocks;
+	const bool late = latency.max_us > max_latency_ms * 1000.0;
+	if (nframes < max_frames / 2 || !nblocks)
+		printf("FAIL: captured too little audio\n");
+	else if (glitched)
+		printf("FAIL: glitches in the output\n");
+	else if (late)
+		printf("FAIL: latency over %.1f ms\n", max_latency_ms);
+	else
+		printf("PASS\n");
+
+	free(blocks);
+	free(samples);
+	return (glitched || late || nframes < max_frames / 2 || !nblocks) ? 1 : 0;
+}
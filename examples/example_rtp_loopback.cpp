@@ -0,0 +1,129 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// RTP over loopback in one process: the RTP driver sends a counting signal
+// to 127.0.0.1, and the main thread plays the receiver the way a local
+// device would, checking that everything it hears is in order.
+//
+//     rtp_loopback [loss_percent] [jitter_ms] [seconds]
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_rtp.h>
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_period = 256;
+static const int c_port = 5004;
+
+static short g_count;
+
+// left counts up, right is its negation; L16/L24 carry both exactly
+static void generate_samples(short* samples, int nsamples)
+{
+	for (; nsamples; --nsamples, samples += 2) {
+		if (++g_count == 0) // keep silence unambiguous
+			g_count = 1;
+		samples[0] = g_count;
+		samples[1] = (short)-g_count;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	rtp_settings settings = rtp_default_settings();
+	settings.port = c_port;
+	settings.loss = (argc > 1) ? (float)atof(argv[1]) / 100.0f : 0.0f;
+	settings.jitter_us = (argc > 2) ? (int)(atof(argv[2]) * 1000.0f) : 0;
+	const int seconds = (argc > 3) ? atoi(argv[3]) : 5;
+
+	rtp_settings receive = settings;
+	receive.address = "127.0.0.1";
+	if (!rtp_receiver_init(c_sample_rate, &receive)) {
+		fprintf(stderr, "Failed to start the receiver\n");
+		return -1;
+	}
+
+	set_rtp_settings(&settings);
+	if (!init(c_sample_rate, &generate_samples)) {
+		fprintf(stderr, "Failed to start the RTP driver: %s\n", last_error());
+		return -1;
+	}
+
+	short samples[2 * c_period];
+	short expected = 0; // next count, once we have heard one
+	long heard = 0, gaps = 0, errors = 0;
+
+	timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	const int nperiods = seconds * c_sample_rate / c_period;
+	for (int p = 1; p <= nperiods; ++p) {
+		rtp_receiver_render(samples, c_period);
+
+		for (int i = 0; i < c_period; ++i) {
+			// silence is concealment or an underrun; the count picks up
+			// where it left off unless frames were lost or skipped
+			const short s = samples[2 * i];
+			if (s) {
+				if (expected && s != expected)
+					++gaps;
+				expected = (short)(s + 1);
+				if (!expected)
+					expected = 1;
+				if (samples[2 * i + 1] != (short)-s)
+					++errors;
+				++heard;
+			}
+		}
+
+		if (p % (c_sample_rate / c_period) == 0) {
+			rtp_receiver_stats stats;
+			rtp_receiver_read_stats(&stats);
+			printf("%3ds packets %7llu lost %5llu late %5llu underruns %3llu skipped %6llu jitter %6.1f delay %5d gaps %5ld errors %ld\n",
+				(p * c_period + c_sample_rate / 2) / c_sample_rate, (unsigned long long)stats.packets, (unsigned long long)stats.lost_packets,
+				(unsigned long long)stats.late_packets, (unsigned long long)stats.underruns,
+				(unsigned long long)stats.skipped_frames, stats.jitter_frames, stats.delay_frames, gaps, errors);
+		}
+
+		deadline.tv_nsec += (long)c_period * 1000000000L / c_sample_rate;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_nsec -= 1000000000L;
+			++deadline.tv_sec;
+		}
+		while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL))
+			;
+	}
+
+	release();
+	rtp_receiver_release();
+
+	printf("heard %ld of %d frames\n", heard, nperiods * c_period);
+	return errors ? 1 : 0;
+}
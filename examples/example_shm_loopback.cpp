@@ -0,0 +1,206 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// The shm driver across a fork: a child process renders a counting signal
+// through the shm driver, and the parent plays the ring with the shm host
+// at the device rate, checking that everything it hears is in order and
+// timing how long the renderer takes to refill a period once the host has
+// freed it. Halfway through the child is killed and a new one attached.
+//
+//     shm_loopback [seconds]
+
+#include <errno.h>
+#include <math.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_shm.h>
+#include "tinyaudio_shm_ring.h"
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_period = 256;
+static const int c_nperiods = 3;
+
+static short g_count;
+
+#if TINYAUDIO_FLOAT_BUS
+static sample_type to_sample(short count) { return count * (1.0f / 32768.0f); }
+static short from_sample(sample_type s) { return (short)lrintf(s * 32768.0f); }
+#else
+static sample_type to_sample(short count) { return count; }
+static short from_sample(sample_type s) { return s; }
+#endif
+
+// left counts up, right is its negation
+static void generate_samples(sample_type* samples, int nsamples)
+{
+	for (; nsamples; --nsamples, samples += 2) {
+		if (++g_count == 0) // keep silence unambiguous
+			g_count = 1;
+		samples[0] = to_sample(g_count);
+		samples[1] = to_sample((short)-g_count);
+	}
+}
+
+static uint64_t now_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Forks a renderer and attaches its ring; returns the child's pid, or -1
+static pid_t start_renderer(ShmRing** ring)
+{
+	int sv[2];
+	if (0 != socketpair(AF_UNIX, SOCK_STREAM, 0, sv))
+		return -1;
+
+	const pid_t pid = fork();
+	if (pid == 0) {
+		close(sv[0]);
+		set_shm_buffer(c_period, c_nperiods);
+		if (!init(c_sample_rate, &generate_samples) || !shm_send(sv[1], shm_memfd(), shm_eventfd()))
+			_exit(1);
+		for (;;)
+			pause();
+	}
+
+	close(sv[1]);
+	int memfd, eventfd;
+	const bool received = (pid > 0) && shm_receive(sv[0], &memfd, &eventfd);
+	close(sv[0]);
+	if (!received)
+		return -1;
+
+	// our own view of the ring, to see when the renderer writes
+	*ring = shm_map(memfd, shm_ring_bytes(c_period, c_nperiods));
+	if (!*ring || !shm_host_attach(dup(memfd), dup(eventfd), c_sample_rate)) {
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+		return -1;
+	}
+
+	close(memfd);
+	close(eventfd);
+	return pid;
+}
+
+static void stop_renderer(pid_t pid, ShmRing* ring)
+{
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	shm_unmap(ring, shm_ring_bytes(c_period, c_nperiods));
+}
+
+int main(int argc, char** argv)
+{
+	const int seconds = (argc > 1) ? atoi(argv[1]) : 5;
+	const int nperiods = seconds * c_sample_rate / c_period;
+
+	ShmRing* ring;
+	pid_t pid = start_renderer(&ring);
+	if (pid < 0) {
+		fprintf(stderr, "Failed to start the renderer\n");
+		return -1;
+	}
+
+	sample_type samples[2 * c_period];
+	short expected = 0; // next count, once we have heard one
+	long heard = 0, gaps = 0, errors = 0;
+	uint64_t total_ns = 0, worst_ns = 0;
+	int nrefills = 0;
+
+	timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	for (int p = 1; p <= nperiods; ++p) {
+		if (p == nperiods / 2) {
+			stop_renderer(pid, ring);
+			pid = start_renderer(&ring);
+			if (pid < 0) {
+				fprintf(stderr, "Failed to restart the renderer\n");
+				return -1;
+			}
+			expected = 0; // the new renderer counts from the start
+		}
+
+		const uint64_t written = ring->write_pos.load();
+		const uint64_t start = now_ns();
+		shm_host_render(samples, c_period);
+
+		// the host freed a period; wait for the renderer to fill it
+		if (written >= (uint64_t)c_period * c_nperiods) {
+			while (ring->write_pos.load() == written && now_ns() - start < 20000000)
+				sched_yield();
+			const uint64_t elapsed = now_ns() - start;
+			total_ns += elapsed;
+			if (elapsed > worst_ns)
+				worst_ns = elapsed;
+			++nrefills;
+		}
+
+		for (int i = 0; i < c_period; ++i) {
+			const short s = from_sample(samples[2 * i]);
+			if (s) {
+				if (expected && s != expected)
+					++gaps;
+				expected = (short)(s + 1);
+				if (!expected)
+					expected = 1;
+				if (from_sample(samples[2 * i + 1]) != (short)-s)
+					++errors;
+				++heard;
+			}
+		}
+
+		deadline.tv_nsec += (long)c_period * 1000000000L / c_sample_rate;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_nsec -= 1000000000L;
+			++deadline.tv_sec;
+		}
+		while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL))
+			;
+	}
+
+	stop_renderer(pid, ring);
+	shm_host_detach();
+
+	printf("heard %ld of %d frames, gaps %ld, errors %ld, underruns %llu\n", heard, nperiods * c_period,
+		gaps, errors, (unsigned long long)shm_host_underruns());
+	if (nrefills) {
+		printf("refill after the host freed a period: avg %.1f us, worst %.1f us (period %.1f us)\n",
+			total_ns / 1000.0 / nrefills, worst_ns / 1000.0, c_period * 1000000.0 / c_sample_rate);
+	}
+	return (gaps || errors) ? 1 : 0;
+}
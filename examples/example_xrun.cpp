@@ -0,0 +1,277 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Finds how much callback CPU time fits in a period on this machine before
+// the device glitches. For each latency setting the callback burns a
+// calibrated share of the period, stepping the load up until the driver
+// reports an underrun, and prints what it measured at every point followed
+// by the safe load envelope.
+//
+//     xrun [seconds_per_point] [load_step_percent]
+//
+// Jitter is the spread of callback start times around the nominal period.
+// Backend CPU is what the audio thread itself spends outside the callback
+// each period; work a sound server does in its own process is not counted.
+
+#include <atomic>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <TINYAUDIO/tinyaudio.h>
+#include <TINYAUDIO/tinyaudio_latency.h>
+#include <TINYAUDIO/tinyaudio_stats.h>
+
+using namespace tinyaudio;
+
+static const int c_sample_rate = 48000;
+static const int c_latencies[] = { 128, 256, 512, 1024, 2048, 4096 };
+static const int c_nlatencies = (int)(sizeof(c_latencies) / sizeof(c_latencies[0]));
+static const int c_warmup_ms = 300;
+
+static double g_ns_per_iteration;
+static volatile float g_sink;
+
+static std::atomic<int> g_period_frames;
+static std::atomic<int> g_latency_frames;
+
+static std::atomic<bool> g_measuring;
+static std::atomic<int> g_work_iterations;
+
+// written by the audio thread, read after release
+static uint64_t g_last_entry_ns;
+static uint64_t g_last_exit_cpu_ns;
+static uint64_t g_callbacks;
+static uint64_t g_callback_ns;
+static uint64_t g_backend_cpu_ns;
+static double g_jitter_sum_sq;
+static uint64_t g_jitter_max_ns;
+
+struct Point {
+	int period;
+	int latency;
+	int load; // percent of the period
+	uint64_t underruns;
+	double callback_us;
+	double jitter_rms_us;
+	double jitter_max_us;
+	double backend_us;
+};
+
+static uint64_t now_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t thread_cpu_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// A dependent chain of multiply-adds: steady, frequency-bound CPU work that
+// the compiler cannot shorten
+static void burn(int iterations)
+{
+	float x = g_sink;
+	for (int ii = 0; ii < iterations; ++ii)
+		x = x * 0.999f + 0.001f;
+	g_sink = x;
+}
+
+static void calibrate()
+{
+	static const int c_iterations = 2000000;
+	uint64_t best = ~0ULL;
+	for (int ii = 0; ii < 7; ++ii) {
+		const uint64_t start = now_ns();
+		burn(c_iterations);
+		const uint64_t elapsed = now_ns() - start;
+		if (elapsed < best)
+			best = elapsed;
+	}
+
+	g_ns_per_iteration = (double)best / c_iterations;
+}
+
+static void on_latency(int period_frames, int latency_frames)
+{
+	g_period_frames.store(period_frames);
+	g_latency_frames.store(latency_frames);
+}
+
+static void load_callback(sample_type* samples, int nsamples)
+{
+	const uint64_t entry = now_ns();
+	const uint64_t entry_cpu = thread_cpu_ns();
+
+	if (g_measuring && g_last_entry_ns) {
+		const uint64_t nominal = (uint64_t)nsamples * 1000000000ULL / c_sample_rate;
+		const uint64_t interval = entry - g_last_entry_ns;
+		const uint64_t deviation = (interval > nominal) ? interval - nominal : nominal - interval;
+		g_jitter_sum_sq += (double)deviation * (double)deviation;
+		if (deviation > g_jitter_max_ns)
+			g_jitter_max_ns = deviation;
+
+		g_backend_cpu_ns += entry_cpu - g_last_exit_cpu_ns;
+		++g_callbacks;
+	}
+
+	memset(samples, 0, sizeof(sample_type) * 2 * nsamples);
+	burn(g_work_iterations.load(std::memory_order_relaxed));
+
+	const uint64_t exit = now_ns();
+	if (g_measuring)
+		g_callback_ns += exit - entry;
+	g_last_entry_ns = entry;
+	g_last_exit_cpu_ns = thread_cpu_ns();
+}
+
+// Run one point. Returns false if the driver failed or never called back.
+static bool run_point(int latency, int load, int seconds, Point* point)
+{
+	g_period_frames.store(0);
+	g_measuring.store(false);
+	g_last_entry_ns = 0;
+	g_callbacks = 0;
+	g_callback_ns = 0;
+	g_backend_cpu_ns = 0;
+	g_jitter_sum_sq = 0.0;
+	g_jitter_max_ns = 0;
+
+	set_latency_limits(latency, latency);
+	set_latency_callback(&on_latency);
+
+	// the period is only known once the driver reports it; start idle
+	g_work_iterations.store(0);
+	if (!init(c_sample_rate, &load_callback)) {
+		fprintf(stderr, "Failed to initialize audio device: %s\n", last_error());
+		return false;
+	}
+
+	usleep(c_warmup_ms * 1000);
+	const int period = g_period_frames.load();
+	if (!period) {
+		release();
+		fprintf(stderr, "The driver did not start calling back\n");
+		return false;
+	}
+
+	const double period_ns = (double)period * 1e9 / c_sample_rate;
+	g_work_iterations.store((int)(period_ns * load / 100.0 / g_ns_per_iteration));
+	usleep(c_warmup_ms * 1000);
+
+	driver_stats before;
+	read_driver_stats(&before);
+	g_measuring.store(true);
+	usleep(seconds * 1000000);
+	g_measuring.store(false);
+	driver_stats after;
+	read_driver_stats(&after);
+	release();
+
+	const double callbacks = g_callbacks ? (double)g_callbacks : 1.0;
+	point->period = period;
+	point->latency = g_latency_frames.load();
+	point->load = load;
+	point->underruns = after.underruns - before.underruns;
+	point->callback_us = g_callback_ns / callbacks / 1e3;
+	point->jitter_rms_us = sqrt(g_jitter_sum_sq / callbacks) / 1e3;
+	point->jitter_max_us = g_jitter_max_ns / 1e3;
+	point->backend_us = g_backend_cpu_ns / callbacks / 1e3;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	const int seconds = (argc > 1) ? atoi(argv[1]) : 2;
+	const int step = (argc > 2) ? atoi(argv[2]) : 10;
+	if (seconds < 1 || step < 1 || step > 100) {
+		fprintf(stderr, "usage: xrun [seconds_per_point] [load_step_percent]\n");
+		return -1;
+	}
+
+	calibrate();
+	printf("%d Hz, %d s per point, load steps of %d%%\n\n", c_sample_rate, seconds, step);
+	printf("period  latency  load  callback_us  underruns  jitter_rms_us  jitter_max_us  backend_us\n");
+	fflush(stdout);
+
+	Point safe[c_nlatencies];
+	int nsafe = 0;
+	int last_period = 0;
+
+	for (int ii = 0; ii < c_nlatencies; ++ii) {
+		Point best;
+		best.load = 0;
+		best.period = 0;
+
+		for (int load = step; load <= 100; load += step) {
+			Point point;
+			if (!run_point(c_latencies[ii], load, seconds, &point))
+				return -1;
+
+			// drivers without a configurable period (JACK) repeat the
+			// same one; measure it once
+			if (point.period == last_period && load == step)
+				break;
+
+			printf("%6d  %7d  %3d%%  %11.1f  %9llu  %13.1f  %13.1f  %10.1f\n",
+				point.period, point.latency, point.load, point.callback_us,
+				(unsigned long long)point.underruns, point.jitter_rms_us,
+				point.jitter_max_us, point.backend_us);
+			fflush(stdout);
+
+			if (point.underruns) {
+				if (!best.period) {
+					best = point;
+					best.load = 0;
+				}
+				break;
+			}
+			best = point;
+		}
+
+		if (best.period && best.period != last_period) {
+			safe[nsafe++] = best;
+			last_period = best.period;
+		}
+	}
+
+	printf("\nsafe load envelope (no underruns)\n");
+	printf("period  latency  period_us  safe_load  callback_budget_us\n");
+	for (int ii = 0; ii < nsafe; ++ii) {
+		const double period_us = (double)safe[ii].period * 1e6 / c_sample_rate;
+		printf("%6d  %7d  %9.1f  %8d%%  %18.1f\n", safe[ii].period, safe[ii].latency,
+			period_us, safe[ii].load, period_us * safe[ii].load / 100.0);
+	}
+
+	return 0;
+}
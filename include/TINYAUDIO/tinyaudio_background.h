@@ -0,0 +1,193 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_BACKGROUND_H
+#define TINYAUDIO_BACKGROUND_H
+
+// Background jobs on the audio thread: small, preemptible pieces of work
+// (decoding the next chunk of a stream, say) that the ALSA, pulse and
+// (paced) null drivers run in the idle time left in each period instead
+// of waking another thread for them.
+//
+// After the period is written the driver works out how long it has before
+// it must be back waiting on the device, keeps a safety margin of that
+// free, and calls the jobs round-robin until the rest is used up. A job
+// does one slice of work per call and returns true while it has more; the
+// driver stops between slices, so a slice has to be short (tens of
+// microseconds) and, like the callback, must not block or allocate. The
+// budget offered and the time used show up in driver_stats.
+//
+// Header-only so every driver .cpp can keep being compiled on its own.
+
+#include <atomic>
+#include <sched.h>
+#include <stdint.h>
+#include <time.h>
+
+namespace tinyaudio {
+
+typedef bool (*background_job)(void* context);
+
+static const int c_nmaxbackground = 8;
+static const float c_default_background_margin = 0.25f;
+
+struct background_state {
+	std::atomic<int> claimed[c_nmaxbackground];
+	std::atomic<background_job> jobs[c_nmaxbackground];
+	void* contexts[c_nmaxbackground];
+	std::atomic<int> busy; // audio thread is running jobs
+	std::atomic<float> margin; // fraction of the period kept free
+	std::atomic<uint64_t> budget_ns;
+	std::atomic<uint64_t> used_ns;
+	int next; // audio thread only: round-robin start
+
+	background_state()
+		: busy(0)
+		, margin(c_default_background_margin)
+		, budget_ns(0)
+		, used_ns(0)
+		, next(0)
+	{
+		for (int ii = 0; ii < c_nmaxbackground; ++ii) {
+			claimed[ii].store(0);
+			jobs[ii].store(0);
+			contexts[ii] = 0;
+		}
+	}
+};
+
+inline background_state* background_settings()
+{
+	static background_state state;
+	return &state;
+}
+
+// Returns false when all c_nmaxbackground slots are taken
+inline bool add_background_job(background_job job, void* context)
+{
+	background_state* state = background_settings();
+	for (int ii = 0; ii < c_nmaxbackground; ++ii) {
+		if (!state->claimed[ii].exchange(1)) {
+			state->contexts[ii] = context;
+			state->jobs[ii].store(job, std::memory_order_release);
+			return true;
+		}
+	}
+	return false;
+}
+
+// When this returns the job is not running and will not be called again
+inline void remove_background_job(background_job job, void* context)
+{
+	background_state* state = background_settings();
+	for (int ii = 0; ii < c_nmaxbackground; ++ii) {
+		if (state->jobs[ii].load() == job && state->contexts[ii] == context) {
+			state->jobs[ii].store(0);
+			while (state->busy.load())
+				sched_yield();
+			state->claimed[ii].store(0);
+			return;
+		}
+	}
+}
+
+// Fraction of each period left free for wakeup jitter, 0..1 (default 0.25)
+inline void set_background_margin(float margin)
+{
+	background_settings()->margin.store(margin);
+}
+
+// Called by the drivers once the period has been handed to the device.
+// slack_end_ns (CLOCK_MONOTONIC) is when the thread has to be waiting on
+// the device again.
+inline void run_background_jobs(uint64_t slack_end_ns, uint64_t period_ns)
+{
+	background_state* state = background_settings();
+	state->busy.fetch_add(1);
+
+	background_job jobs[c_nmaxbackground];
+	void* contexts[c_nmaxbackground];
+	int njobs = 0;
+	for (int ii = 0; ii < c_nmaxbackground; ++ii) {
+		const int slot = (state->next + ii) % c_nmaxbackground;
+		// seq_cst against remove_background_job: either it sees busy, or
+		// we see the cleared slot
+		jobs[njobs] = state->jobs[slot].load();
+		contexts[njobs] = state->contexts[slot];
+		if (jobs[njobs])
+			++njobs;
+	}
+	state->next = (state->next + 1) % c_nmaxbackground;
+
+	const uint64_t margin_ns = (uint64_t)(period_ns * state->margin.load(std::memory_order_relaxed));
+	const uint64_t end = slack_end_ns - margin_ns;
+
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	const uint64_t start = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+
+	if (njobs && slack_end_ns > margin_ns && start < end) {
+		uint64_t now = start;
+		while (njobs && now < end) {
+			for (int ii = 0; ii < njobs && now < end; ) {
+				if (jobs[ii](contexts[ii])) {
+					++ii;
+				} else {
+					// done until next period
+					jobs[ii] = jobs[njobs - 1];
+					contexts[ii] = contexts[njobs - 1];
+					--njobs;
+				}
+				clock_gettime(CLOCK_MONOTONIC, &ts);
+				now = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+			}
+		}
+
+		state->budget_ns.fetch_add(end - start, std::memory_order_relaxed);
+		state->used_ns.fetch_add(now - start, std::memory_order_relaxed);
+	}
+
+	state->busy.fetch_sub(1);
+}
+
+// Totals since the driver started, for read_driver_stats
+inline void read_background_stats(uint64_t* budget_ns, uint64_t* used_ns)
+{
+	background_state* state = background_settings();
+	*budget_ns = state->budget_ns.load(std::memory_order_relaxed);
+	*used_ns = state->used_ns.load(std::memory_order_relaxed);
+}
+
+inline void reset_background_stats()
+{
+	background_state* state = background_settings();
+	state->budget_ns.store(0);
+	state->used_ns.store(0);
+}
+
+}
+
+#endif
@@ -0,0 +1,90 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_BANK_H
+#define TINYAUDIO_BANK_H
+
+#include <stddef.h>
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Sound bank: many short sounds in one file whose layout is used in place.
+// Opening a bank maps (or adopts) the bytes, checks the header and locks
+// them in memory; there is no per-sound parsing or unpacking.
+//
+// Sounds are stored as 16-bit PCM or IMA-ADPCM (about 3.9x smaller). ADPCM
+// sounds are cut into independent blocks of bank_block_frames frames, which
+// are the seek points: decoding can start at any frame. A voice that keeps
+// a bank_cursor carries the decoder state from one call to the next, so
+// playing a sound a period at a time decodes each frame once; without one,
+// a range starting mid-block decodes that block again from its start.
+
+enum bank_codec {
+	bank_pcm16,
+	bank_adpcm,
+};
+
+struct bank_sound {
+	const short* samples; // interleaved
+	int nframes;
+	int channels; // 1 or 2
+	bank_codec codec;
+};
+
+struct bank;
+
+static const int bank_block_frames = 256;
+
+// Decoder state of one voice; zero it before the first call. Internal.
+struct bank_cursor {
+	const void* sound;
+	int frame; // next frame it can continue from
+	int pred[2];
+	int index[2];
+};
+
+// Build a bank file from PCM sounds, encoding the ADPCM ones
+bool bank_write(const char* path, const bank_sound* sounds, int nsounds);
+
+const bank* bank_open(const char* path);
+const bank* bank_open_memory(const void* data, size_t size); // data must outlive the bank, 8-byte aligned
+void bank_close(const bank* b);
+
+int bank_sound_count(const bank* b);
+int bank_sound_frames(const bank* b, int sound);
+int bank_sound_channels(const bank* b, int sound);
+size_t bank_bytes(const bank* b);
+
+// Decode frames [frame, frame + nframes) of a sound as stereo into the bus
+// format; mono sounds go to both channels. Safe to call from the audio
+// thread. Returns the number of frames written (short at the end of the
+// sound, 0 for a sound index out of range). cursor may be NULL.
+int bank_decode(const bank* b, int sound, int frame, sample_type* out, int nframes, bank_cursor* cursor = NULL);
+
+}
+
+#endif
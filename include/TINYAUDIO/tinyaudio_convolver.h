@@ -0,0 +1,61 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_CONVOLVER_H
+#define TINYAUDIO_CONVOLVER_H
+
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Convolution of the output bus with a long impulse response (reverb,
+// speaker correction), with no added latency (POSIX).
+//
+// The first block_frames taps run as a direct-form FIR; the rest of the
+// response is cut into uniform partitions of block_frames taps convolved in
+// the frequency domain (overlap-save), so each partition's result is ready
+// exactly when the FIR head runs out. With `worker` set, a second thread
+// accumulates the older partitions during the period; the audio thread
+// then only transforms the newest block, and computes the tail itself if
+// the worker is late (see convolver_worker_misses).
+//
+// The output is the wet signal only; put a unit tap at 0 in the response
+// to keep the dry signal. convolver_render is a samples_callback:
+//
+//     tinyaudio::convolver_init(&render, ir, ir, ir_frames, 128, true);
+//     tinyaudio::init(48000, &tinyaudio::convolver_render);
+
+// ir_right may equal ir_left. block_frames is rounded up to a power of two
+// between 16 and 1024.
+bool convolver_init(samples_callback render, const float* ir_left, const float* ir_right, int ir_frames, int block_frames, bool worker);
+void convolver_release();
+void convolver_render(sample_type* samples, int nsamples);
+
+unsigned convolver_worker_misses();
+
+}
+
+#endif
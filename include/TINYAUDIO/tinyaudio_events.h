@@ -0,0 +1,72 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_EVENTS_H
+#define TINYAUDIO_EVENTS_H
+
+#include <stdint.h>
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Sample-accurate events into the audio thread.
+//
+// Any thread may post events stamped with a frame on the stream clock (the
+// number of frames rendered since events_init). The audio thread splits each
+// block at event boundaries: your event callback sees every event in frame
+// order right before the first frame it applies to, and your samples
+// callback renders the frames in between.
+//
+// events_render is itself a samples_callback; hand it to init (or
+// renderahead_init):
+//
+//     tinyaudio::events_init(&render, &handle_event);
+//     tinyaudio::init(44100, &tinyaudio::events_render);
+
+struct event {
+	uint64_t frame;
+	int type;
+	int param;
+	float value;
+	void* data;
+};
+
+// `late` is set when the event's frame had already been rendered by the
+// time the audio thread saw it; it is delivered at the start of the block.
+typedef void (*event_callback)(const event* ev, bool late);
+
+void events_init(samples_callback render, event_callback on_event);
+void events_render(sample_type* samples, int nsamples);
+
+// Safe from any thread, never blocks. Returns false if the queue is full.
+bool post_event(const event* ev);
+
+uint64_t events_stream_frame();
+unsigned events_late();
+
+}
+
+#endif
@@ -0,0 +1,193 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_FUSED_H
+#define TINYAUDIO_FUSED_H
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_simd.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+namespace tinyaudio {
+
+// Header-only render loop specialized on a processor type, for callers who
+// want their DSP inlined into the loop that writes the device buffer.
+// Processors are written against the vfloat layer in tinyaudio_simd.h.
+//
+// A samples_callback renders into the buffer and anything past that is a
+// separate pass. A fused_backend<P> instead calls P's members directly, so
+// the processor, the clamp and the conversion to the output format compile
+// into one vector loop with no intermediate float buffer. The processor
+// declares its shape at compile time:
+//
+//     struct Tone {
+//         static constexpr int channels = 1; // 1 (copied to both) or 2
+//         static constexpr int block_frames = 64; // multiple of c_simd_width
+//         typedef sample_type sample; // float or int16_t output
+//
+//         void block(); // control-rate work, once every block_frames
+//         void next(vfloat* out); // c_simd_width frames of each channel, [-1, 1]
+//     };
+//
+// fused_init plays a processor through the driver the way init plays a
+// callback; its sample must then be the bus format:
+//
+//     static Tone tone;
+//     tinyaudio::fused_init(44100, &tone);
+
+template<typename Processor>
+class fused_backend {
+public:
+	typedef typename Processor::sample sample;
+
+	static_assert(Processor::channels == 1 || Processor::channels == 2, "processors render mono or stereo");
+	static_assert(Processor::block_frames > 0 && Processor::block_frames % c_simd_width == 0,
+		"block_frames must be a multiple of the vector width");
+	static_assert(std::is_same<sample, float>::value || std::is_same<sample, int16_t>::value,
+		"processors output float or int16_t");
+
+	fused_backend()
+		: m_processor(0)
+		, m_block_left(0)
+		, m_ncarry(0)
+	{
+	}
+
+	void reset(Processor* processor)
+	{
+		m_processor = processor;
+		m_block_left = 0;
+		m_ncarry = 0;
+	}
+
+	// Render nframes interleaved stereo frames
+	void render(sample* out, int nframes)
+	{
+		// frames left over from the last call's partial vector
+		const int ncarried = (m_ncarry < nframes) ? m_ncarry : nframes;
+		memcpy(out, m_carry + (c_simd_width - m_ncarry) * 2, sizeof(sample) * 2 * ncarried);
+		m_ncarry -= ncarried;
+		out += ncarried * 2;
+		nframes -= ncarried;
+
+		// work on a copy so the state can stay in registers; out may alias
+		// the caller's processor as far as the compiler knows
+		Processor processor = *m_processor;
+		int block_left = m_block_left;
+
+		while (nframes >= c_simd_width) {
+			if (!block_left) {
+				processor.block();
+				block_left = Processor::block_frames;
+			}
+
+			int nvec = nframes & ~(c_simd_width - 1);
+			if (nvec > block_left)
+				nvec = block_left;
+			block_left -= nvec;
+			nframes -= nvec;
+
+			for (const sample* end = out + nvec * 2; out != end; out += c_simd_width * 2)
+				store(out, processor);
+		}
+
+		// render a whole vector and keep what does not fit for next time
+		if (nframes > 0) {
+			if (!block_left) {
+				processor.block();
+				block_left = Processor::block_frames;
+			}
+			block_left -= c_simd_width;
+
+			store(m_carry, processor);
+			memcpy(out, m_carry, sizeof(sample) * 2 * nframes);
+			m_ncarry = c_simd_width - nframes;
+		}
+
+		*m_processor = processor;
+		m_block_left = block_left;
+	}
+
+private:
+	static inline void store(sample* out, Processor& processor)
+	{
+		vfloat v[Processor::channels];
+		processor.next(v);
+
+		const vfloat one = vset1(1.0f);
+		const vfloat minus_one = vset1(-1.0f);
+		const vfloat l = vmax(vmin(v[0], one), minus_one);
+		const vfloat r = (Processor::channels == 2) ? vmax(vmin(v[Processor::channels - 1], one), minus_one) : l;
+		write(out, l, r);
+	}
+
+	static inline void write(float* out, vfloat l, vfloat r)
+	{
+		vstore_stereo(out, l, r);
+	}
+
+	static inline void write(int16_t* out, vfloat l, vfloat r)
+	{
+		const vfloat scale = vset1(32767.0f);
+		vstore_stereo_s16(out, vmul(l, scale), vmul(r, scale));
+	}
+
+	Processor* m_processor;
+	int m_block_left; // frames before the next block()
+	int m_ncarry;
+	sample m_carry[c_simd_width * 2];
+};
+
+template<typename Processor>
+struct fused_instance {
+	static fused_backend<Processor> backend;
+
+	static void render(sample_type* samples, int nsamples)
+	{
+		backend.render(samples, nsamples);
+	}
+};
+
+template<typename Processor>
+fused_backend<Processor> fused_instance<Processor>::backend;
+
+// Call before any other driver is started; release() stops it as usual
+template<typename Processor>
+bool fused_init(int sample_rate, Processor* processor)
+{
+	static_assert(std::is_same<typename Processor::sample, sample_type>::value,
+		"the driver plays the bus format");
+
+	fused_instance<Processor>::backend.reset(processor);
+	return init(sample_rate, &fused_instance<Processor>::render);
+}
+
+}
+
+#endif
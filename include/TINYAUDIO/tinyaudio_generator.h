@@ -0,0 +1,106 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_GENERATOR_H
+#define TINYAUDIO_GENERATOR_H
+
+#include "TINYAUDIO/tinyaudio.h"
+
+#include <stdint.h>
+
+namespace tinyaudio {
+
+// Test signals and tones (src/tinyaudio_generator.cpp), filled a whole
+// block at a time with SIMD kernels, straight into the bus format with the
+// same signal on both channels.
+//
+// Tones keep their phase in double precision and evaluate each vector of
+// samples from it, so they do not drift however long they run. Saw and
+// square are band-limited with PolyBLEP. A tone with an end_frequency
+// sweeps exponentially to it over sweep_seconds and starts again.
+//
+// generator_render plays the module's own generator as a samples_callback:
+//
+//     tinyaudio::generator_settings settings = tinyaudio::generator_default_settings();
+//     tinyaudio::generator_init(48000, &settings);
+//     tinyaudio::init(48000, &tinyaudio::generator_render);
+
+enum generator_waveform {
+	generator_sine,
+	generator_saw,
+	generator_square,
+	generator_white, // uniform white noise
+	generator_pink,  // white noise through a -3 dB/octave filter
+};
+
+struct generator_settings {
+	generator_waveform waveform;
+	float gain; // peak level, 0..1
+	float frequency; // Hz; unused by noise
+	float end_frequency; // sweep to this; 0 for a steady tone
+	float sweep_seconds;
+	uint32_t seed; // noise
+};
+
+// 440 Hz sine at half scale
+inline generator_settings generator_default_settings()
+{
+	generator_settings settings;
+	settings.waveform = generator_sine;
+	settings.gain = 0.5f;
+	settings.frequency = 440.0f;
+	settings.end_frequency = 0.0f;
+	settings.sweep_seconds = 10.0f;
+	settings.seed = 1;
+	return settings;
+}
+
+// One generator's state; owned by the caller, fields are internal
+struct generator {
+	generator_waveform waveform;
+	float gain;
+	double phase; // cycles, [0, 1) between fills
+	double increment; // cycles per frame
+	double start_increment;
+	double sweep_ratio; // increment multiplier per frame; 1 for a steady tone
+	int sweep_frames;
+	int sweep_left;
+	double offsets[9]; // phase of frame j of a vector, in increments
+	double ratios[9]; // sweep_ratio^j
+	uint32_t noise[8];
+	float pink[3];
+};
+
+void generator_reset(generator* g, int sample_rate, const generator_settings* settings);
+void generator_fill(generator* g, sample_type* samples, int nframes);
+
+// The module's own generator. Set it up before starting the driver.
+void generator_init(int sample_rate, const generator_settings* settings);
+void generator_render(sample_type* samples, int nsamples);
+
+}
+
+#endif
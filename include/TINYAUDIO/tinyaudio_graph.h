@@ -0,0 +1,67 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_GRAPH_H
+#define TINYAUDIO_GRAPH_H
+
+#include <stdint.h>
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Parallel render graph (Linux).
+//
+// Declare nodes and edges once, then hand graph_render to init. Every
+// period the audio thread and a pool of pinned, spinning worker threads run
+// the graph: a node becomes ready once all of its inputs have rendered, and
+// idle workers steal ready nodes from each other. The audio thread waits for
+// the whole graph before converting the output node to the bus format.
+//
+// Node buffers are interleaved stereo float. `inputs` holds the outputs of
+// the node's upstream nodes, in the order the edges were added. nframes is
+// at most graph_max_frames().
+
+typedef void (*graph_process)(void* context, const float* const* inputs, int ninputs, float* output, int nframes);
+typedef int graph_node;
+
+// nthreads counts the audio thread, so 1 means no workers
+bool graph_init(int nthreads, int max_nodes);
+void graph_release();
+
+// Build the graph before compiling it. Returns -1 / false on failure.
+graph_node graph_add_node(graph_process process, void* context);
+bool graph_connect(graph_node from, graph_node to);
+bool graph_set_output(graph_node node);
+bool graph_compile(); // false if the graph has a cycle
+
+void graph_render(sample_type* samples, int nsamples);
+
+int graph_max_frames();
+uint64_t graph_node_time_ns(graph_node node); // time spent in the node's last run
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_JACK_H
+#define TINYAUDIO_JACK_H
+
+namespace tinyaudio {
+
+// JACK driver configuration; call before init.
+//
+// The samples callback runs inside the JACK process callback, so the
+// period is whatever buffer size the server runs at (reported, like every
+// later change, through set_latency_callback) and set_latency_limits has
+// no effect.
+
+void set_jack_client_name(const char* name);
+
+// Connect our ports to the first two physical playback ports (default on)
+void set_jack_autoconnect(bool connect);
+
+// The server's sample rate wins. Without this callback, init fails if it
+// differs from the rate asked for; with it, init succeeds and the callback
+// gets the real rate, then every later change (from a JACK thread).
+typedef void (*sample_rate_callback)(int sample_rate);
+void set_jack_sample_rate_callback(sample_rate_callback callback);
+
+}
+
+#endif
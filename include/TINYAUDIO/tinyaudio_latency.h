@@ -0,0 +1,50 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_LATENCY_H
+#define TINYAUDIO_LATENCY_H
+
+namespace tinyaudio {
+
+// Adaptive buffer sizing (ALSA, pulse and null drivers).
+//
+// By default the drivers use a fixed period. Once limits are set, the driver
+// starts at the lowest latency and doubles its period after every underrun
+// (or when the callback eats most of a period), then steps back down after a
+// sustained stable window. Limits are in frames of total device latency and
+// must be set before init.
+void set_latency_limits(int min_frames, int max_frames);
+
+// Called from the audio thread whenever the driver (re)configures the device,
+// including the initial configuration. period_frames is the nsamples you will
+// see in your samples_callback from now on; latency_frames is the total
+// amount of audio buffered ahead of the speakers.
+typedef void (*latency_callback)(int period_frames, int latency_frames);
+void set_latency_callback(latency_callback callback);
+
+}
+
+#endif
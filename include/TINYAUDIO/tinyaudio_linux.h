@@ -0,0 +1,52 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_LINUX_H
+#define TINYAUDIO_LINUX_H
+
+namespace tinyaudio {
+
+// Runtime driver selection (src/tinyaudio_linux.cpp).
+//
+// Build tinyaudio_linux.cpp instead of a single Linux driver and init tries
+// each driver on a preference list in turn, keeping the first that starts.
+// A driver's system library is only loaded (dlopen) when that driver is
+// tried, so the binary links none of them and runs on hosts that lack
+// some or all of them.
+//
+// The list is comma separated, from "pipewire", "pulse", "alsa" and "null".
+// The TINYAUDIO_DRIVER environment variable overrides it; the default is
+// "pipewire,pulse,alsa,null". Driver settings (set_latency_limits,
+// set_pulse_application_name, ...) apply to whichever driver is picked.
+
+void set_driver_preference(const char* names);
+
+// Name of the driver init picked, or NULL
+const char* driver_name();
+
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_LOOPBACK_H
+#define TINYAUDIO_LOOPBACK_H
+
+#include "TINYAUDIO/tinyaudio.h"
+
+#include <stdint.h>
+
+namespace tinyaudio {
+
+// Loopback test driver (src/tinyaudio_loopback.cpp).
+//
+// Plays into a simulated device instead of sound hardware: a buffer of two
+// periods drained at the wall-clock rate. Everything the device would play
+// is captured, including the silence it plays when a period arrives too
+// late, so a test can check the output without anyone listening. The period
+// is half of the set_latency_limits minimum (256 frames by default).
+
+// Where a block landed in the capture and when it was heard
+struct loopback_block {
+	uint64_t frame;       // capture position of the block's first frame
+	uint64_t callback_ns; // CLOCK_MONOTONIC at callback entry
+	uint64_t output_ns;   // when the first frame plays, on the stream clock
+	int nframes;
+};
+
+// Capture into your buffers, from init until they are full. Set before init.
+void set_loopback_capture(sample_type* samples, int max_frames, loopback_block* blocks, int max_blocks);
+
+// How much of the buffers has been filled so far. Safe to call while the
+// driver runs; everything below the returned counts is complete.
+void loopback_captured(int* nframes, int* nblocks);
+
+}
+
+#endif
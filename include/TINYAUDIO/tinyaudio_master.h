@@ -0,0 +1,70 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_MASTER_H
+#define TINYAUDIO_MASTER_H
+
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Master bus chain: DC blocker, look-ahead brickwall limiter and TPDF
+// dither, run on whatever your samples callback produced before the driver
+// converts and writes it.
+//
+// The chain works through the period in chunks of a few dozen frames and
+// runs every stage on a chunk while it is in L1, so the buffer is swept
+// once no matter how many stages are on. It delays the output by
+// master_latency_frames() (one chunk plus the limiter look-ahead).
+//
+// master_render is itself a samples_callback:
+//
+//     tinyaudio::master_init(44100, &render, NULL);
+//     tinyaudio::init(44100, &tinyaudio::master_render);
+
+struct master_settings {
+	float dc_cutoff_hz; // 0 disables the DC blocker
+	float ceiling; // limiter ceiling as linear gain, 0 disables the limiter
+	float lookahead_ms;
+	float release_ms;
+	int dither_bits; // word length to dither for, 0 disables dither
+};
+
+void master_default_settings(master_settings* settings);
+
+// settings may be NULL for the defaults
+bool master_init(int sample_rate, samples_callback render, const master_settings* settings);
+void master_release();
+void master_render(sample_type* samples, int nsamples);
+
+int master_latency_frames();
+
+// Limiter gain applied during the last period (1 = no reduction)
+float master_gain();
+
+}
+
+#endif
@@ -0,0 +1,256 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_MEMORY_H
+#define TINYAUDIO_MEMORY_H
+
+// Memory used by tinyaudio and its optional modules.
+//
+// Everything the library allocates goes through a single allocator that you
+// can replace (set_allocator). Render buffers come from buffer pools: one
+// 64-byte aligned region per driver/module, allocated, pre-faulted and
+// locked in memory at init, so the audio thread never allocates or takes a
+// page fault in steady state.
+//
+// This header is self-contained so every driver .cpp can keep being
+// compiled on its own. On Windows, pools also need
+// src/tinyaudio_memory_win32.cpp, which keeps windows.h out of includers.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#	include <malloc.h>
+#else
+#	include <sys/mman.h>
+#endif
+
+namespace tinyaudio {
+
+static const size_t c_buffer_alignment = 64;
+
+struct allocator {
+	// Must return memory aligned to at least `align` bytes (a power of two)
+	void* (*allocate)(void* context, size_t size, size_t align);
+	void (*deallocate)(void* context, void* ptr, size_t size);
+	void* context;
+};
+
+enum buffer_flags {
+	buffer_huge_pages = 1 << 0, // back pools with huge pages when possible
+	buffer_no_lock = 1 << 1, // skip mlock (pages are still pre-faulted)
+};
+
+struct memory_config {
+	allocator alloc;
+	int flags;
+};
+
+inline memory_config* memory_settings()
+{
+	static memory_config config = { { NULL, NULL, NULL }, 0 };
+	return &config;
+}
+
+// Route all library allocations through `alloc`. Pass NULL to restore the
+// default. Call before init; buffers keep the allocator they came from.
+inline void set_allocator(const allocator* alloc)
+{
+	memory_config* config = memory_settings();
+	if (alloc) {
+		config->alloc = *alloc;
+	} else {
+		config->alloc.allocate = NULL;
+		config->alloc.deallocate = NULL;
+		config->alloc.context = NULL;
+	}
+}
+
+// Combination of buffer_flags applied to pools created after this call
+inline void set_buffer_flags(int flags)
+{
+	memory_settings()->flags = flags;
+}
+
+inline void* allocate(size_t size, size_t align = c_buffer_alignment)
+{
+	const allocator* alloc = &memory_settings()->alloc;
+	if (alloc->allocate)
+		return alloc->allocate(alloc->context, size, align);
+
+#if defined(_WIN32)
+	return _aligned_malloc(size, align);
+#else
+	void* ptr;
+	if (align < sizeof(void*))
+		align = sizeof(void*);
+	if (0 != posix_memalign(&ptr, align, size))
+		return NULL;
+	return ptr;
+#endif
+}
+
+// Free through a particular allocator (a default-constructed one means the
+// built-in one)
+inline void deallocate(const allocator* alloc, void* ptr, size_t size)
+{
+	if (!ptr)
+		return;
+
+	if (alloc->deallocate) {
+		alloc->deallocate(alloc->context, ptr, size);
+		return;
+	}
+
+#if defined(_WIN32)
+	_aligned_free(ptr);
+#else
+	(void)size;
+	free(ptr);
+#endif
+}
+
+inline void deallocate(void* ptr, size_t size)
+{
+	deallocate(&memory_settings()->alloc, ptr, size);
+}
+
+#if defined(_WIN32)
+// VirtualAlloc-backed pages (src/tinyaudio_memory_win32.cpp). map rounds
+// *bytes up to the large page size when it uses large pages.
+char* win32_map_pages(size_t* bytes, bool huge_pages);
+void win32_unmap_pages(void* ptr);
+bool win32_lock_pages(void* ptr, size_t bytes);
+void win32_unlock_pages(void* ptr, size_t bytes);
+#endif
+
+struct buffer_pool {
+	char* base;
+	size_t block_bytes;
+	size_t total_bytes;
+	int nblocks;
+	bool mapped; // came from the OS directly rather than allocate()
+	bool locked;
+	allocator alloc; // the one it was allocated with
+};
+
+// Reserve nblocks blocks of block_bytes each. Every block starts on a
+// 64-byte boundary. Failing to lock the pages (RLIMIT_MEMLOCK) is not an
+// error; failing to allocate them is.
+inline bool pool_create(buffer_pool* pool, size_t block_bytes, int nblocks)
+{
+	const memory_config* config = memory_settings();
+
+	pool->block_bytes = (block_bytes + c_buffer_alignment - 1) & ~(c_buffer_alignment - 1);
+	pool->nblocks = nblocks;
+	pool->total_bytes = pool->block_bytes * nblocks;
+	pool->base = NULL;
+	pool->mapped = false;
+	pool->locked = false;
+	pool->alloc = config->alloc;
+
+	if (!config->alloc.allocate) {
+#if defined(_WIN32)
+		pool->base = win32_map_pages(&pool->total_bytes, 0 != (config->flags & buffer_huge_pages));
+#else
+#	if defined(MAP_HUGETLB)
+		if (config->flags & buffer_huge_pages) {
+			const size_t huge = 2 << 20;
+			const size_t bytes = (pool->total_bytes + huge - 1) & ~(huge - 1);
+			void* ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (ptr != MAP_FAILED) {
+				pool->base = (char*)ptr;
+				pool->total_bytes = bytes;
+			}
+		}
+#	endif
+		if (!pool->base) {
+			void* ptr = mmap(NULL, pool->total_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (ptr != MAP_FAILED)
+				pool->base = (char*)ptr;
+#	if defined(MADV_HUGEPAGE)
+			if (pool->base && (config->flags & buffer_huge_pages))
+				madvise(pool->base, pool->total_bytes, MADV_HUGEPAGE);
+#	endif
+		}
+#endif
+		pool->mapped = (pool->base != NULL);
+	}
+
+	if (!pool->base)
+		pool->base = (char*)allocate(pool->total_bytes, c_buffer_alignment);
+	if (!pool->base)
+		return false;
+
+	if (!(config->flags & buffer_no_lock)) {
+#if defined(_WIN32)
+		pool->locked = win32_lock_pages(pool->base, pool->total_bytes);
+#else
+		pool->locked = (0 == mlock(pool->base, pool->total_bytes));
+#endif
+	}
+
+	// touch every page now rather than on the audio thread
+	memset(pool->base, 0, pool->total_bytes);
+	return true;
+}
+
+inline void pool_destroy(buffer_pool* pool)
+{
+	if (!pool->base)
+		return;
+
+	if (pool->locked) {
+#if defined(_WIN32)
+		win32_unlock_pages(pool->base, pool->total_bytes);
+#else
+		munlock(pool->base, pool->total_bytes);
+#endif
+	}
+
+	if (pool->mapped) {
+#if defined(_WIN32)
+		win32_unmap_pages(pool->base);
+#else
+		munmap(pool->base, pool->total_bytes);
+#endif
+	} else {
+		deallocate(&pool->alloc, pool->base, pool->total_bytes);
+	}
+
+	pool->base = NULL;
+}
+
+inline void* pool_block(const buffer_pool* pool, int index)
+{
+	return pool->base + pool->block_bytes * index;
+}
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_METER_H
+#define TINYAUDIO_METER_H
+
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Output tap for level meters and spectrum displays.
+//
+// Each period the audio thread makes one pass over the output for peak and
+// RMS and copies it into a triple buffer of the most recent window_frames
+// frames. UI threads read both without locks and without ever making the
+// audio thread wait. Levels can be read from any thread; the window has a
+// single reader.
+//
+// meter_render is a samples_callback:
+//
+//     tinyaudio::meter_init(48000, &render, 2048);
+//     tinyaudio::init(48000, &tinyaudio::meter_render);
+
+struct meter_levels {
+	float peak[2]; // highest absolute sample since the previous read
+	float rms[2]; // over roughly the last 300 ms
+};
+
+bool meter_init(int sample_rate, samples_callback render, int window_frames);
+void meter_release();
+void meter_render(sample_type* samples, int nsamples);
+
+void meter_read_levels(meter_levels* levels);
+
+// Copies the newest complete window (window_frames interleaved stereo
+// frames in the bus format). Returns false if no new window was finished
+// since the last call; `frames` then holds the previous one again.
+bool meter_read_window(sample_type* frames);
+int meter_window_frames();
+
+}
+
+#endif
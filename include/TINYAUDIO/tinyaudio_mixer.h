@@ -0,0 +1,63 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_MIXER_H
+#define TINYAUDIO_MIXER_H
+
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Multi-voice mixer that owns the samples callback.
+//
+// Voices play mono float sources (the caller keeps them alive) with
+// per-voice gain and constant-power pan. Gain/pan changes ramp linearly to
+// avoid zipper noise. Voices are summed in float with SIMD kernels and
+// converted to the bus format with saturation at the end.
+//
+// The play/set/stop calls only push a command into a lock-free queue and can
+// be made from any thread; the audio thread applies them at the start of
+// the next block.
+//
+//     tinyaudio::mixer_init(256);
+//     tinyaudio::init(44100, &tinyaudio::mixer_render);
+
+typedef unsigned voice_handle;
+
+bool mixer_init(int max_voices);
+void mixer_release();
+void mixer_render(sample_type* samples, int nsamples);
+
+// Returns 0 when the command queue is full. pan is -1 (left) .. 1 (right).
+voice_handle mixer_play(const float* samples, int nsamples, float gain, float pan, bool loop);
+void mixer_set(voice_handle voice, float gain, float pan, int ramp_frames);
+void mixer_stop(voice_handle voice, int ramp_frames);
+
+int mixer_active_voices();
+
+}
+
+#endif
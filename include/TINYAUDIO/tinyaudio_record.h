@@ -0,0 +1,59 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_RECORD_H
+#define TINYAUDIO_RECORD_H
+
+#include <stdint.h>
+
+namespace tinyaudio {
+
+// Record-while-playing: tees the driver output into a WAV file.
+//
+// Installs an output tap (tinyaudio_tap.h) that only copies each period
+// into a preallocated lock-free ring; a background thread drains the ring
+// to disk in large aligned writes. If the writer falls behind, whole
+// periods are dropped and counted rather than ever stalling the audio
+// thread. The file is 16-bit PCM on the short bus and 32-bit float on the
+// float bus.
+//
+//     tinyaudio::init(48000, &render);
+//     tinyaudio::record_start("session.wav", 48000);
+//     ...
+//     tinyaudio::record_stop();
+
+bool record_start(const char* path, int sample_rate);
+
+// Removes the tap, writes out what is left in the ring and finalizes the
+// header. Returns false if any write failed.
+bool record_stop();
+
+uint64_t record_frames_written();
+uint64_t record_dropped_blocks();
+
+}
+
+#endif
@@ -0,0 +1,59 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_RENDERAHEAD_H
+#define TINYAUDIO_RENDERAHEAD_H
+
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Render-ahead mode runs your callback on a separate render thread that keeps
+// up to `depth` periods of finished audio queued for the device. The device
+// thread only copies queued blocks out, so a slow callback has `depth`
+// periods of slack before it turns into a dropout.
+//
+// Use these in place of init/release. The callback is invoked from the
+// render thread.
+bool renderahead_init(int sample_rate, samples_callback callback, int depth);
+void renderahead_release();
+
+// Number of periods to keep queued. May be changed at any time; clamped to
+// [1, renderahead_max_depth()].
+void renderahead_set_depth(int depth);
+int renderahead_max_depth();
+
+// Drop every queued block (including one being rendered right now). Use this
+// after a seek or stop so the change is audible without waiting for the
+// queue to drain.
+void renderahead_flush();
+
+// Number of times the device thread found the queue empty.
+unsigned renderahead_underruns();
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_RTP_H
+#define TINYAUDIO_RTP_H
+
+#include <stdint.h>
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// RTP/UDP network output (src/tinyaudio_rtp.cpp) and the matching receiver
+// (src/tinyaudio_rtp_receiver.cpp).
+//
+// The driver sends the mix as RTP L16 or L24 stereo (RFC 3551, network byte
+// order). Packets go out paced from the stream clock, burst_packets at a
+// time through one sendmmsg call; each period is exactly one burst. The
+// driver period is fixed, so set_latency_limits has no effect.
+//
+// The receiver is a samples_callback that plays an incoming stream through
+// a local driver from an adaptive jitter buffer:
+//
+//     tinyaudio::rtp_settings settings = tinyaudio::rtp_default_settings();
+//     settings.address = "0.0.0.0";
+//     tinyaudio::rtp_receiver_init(48000, &settings);
+//     tinyaudio::init(48000, &tinyaudio::rtp_receiver_render);
+//
+// loss and jitter_us impair the sender on purpose, for testing the receiver
+// (see examples/example_rtp_loopback.cpp).
+
+enum rtp_encoding {
+	rtp_l16,
+	rtp_l24,
+};
+
+struct rtp_settings {
+	const char* address; // destination for the driver, bind address for the receiver
+	int port;
+	rtp_encoding encoding;
+	int payload_type;
+	int packet_frames; // ptime; both ends must agree
+	int burst_packets; // packets per sendmmsg call
+	int min_delay_frames; // receiver: lower bound on the jitter buffer delay
+	float loss; // sender: fraction of packets dropped at random
+	int jitter_us; // sender: random extra delay of each packet, up to this
+};
+
+// 127.0.0.1:5004, L24, payload type 96, 1 ms packets at 48 kHz, 4 per burst
+inline rtp_settings rtp_default_settings()
+{
+	rtp_settings settings;
+	settings.address = "127.0.0.1";
+	settings.port = 5004;
+	settings.encoding = rtp_l24;
+	settings.payload_type = 96;
+	settings.packet_frames = 48;
+	settings.burst_packets = 4;
+	settings.min_delay_frames = 96;
+	settings.loss = 0.0f;
+	settings.jitter_us = 0;
+	return settings;
+}
+
+// Driver configuration; call before init
+void set_rtp_settings(const rtp_settings* settings);
+
+struct rtp_receiver_stats {
+	uint64_t packets;
+	uint64_t lost_packets; // never arrived in time to be played
+	uint64_t late_packets; // arrived after their playout
+	uint64_t underruns; // buffer ran dry and playout restarted
+	uint64_t skipped_frames; // dropped to bring the delay back down
+	float jitter_frames; // interarrival jitter (RFC 3550)
+	int delay_frames; // current playout delay target
+};
+
+bool rtp_receiver_init(int sample_rate, const rtp_settings* settings);
+void rtp_receiver_release();
+void rtp_receiver_render(sample_type* samples, int nsamples);
+void rtp_receiver_read_stats(rtp_receiver_stats* stats);
+
+}
+
+#endif
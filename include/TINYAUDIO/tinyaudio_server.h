@@ -0,0 +1,76 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_SERVER_H
+#define TINYAUDIO_SERVER_H
+
+#include <stdint.h>
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Headless many-stream server (Linux).
+//
+// Renders thousands of independent streams, each to wherever its callback
+// sends it (a file, a socket), without a sound card or a thread per stream.
+// A fixed pool of worker threads runs the streams' periods earliest
+// deadline first. Each stream keeps its own clock from its sample rate and
+// period: period k is released once k periods have passed since the stream
+// opened and is due one period later.
+//
+// A stream that falls more than a few periods behind has its clock moved up
+// rather than rendering the backlog; its stats count the resync.
+
+typedef int server_stream;
+
+// Render nframes interleaved stereo frames and send them on
+typedef void (*stream_render)(void* context, sample_type* samples, int nframes);
+
+// nthreads 0 means one worker per online CPU
+bool server_init(int nthreads, int max_streams);
+void server_release();
+
+// Thread safe. open returns -1 when the server is full; close waits for a
+// period in progress and the callback is never called after it returns.
+server_stream server_open(int sample_rate, int period_frames, stream_render render, void* context);
+void server_close(server_stream stream);
+
+struct server_stream_stats {
+	uint64_t periods;
+	uint64_t frames;
+	uint64_t deadline_misses; // periods finished after they were due
+	uint64_t resyncs; // times the clock was moved up after falling behind
+	uint64_t render_ns; // total time in the callback
+	uint64_t max_lateness_ns;
+};
+
+bool server_read_stats(server_stream stream, server_stream_stats* stats);
+
+int server_threads();
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_SHM_H
+#define TINYAUDIO_SHM_H
+
+#include <stdint.h>
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Cross-process output over shared memory (src/tinyaudio_shm.cpp and
+// src/tinyaudio_shm_host.cpp), for rendering in a sandboxed worker process
+// and playing from a small, stable host process.
+//
+// In the renderer, the shm driver is the tinyaudio device: init creates a
+// memfd ring of nperiods periods plus an eventfd doorbell, and the samples
+// callback renders straight into the shared ring whenever a period of it
+// is free. Hand both descriptors to the host, e.g. with shm_send over a
+// unix socket.
+//
+// In the host, attach the ring and pass shm_host_render to the real driver:
+//
+//     int memfd, eventfd;
+//     tinyaudio::shm_receive(socket, &memfd, &eventfd);
+//     tinyaudio::shm_host_attach(memfd, eventfd, 48000);
+//     tinyaudio::init(48000, &tinyaudio::shm_host_render);
+//
+// The host copies from the ring into the device buffer (the only copy) and
+// rings the doorbell only when the renderer is asleep waiting for space.
+// If the renderer dies, the host plays silence until a new ring is
+// attached.
+
+// Renderer: ring geometry, call before init (default 256 frames x 3)
+void set_shm_buffer(int period_frames, int nperiods);
+
+// Renderer: the ring's descriptors, valid after init
+int shm_memfd();
+int shm_eventfd();
+
+// Passes both descriptors over a unix socket (SCM_RIGHTS)
+bool shm_send(int socket, int memfd, int eventfd);
+bool shm_receive(int socket, int* memfd, int* eventfd);
+
+// Host: takes ownership of both descriptors and replaces the current ring
+// (if any); safe while the host's driver is running. Fails if the ring
+// does not match the host's bus format and sample rate.
+bool shm_host_attach(int memfd, int eventfd, int sample_rate);
+void shm_host_detach();
+void shm_host_render(sample_type* samples, int nsamples);
+
+// Periods the ring could not fill since the first attach
+uint64_t shm_host_underruns();
+
+}
+
+#endif
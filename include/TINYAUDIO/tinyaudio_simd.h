@@ -0,0 +1,421 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_SIMD_H
+#define TINYAUDIO_SIMD_H
+
+// Minimal float vector layer for the DSP kernels, and for processors played
+// through TINYAUDIO/tinyaudio_fused.h. The instruction set is picked at
+// compile time: AVX2 when the compiler targets it (-mavx2), SSE2 on any
+// other x86-64, NEON on ARM, plain floats otherwise. Define
+// TINYAUDIO_NO_SIMD to force the scalar path. Build the library and the
+// processors with the same flags, so both agree on c_simd_width.
+
+#include <stdint.h>
+
+#if defined(TINYAUDIO_NO_SIMD)
+#	define TINYAUDIO_SIMD_SCALAR 1
+#elif defined(__AVX2__)
+#	define TINYAUDIO_SIMD_AVX2 1
+#	include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define TINYAUDIO_SIMD_SSE2 1
+#	include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#	define TINYAUDIO_SIMD_NEON 1
+#	include <arm_neon.h>
+#else
+#	define TINYAUDIO_SIMD_SCALAR 1
+#endif
+
+namespace tinyaudio {
+
+#if TINYAUDIO_SIMD_AVX2
+
+static const int c_simd_width = 8;
+static const char* const c_simd_name = "avx2";
+typedef __m256 vfloat;
+
+static inline vfloat vload(const float* p) { return _mm256_loadu_ps(p); }
+static inline void vstore(float* p, vfloat v) { _mm256_storeu_ps(p, v); }
+static inline vfloat vset1(float f) { return _mm256_set1_ps(f); }
+static inline vfloat vramp() { return _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat vabs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+#if defined(__FMA__)
+static inline vfloat vmadd(vfloat a, vfloat b, vfloat c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+static inline vfloat vmadd(vfloat a, vfloat b, vfloat c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+
+static inline float vhmax(vfloat v)
+{
+	__m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+	m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+	return _mm_cvtss_f32(m);
+}
+
+static inline float vhsum(vfloat v)
+{
+	__m128 m = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+	m = _mm_add_ps(m, _mm_movehl_ps(m, m));
+	m = _mm_add_ss(m, _mm_shuffle_ps(m, m, 1));
+	return _mm_cvtss_f32(m);
+}
+
+// Store l/r as interleaved stereo: l0 r0 l1 r1 ...
+static inline void vstore_stereo(float* out, vfloat l, vfloat r)
+{
+	const __m256 lo = _mm256_unpacklo_ps(l, r);
+	const __m256 hi = _mm256_unpackhi_ps(l, r);
+	_mm256_storeu_ps(out, _mm256_permute2f128_ps(lo, hi, 0x20));
+	_mm256_storeu_ps(out + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+}
+
+// Same, converting already-scaled values to int16 with saturation
+static inline void vstore_stereo_s16(int16_t* out, vfloat l, vfloat r)
+{
+	const __m256i li = _mm256_cvtps_epi32(l);
+	const __m256i ri = _mm256_cvtps_epi32(r);
+	const __m256i lo = _mm256_unpacklo_epi32(li, ri);
+	const __m256i hi = _mm256_unpackhi_epi32(li, ri);
+	_mm256_storeu_si256((__m256i*)out, _mm256_packs_epi32(lo, hi));
+}
+
+// Store a then b as consecutive int16 values, saturating
+static inline void vstore_s16(int16_t* out, vfloat a, vfloat b)
+{
+	const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+	_mm256_storeu_si256((__m256i*)out, _mm256_permute4x64_epi64(packed, 0xD8));
+}
+
+// Load interleaved stereo l0 r0 l1 r1 ... into separate l/r vectors
+static inline void vload_stereo(const float* in, vfloat* l, vfloat* r)
+{
+	const __m256 a = _mm256_loadu_ps(in);
+	const __m256 b = _mm256_loadu_ps(in + 8);
+	*l = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0x88)), 0xD8));
+	*r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0xDD)), 0xD8));
+}
+
+// Same from int16, unscaled
+static inline void vload_stereo_s16(const int16_t* in, vfloat* l, vfloat* r)
+{
+	const __m256i x = _mm256_loadu_si256((const __m256i*)in);
+	const __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(x)));
+	const __m256 b = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1)));
+	*l = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0x88)), 0xD8));
+	*r = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, 0xDD)), 0xD8));
+}
+
+// 32-bit integer lanes, for the noise generators
+typedef __m256i vuint;
+
+static inline vuint vuload(const uint32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+static inline void vustore(uint32_t* p, vuint v) { _mm256_storeu_si256((__m256i*)p, v); }
+
+// One xorshift32 step per lane
+static inline vuint vxorshift(vuint x)
+{
+	x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+	x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+	return _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+}
+
+// Top 23 bits as a float in [-1, 1)
+static inline vfloat vunit(vuint x)
+{
+	const __m256i bits = _mm256_or_si256(_mm256_srli_epi32(x, 9), _mm256_set1_epi32(0x40000000));
+	return _mm256_sub_ps(_mm256_castsi256_ps(bits), _mm256_set1_ps(3.0f));
+}
+
+#elif TINYAUDIO_SIMD_SSE2
+
+static const int c_simd_width = 4;
+static const char* const c_simd_name = "sse2";
+typedef __m128 vfloat;
+
+static inline vfloat vload(const float* p) { return _mm_loadu_ps(p); }
+static inline void vstore(float* p, vfloat v) { _mm_storeu_ps(p, v); }
+static inline vfloat vset1(float f) { return _mm_set1_ps(f); }
+static inline vfloat vramp() { return _mm_setr_ps(0, 1, 2, 3); }
+static inline vfloat vadd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat vabs(vfloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline vfloat vmadd(vfloat a, vfloat b, vfloat c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+static inline float vhmax(vfloat v)
+{
+	v = _mm_max_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_max_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+
+static inline float vhsum(vfloat v)
+{
+	v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+	v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+	return _mm_cvtss_f32(v);
+}
+
+static inline void vstore_stereo(float* out, vfloat l, vfloat r)
+{
+	_mm_storeu_ps(out, _mm_unpacklo_ps(l, r));
+	_mm_storeu_ps(out + 4, _mm_unpackhi_ps(l, r));
+}
+
+static inline void vstore_stereo_s16(int16_t* out, vfloat l, vfloat r)
+{
+	const __m128i li = _mm_cvtps_epi32(l);
+	const __m128i ri = _mm_cvtps_epi32(r);
+	const __m128i lo = _mm_unpacklo_epi32(li, ri);
+	const __m128i hi = _mm_unpackhi_epi32(li, ri);
+	_mm_storeu_si128((__m128i*)out, _mm_packs_epi32(lo, hi));
+}
+
+static inline void vstore_s16(int16_t* out, vfloat a, vfloat b)
+{
+	_mm_storeu_si128((__m128i*)out, _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+}
+
+static inline void vload_stereo(const float* in, vfloat* l, vfloat* r)
+{
+	const __m128 a = _mm_loadu_ps(in);
+	const __m128 b = _mm_loadu_ps(in + 4);
+	*l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+	*r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+static inline void vload_stereo_s16(const int16_t* in, vfloat* l, vfloat* r)
+{
+	const __m128i x = _mm_loadu_si128((const __m128i*)in);
+	const __m128 a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+	const __m128 b = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+	*l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+	*r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+typedef __m128i vuint;
+
+static inline vuint vuload(const uint32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void vustore(uint32_t* p, vuint v) { _mm_storeu_si128((__m128i*)p, v); }
+
+static inline vuint vxorshift(vuint x)
+{
+	x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+	x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+	return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+static inline vfloat vunit(vuint x)
+{
+	const __m128i bits = _mm_or_si128(_mm_srli_epi32(x, 9), _mm_set1_epi32(0x40000000));
+	return _mm_sub_ps(_mm_castsi128_ps(bits), _mm_set1_ps(3.0f));
+}
+
+#elif TINYAUDIO_SIMD_NEON
+
+static const int c_simd_width = 4;
+static const char* const c_simd_name = "neon";
+typedef float32x4_t vfloat;
+
+static inline vfloat vload(const float* p) { return vld1q_f32(p); }
+static inline void vstore(float* p, vfloat v) { vst1q_f32(p, v); }
+static inline vfloat vset1(float f) { return vdupq_n_f32(f); }
+static inline vfloat vramp() { static const float r[4] = {0, 1, 2, 3}; return vld1q_f32(r); }
+static inline vfloat vadd(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+static inline vfloat vsub(vfloat a, vfloat b) { return vsubq_f32(a, b); }
+static inline vfloat vmul(vfloat a, vfloat b) { return vmulq_f32(a, b); }
+static inline vfloat vmin(vfloat a, vfloat b) { return vminq_f32(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return vmaxq_f32(a, b); }
+static inline vfloat vabs(vfloat a) { return vabsq_f32(a); }
+static inline vfloat vmadd(vfloat a, vfloat b, vfloat c) { return vmlaq_f32(c, a, b); }
+
+static inline float vhmax(vfloat v)
+{
+	float32x2_t m = vpmax_f32(vget_low_f32(v), vget_high_f32(v));
+	m = vpmax_f32(m, m);
+	return vget_lane_f32(m, 0);
+}
+
+static inline float vhsum(vfloat v)
+{
+	float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+	s = vpadd_f32(s, s);
+	return vget_lane_f32(s, 0);
+}
+
+static inline void vstore_stereo(float* out, vfloat l, vfloat r)
+{
+	float32x4x2_t lr;
+	lr.val[0] = l;
+	lr.val[1] = r;
+	vst2q_f32(out, lr);
+}
+
+static inline void vstore_stereo_s16(int16_t* out, vfloat l, vfloat r)
+{
+	// bias by +/-0.5 so the truncating convert rounds to nearest
+	const float32x4_t half = vdupq_n_f32(0.5f);
+	const uint32x4_t sign = vdupq_n_u32(0x80000000);
+	l = vaddq_f32(l, vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(l), sign), vreinterpretq_u32_f32(half))));
+	r = vaddq_f32(r, vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(r), sign), vreinterpretq_u32_f32(half))));
+
+	int16x4x2_t lr;
+	lr.val[0] = vqmovn_s32(vcvtq_s32_f32(l));
+	lr.val[1] = vqmovn_s32(vcvtq_s32_f32(r));
+	vst2_s16(out, lr);
+}
+
+static inline void vstore_s16(int16_t* out, vfloat a, vfloat b)
+{
+	const float32x4_t half = vdupq_n_f32(0.5f);
+	const uint32x4_t sign = vdupq_n_u32(0x80000000);
+	a = vaddq_f32(a, vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(a), sign), vreinterpretq_u32_f32(half))));
+	b = vaddq_f32(b, vreinterpretq_f32_u32(vorrq_u32(vandq_u32(vreinterpretq_u32_f32(b), sign), vreinterpretq_u32_f32(half))));
+	vst1q_s16(out, vcombine_s16(vqmovn_s32(vcvtq_s32_f32(a)), vqmovn_s32(vcvtq_s32_f32(b))));
+}
+
+static inline void vload_stereo(const float* in, vfloat* l, vfloat* r)
+{
+	const float32x4x2_t lr = vld2q_f32(in);
+	*l = lr.val[0];
+	*r = lr.val[1];
+}
+
+static inline void vload_stereo_s16(const int16_t* in, vfloat* l, vfloat* r)
+{
+	const int16x4x2_t lr = vld2_s16(in);
+	*l = vcvtq_f32_s32(vmovl_s16(lr.val[0]));
+	*r = vcvtq_f32_s32(vmovl_s16(lr.val[1]));
+}
+
+typedef uint32x4_t vuint;
+
+static inline vuint vuload(const uint32_t* p) { return vld1q_u32(p); }
+static inline void vustore(uint32_t* p, vuint v) { vst1q_u32(p, v); }
+
+static inline vuint vxorshift(vuint x)
+{
+	x = veorq_u32(x, vshlq_n_u32(x, 13));
+	x = veorq_u32(x, vshrq_n_u32(x, 17));
+	return veorq_u32(x, vshlq_n_u32(x, 5));
+}
+
+static inline vfloat vunit(vuint x)
+{
+	const uint32x4_t bits = vorrq_u32(vshrq_n_u32(x, 9), vdupq_n_u32(0x40000000));
+	return vsubq_f32(vreinterpretq_f32_u32(bits), vdupq_n_f32(3.0f));
+}
+
+#else
+
+static const int c_simd_width = 1;
+static const char* const c_simd_name = "scalar";
+typedef float vfloat;
+
+static inline vfloat vload(const float* p) { return *p; }
+static inline void vstore(float* p, vfloat v) { *p = v; }
+static inline vfloat vset1(float f) { return f; }
+static inline vfloat vramp() { return 0.0f; }
+static inline vfloat vadd(vfloat a, vfloat b) { return a + b; }
+static inline vfloat vsub(vfloat a, vfloat b) { return a - b; }
+static inline vfloat vmul(vfloat a, vfloat b) { return a * b; }
+static inline vfloat vmin(vfloat a, vfloat b) { return (a < b) ? a : b; }
+static inline vfloat vmax(vfloat a, vfloat b) { return (a > b) ? a : b; }
+static inline vfloat vabs(vfloat a) { return (a < 0.0f) ? -a : a; }
+static inline vfloat vmadd(vfloat a, vfloat b, vfloat c) { return a * b + c; }
+static inline float vhmax(vfloat v) { return v; }
+static inline float vhsum(vfloat v) { return v; }
+
+static inline void vstore_stereo(float* out, vfloat l, vfloat r)
+{
+	out[0] = l;
+	out[1] = r;
+}
+
+static inline void vstore_stereo_s16(int16_t* out, vfloat l, vfloat r)
+{
+	out[0] = (int16_t)(l + ((l < 0.0f) ? -0.5f : 0.5f));
+	out[1] = (int16_t)(r + ((r < 0.0f) ? -0.5f : 0.5f));
+}
+
+static inline void vstore_s16(int16_t* out, vfloat a, vfloat b)
+{
+	vstore_stereo_s16(out, a, b);
+}
+
+static inline void vload_stereo(const float* in, vfloat* l, vfloat* r)
+{
+	*l = in[0];
+	*r = in[1];
+}
+
+static inline void vload_stereo_s16(const int16_t* in, vfloat* l, vfloat* r)
+{
+	*l = in[0];
+	*r = in[1];
+}
+
+typedef uint32_t vuint;
+
+static inline vuint vuload(const uint32_t* p) { return *p; }
+static inline void vustore(uint32_t* p, vuint v) { *p = v; }
+
+static inline vuint vxorshift(vuint x)
+{
+	x ^= x << 13;
+	x ^= x >> 17;
+	return x ^ (x << 5);
+}
+
+static inline vfloat vunit(vuint x)
+{
+	union { uint32_t u; float f; } bits;
+	bits.u = (x >> 9) | 0x40000000;
+	return bits.f - 3.0f;
+}
+
+#endif
+
+// Round to the nearest integer, for |x| < 2^22
+static inline vfloat vround(vfloat x)
+{
+	const vfloat magic = vset1(12582912.0f); // 1.5 * 2^23
+	return vsub(vadd(x, magic), magic);
+}
+
+}
+
+#endif
@@ -0,0 +1,51 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_STATS_H
+#define TINYAUDIO_STATS_H
+
+#include <stdint.h>
+
+namespace tinyaudio {
+
+// Driver counters (ALSA, pulse, JACK, PipeWire and the paced null driver),
+// zeroed by init. Safe to read from any thread while the driver runs.
+struct driver_stats {
+	uint64_t periods;   // device periods the driver has filled
+	uint64_t underruns; // times the device ran dry (not reported by PipeWire)
+
+	// Background jobs (TINYAUDIO/tinyaudio_background.h; ALSA, pulse and
+	// null only): idle time offered to them after the safety margin, and
+	// the time they used of it
+	uint64_t background_budget_ns;
+	uint64_t background_used_ns;
+};
+
+void read_driver_stats(driver_stats* stats);
+
+}
+
+#endif
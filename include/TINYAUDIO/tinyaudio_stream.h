@@ -0,0 +1,81 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_STREAM_H
+#define TINYAUDIO_STREAM_H
+
+#include <stdint.h>
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+// Streaming playback of large WAV/raw PCM files (POSIX).
+//
+// The file is memory mapped. A background thread keeps the next
+// `readahead_periods` periods past the play cursor resident (madvise +
+// mlock, falling back to touching the pages), and the audio thread only
+// ever reads pages that thread has already brought in: if the cursor
+// outruns the read-ahead, you get silence and stream_starved() counts it,
+// never a page fault.
+//
+// Supported data: 1 or 2 channels of 16-bit, 24-bit or float samples.
+
+struct stream;
+
+enum stream_sample {
+	stream_s16,
+	stream_s24,
+	stream_float,
+};
+
+stream* stream_open(const char* path, int period_frames, int readahead_periods);
+stream* stream_open_raw(const char* path, int channels, stream_sample format, int period_frames, int readahead_periods);
+void stream_close(stream* s);
+int stream_sample_rate(const stream* s); // 0 for raw files
+
+// Audio thread. Copies/converts nframes into the bus format, handling loop
+// and end of file (silence past the end).
+void stream_render(stream* s, sample_type* samples, int nframes);
+
+// Audio thread. When the file already holds stereo data in the bus format,
+// points *span straight into the mapping and advances the cursor. Returns
+// the number of frames in the span (less than nframes at the loop point or
+// when read-ahead is behind), or 0 if the formats differ.
+int stream_read_span(stream* s, int nframes, const sample_type** span);
+
+// Any thread. A seek takes effect once the read-ahead thread has made the
+// target resident (normally before the next period); playback continues
+// from the old position until then.
+void stream_seek(stream* s, uint64_t frame);
+void stream_set_loop(stream* s, bool loop);
+
+uint64_t stream_position(const stream* s);
+uint64_t stream_length(const stream* s);
+unsigned stream_starved(const stream* s);
+
+}
+
+#endif
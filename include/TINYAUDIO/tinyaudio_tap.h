@@ -0,0 +1,79 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_TAP_H
+#define TINYAUDIO_TAP_H
+
+// Output tap: a hook the ALSA, pulse and (paced) null drivers call with
+// exactly the block they are about to hand to the device, after the
+// samples callback has run. It is called on the audio thread, so it must
+// not block, allocate or do I/O.
+//
+// Header-only so every driver .cpp can keep being compiled on its own.
+
+#include <atomic>
+#include <sched.h>
+#include "TINYAUDIO/tinyaudio.h"
+
+namespace tinyaudio {
+
+typedef void (*output_tap)(const sample_type* samples, int nframes);
+
+struct output_tap_state {
+	std::atomic<output_tap> tap;
+	std::atomic<int> busy; // audio thread is inside the tap
+};
+
+inline output_tap_state* output_tap_settings()
+{
+	static output_tap_state state;
+	return &state;
+}
+
+// Install a tap (NULL removes it). When this returns, the previous tap is
+// no longer running and will not be called again.
+inline void set_output_tap(output_tap tap)
+{
+	output_tap_state* state = output_tap_settings();
+	state->tap.store(tap);
+	while (state->busy.load())
+		sched_yield();
+}
+
+// Called by the drivers
+inline void run_output_tap(const sample_type* samples, int nframes)
+{
+	output_tap_state* state = output_tap_settings();
+	state->busy.fetch_add(1);
+	const output_tap tap = state->tap.load();
+	if (tap)
+		tap(samples, nframes);
+	state->busy.fetch_sub(1);
+}
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_TRACE_H
+#define TINYAUDIO_TRACE_H
+
+// Timeline tracing of audio-thread activity, dumped as Chrome trace_event
+// JSON (load it in chrome://tracing or Perfetto). Linux/Android only.
+//
+// Build with TINYAUDIO_TRACE=1 and compile src/tinyaudio_trace.cpp to get
+// the drivers' spans (callback, conversion, device wait/write, recovery).
+// With TINYAUDIO_TRACE=0 (the default) the macros compile to nothing. When
+// compiled in but not enabled, each span costs one relaxed atomic load.
+//
+// Timestamps come from CLOCK_MONOTONIC and events carry the real pid/tid, so
+// a dump lines up with other traces of the same process.
+
+#ifndef TINYAUDIO_TRACE
+#define TINYAUDIO_TRACE 0
+#endif
+
+#if TINYAUDIO_TRACE
+
+#include <stdint.h>
+
+namespace tinyaudio {
+
+void trace_enable(bool enable);
+
+// Spans are recorded into a lock-free ring owned by the calling thread; the
+// oldest events are overwritten once it fills. Names must outlive the trace
+// (string literals).
+uint64_t trace_begin();
+void trace_end(const char* name, uint64_t begin);
+void trace_marker(const char* name);
+void trace_thread_name(const char* name);
+
+// Write everything currently in the rings. Safe to call while tracing.
+bool trace_dump(const char* path);
+
+}
+
+#define TINYAUDIO_TRACE_BEGIN(var) const uint64_t var = ::tinyaudio::trace_begin()
+#define TINYAUDIO_TRACE_END(name, var) ::tinyaudio::trace_end(name, var)
+#define TINYAUDIO_TRACE_MARKER(name) ::tinyaudio::trace_marker(name)
+#define TINYAUDIO_TRACE_THREAD(name) ::tinyaudio::trace_thread_name(name)
+
+#else
+
+#define TINYAUDIO_TRACE_BEGIN(var)
+#define TINYAUDIO_TRACE_END(name, var) ((void)0)
+#define TINYAUDIO_TRACE_MARKER(name) ((void)0)
+#define TINYAUDIO_TRACE_THREAD(name) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_VERIFY_H
+#define TINYAUDIO_VERIFY_H
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_loopback.h"
+
+namespace tinyaudio {
+
+// Checks for captured output (src/tinyaudio_verify.cpp), typically from the
+// loopback driver, so tests can fail on glitches without anyone listening.
+
+struct verify_sine_report {
+	int frames;            // frames checked
+	int discontinuities;   // jumps in the sine's phase
+	int dropouts;          // runs of silence inside the signal
+	int dropout_frames;
+	int duplicated_blocks; // replays of one of the few blocks before them
+	int first_error;       // frame of the first problem, or -1
+};
+
+// Follows the phase of a steady sine of `frequency` Hz on the left channel
+// and reports every place it breaks. Pass the loopback blocks to also tell
+// repeated blocks apart from other jumps, or NULL to skip that check.
+void verify_sine(const sample_type* samples, int nframes, float frequency, int sample_rate,
+	const loopback_block* blocks, int nblocks, verify_sine_report* report);
+
+struct verify_latency_report {
+	int blocks;
+	double min_us;  // callback entry to the block's first frame playing
+	double mean_us;
+	double p99_us;
+	double max_us;
+};
+
+// Callback-to-output latency of each block, on the stream clock
+void verify_latency(const loopback_block* blocks, int nblocks, verify_latency_report* report);
+
+}
+
+#endif
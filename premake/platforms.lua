@@ -35,6 +35,17 @@ newplatform {
 	}
 }
 
+newplatform {
+	name ="linux-auto",
+	description = "Linux, driver picked at runtime",
+	gcc = {
+		cc = "gcc",
+		cxx = "g++",
+		ar = "ar",
+		cppflags = "-MMD",
+	}
+}
+
 newplatform {
 	name ="linux-alsa",
 	description = "Linux via ALSA",
@@ -57,6 +68,39 @@ newplatform {
 	}
 }
 
+newplatform {
+	name ="linux-jack",
+	description = "Linux via JACK",
+	gcc = {
+		cc = "gcc",
+		cxx = "g++",
+		ar = "ar",
+		cppflags = "-MMD",
+	}
+}
+
+newplatform {
+	name ="linux-pipewire",
+	description = "Linux via PipeWire",
+	gcc = {
+		cc = "gcc",
+		cxx = "g++",
+		ar = "ar",
+		cppflags = "-MMD",
+	}
+}
+
+newplatform {
+	name ="linux-rtp",
+	description = "Linux via RTP over UDP",
+	gcc = {
+		cc = "gcc",
+		cxx = "g++",
+		ar = "ar",
+		cppflags = "-MMD",
+	}
+}
+
 newplatform {
 	name = "android",
 	description = "Andoroid",
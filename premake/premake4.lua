@@ -49,6 +49,10 @@ solution "tinyaudio_examples"
 		links {
 			"ppapi",
 		}
+	configuration { "linux-*" }
+		buildoptions {
+			"-std=c++11",
+		}
 
 
 	project "sin"
@@ -67,6 +71,7 @@ solution "tinyaudio_examples"
 
 			files {
 				ROOT_DIR .. "examples/main.cpp",
+				ROOT_DIR .. "src/tinyaudio_memory_win32.cpp",
 				ROOT_DIR .. "src/tinyaudio_xaudio.cpp",
 			}
 
@@ -77,6 +82,24 @@ solution "tinyaudio_examples"
 				ROOT_DIR .. "src/tinyaudio_nacl.cpp",
 			}
 
+		configuration { "linux-auto" }
+
+			includedirs {
+				ROOT_DIR .. "src/",
+				"/usr/include/pipewire-0.3",
+				"/usr/include/spa-0.2",
+			}
+
+			files {
+				ROOT_DIR .. "examples/main.cpp",
+				ROOT_DIR .. "src/tinyaudio_linux.cpp",
+			}
+
+			links {
+				"pthread",
+				"dl",
+			}
+
 		configuration { "linux-alsa" }
 
 			files {
@@ -101,6 +124,50 @@ solution "tinyaudio_examples"
 				"pulse-simple",
 			}
 
+		configuration { "linux-jack" }
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "examples/main.cpp",
+				ROOT_DIR .. "src/tinyaudio_jack.cpp",
+			}
+
+			links {
+				"pthread",
+				"jack",
+			}
+
+		configuration { "linux-pipewire" }
+
+			includedirs {
+				"/usr/include/pipewire-0.3",
+				"/usr/include/spa-0.2",
+			}
+
+			files {
+				ROOT_DIR .. "examples/main.cpp",
+				ROOT_DIR .. "src/tinyaudio_pipewire.cpp",
+			}
+
+			links {
+				"pthread",
+				"pipewire-0.3",
+			}
+
+		configuration { "linux-rtp" }
+
+			files {
+				ROOT_DIR .. "examples/main.cpp",
+				ROOT_DIR .. "src/tinyaudio_rtp.cpp",
+			}
+
+			links {
+				"pthread",
+			}
+
 		configuration { "android" }
 
 			kind "SharedLib"
@@ -115,3 +182,290 @@ solution "tinyaudio_examples"
 				"log",
 				"OpenSLES",
 			}
+
+	if os.get() == "linux" then
+		project "xrun"
+			kind "ConsoleApp"
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "examples/example_xrun.cpp",
+			}
+
+			configuration { "linux-auto" }
+
+				defines {
+					"TINYAUDIO_NULL_PACED=1",
+				}
+
+				includedirs {
+					ROOT_DIR .. "src/",
+					"/usr/include/pipewire-0.3",
+					"/usr/include/spa-0.2",
+				}
+
+				files {
+					ROOT_DIR .. "src/tinyaudio_linux.cpp",
+				}
+
+				links {
+					"pthread",
+					"dl",
+				}
+
+			configuration { "linux-alsa" }
+
+				files {
+					ROOT_DIR .. "src/tinyaudio_alsa.cpp",
+				}
+
+				links {
+					"pthread",
+					"asound",
+				}
+
+			configuration { "linux-pulse" }
+
+				files {
+					ROOT_DIR .. "src/tinyaudio_pulse.cpp",
+				}
+
+				links {
+					"pthread",
+					"pulse-simple",
+				}
+
+			configuration { "linux-jack" }
+
+				includedirs {
+					ROOT_DIR .. "src/",
+				}
+
+				files {
+					ROOT_DIR .. "src/tinyaudio_jack.cpp",
+				}
+
+				links {
+					"pthread",
+					"jack",
+				}
+
+			configuration { "linux-pipewire" }
+
+				includedirs {
+					"/usr/include/pipewire-0.3",
+					"/usr/include/spa-0.2",
+				}
+
+				files {
+					ROOT_DIR .. "src/tinyaudio_pipewire.cpp",
+				}
+
+				links {
+					"pthread",
+					"pipewire-0.3",
+				}
+	end
+
+	if os.get() == "linux" then
+		project "loopback_check"
+			kind "ConsoleApp"
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "examples/example_loopback.cpp",
+				ROOT_DIR .. "examples/example_sin.cpp",
+				ROOT_DIR .. "src/tinyaudio_loopback.cpp",
+				ROOT_DIR .. "src/tinyaudio_verify.cpp",
+			}
+
+			links {
+				"pthread",
+			}
+	end
+
+	if os.get() == "linux" then
+		project "rtp_loopback"
+			kind "ConsoleApp"
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "examples/example_rtp_loopback.cpp",
+				ROOT_DIR .. "src/tinyaudio_rtp.cpp",
+				ROOT_DIR .. "src/tinyaudio_rtp_receiver.cpp",
+			}
+
+			links {
+				"pthread",
+			}
+	end
+
+	if os.get() == "linux" then
+		project "shm_loopback"
+			kind "ConsoleApp"
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "examples/example_shm_loopback.cpp",
+				ROOT_DIR .. "src/tinyaudio_shm.cpp",
+				ROOT_DIR .. "src/tinyaudio_shm_host.cpp",
+			}
+
+			links {
+				"pthread",
+			}
+	end
+
+	if os.get() ~= "windows" then
+		project "bench_mixer"
+			kind "ConsoleApp"
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "bench/bench_mixer.cpp",
+				ROOT_DIR .. "src/tinyaudio_mixer.cpp",
+			}
+	end
+
+	if os.get() ~= "windows" then
+		project "bench_bank"
+			kind "ConsoleApp"
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "bench/bench_bank.cpp",
+				ROOT_DIR .. "src/tinyaudio_bank.cpp",
+			}
+	end
+
+	if os.get() ~= "windows" then
+		project "bench_convolver"
+			kind "ConsoleApp"
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "bench/bench_convolver.cpp",
+				ROOT_DIR .. "src/tinyaudio_convolver.cpp",
+			}
+
+			links {
+				"pthread",
+			}
+	end
+
+	if os.get() == "linux" then
+		project "bench_graph"
+			kind "ConsoleApp"
+
+			defines {
+				"TINYAUDIO_NULL_PACED=1",
+			}
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "bench/bench_graph.cpp",
+				ROOT_DIR .. "src/tinyaudio_graph.cpp",
+				ROOT_DIR .. "src/tinyaudio_null.cpp",
+			}
+
+			links {
+				"pthread",
+			}
+	end
+
+	if os.get() == "linux" then
+		project "bench"
+			kind "ConsoleApp"
+
+			defines {
+				"TINYAUDIO_NULL_PACED=1",
+			}
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "bench/bench.cpp",
+				ROOT_DIR .. "src/tinyaudio_null.cpp",
+				ROOT_DIR .. "src/tinyaudio_record.cpp",
+			}
+
+			links {
+				"pthread",
+			}
+	end
+
+	if os.get() ~= "windows" then
+		project "bench_generator"
+			kind "ConsoleApp"
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "bench/bench_generator.cpp",
+				ROOT_DIR .. "src/tinyaudio_generator.cpp",
+			}
+	end
+
+	if os.get() == "linux" then
+		project "bench_server"
+			kind "ConsoleApp"
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "bench/bench_server.cpp",
+				ROOT_DIR .. "src/tinyaudio_generator.cpp",
+				ROOT_DIR .. "src/tinyaudio_server.cpp",
+			}
+
+			links {
+				"pthread",
+			}
+	end
+
+	if os.get() ~= "windows" then
+		project "bench_fused"
+			kind "ConsoleApp"
+
+			includedirs {
+				ROOT_DIR .. "src/",
+			}
+
+			files {
+				ROOT_DIR .. "include/**.h",
+				ROOT_DIR .. "bench/bench_fused.cpp",
+			}
+	end
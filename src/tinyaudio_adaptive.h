@@ -0,0 +1,127 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_ADAPTIVE_H
+#define TINYAUDIO_ADAPTIVE_H
+
+// Shared underrun-driven period policy used by the ALSA, pulse and null
+// drivers. Internal; see TINYAUDIO/tinyaudio_latency.h for the public side.
+
+#include <stdint.h>
+#include <time.h>
+
+namespace tinyaudio {
+
+// Drivers size their render buffers to hold the largest period
+static const int c_nmaxperiod = 8192;
+static const int c_nminperiod = 64;
+
+// How long a period has to run with plenty of headroom before we shrink it
+static const int c_adaptive_stable_ms = 10000;
+
+struct AdaptivePeriod {
+	int sample_rate;
+	int min_frames;
+	int max_frames;
+	int frames;
+	int stable_frames;
+};
+
+static inline uint64_t adaptive_now_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline int adaptive_clamp(const AdaptivePeriod* a, int frames)
+{
+	frames &= ~(c_nminperiod - 1);
+	if (frames < a->min_frames)
+		frames = a->min_frames;
+	if (frames > a->max_frames)
+		frames = a->max_frames;
+	return frames;
+}
+
+static inline void adaptive_reset(AdaptivePeriod* a, int sample_rate, int min_frames, int max_frames)
+{
+	min_frames = (min_frames + c_nminperiod - 1) & ~(c_nminperiod - 1);
+	if (min_frames < c_nminperiod)
+		min_frames = c_nminperiod;
+	if (min_frames > c_nmaxperiod)
+		min_frames = c_nmaxperiod;
+	if (max_frames > c_nmaxperiod)
+		max_frames = c_nmaxperiod;
+	if (max_frames < min_frames)
+		max_frames = min_frames;
+
+	a->sample_rate = sample_rate;
+	a->min_frames = min_frames;
+	a->max_frames = max_frames;
+	a->frames = min_frames;
+	a->stable_frames = 0;
+}
+
+static inline uint64_t adaptive_period_ns(const AdaptivePeriod* a, int frames)
+{
+	return (uint64_t)frames * 1000000000ULL / (uint64_t)a->sample_rate;
+}
+
+// Feed the outcome of one period. Returns true when a->frames changed and the
+// driver should reconfigure.
+static inline bool adaptive_update(AdaptivePeriod* a, bool xrun, uint64_t callback_ns)
+{
+	const int frames = a->frames;
+
+	// grow quickly: an underrun, or a callback that leaves less than a
+	// quarter of the period for the driver, doubles the period
+	if (xrun || callback_ns * 4 > adaptive_period_ns(a, frames) * 3) {
+		a->stable_frames = 0;
+		a->frames = adaptive_clamp(a, frames * 2);
+		return a->frames != frames;
+	}
+
+	// shrink slowly: only after a sustained window in which the callback
+	// would still fit in half of the smaller period
+	const int smaller = adaptive_clamp(a, frames - frames / 4);
+	if (smaller == frames || callback_ns * 2 > adaptive_period_ns(a, smaller)) {
+		a->stable_frames = 0;
+		return false;
+	}
+
+	a->stable_frames += frames;
+	if ((int64_t)a->stable_frames * 1000 < (int64_t)c_adaptive_stable_ms * a->sample_rate)
+		return false;
+
+	a->stable_frames = 0;
+	a->frames = smaller;
+	return true;
+}
+
+}
+
+#endif
@@ -25,7 +25,16 @@
  */
 
 #include "TINYAUDIO/tinyaudio.h"
-
+#include "TINYAUDIO/tinyaudio_background.h"
+#include "TINYAUDIO/tinyaudio_latency.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_stats.h"
+#include "TINYAUDIO/tinyaudio_tap.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+#include "tinyaudio_adaptive.h"
+#include "tinyaudio_driver.h"
+
+#include <atomic>
 #include <stdint.h>
 #include <string.h>
 #include <alsa/asoundlib.h>
@@ -33,25 +42,74 @@
 #include <semaphore.h>
 
 namespace tinyaudio {
+TINYAUDIO_DRIVER_BEGIN
+
+#if TINYAUDIO_DYNLOAD
+#define TINYAUDIO_ALSA_SYMBOLS(X) \
+	X(snd_pcm_avail_update) \
+	X(snd_pcm_close) \
+	X(snd_pcm_drain) \
+	X(snd_pcm_hw_params) \
+	X(snd_pcm_hw_params_any) \
+	X(snd_pcm_hw_params_free) \
+	X(snd_pcm_hw_params_get_buffer_size) \
+	X(snd_pcm_hw_params_malloc) \
+	X(snd_pcm_hw_params_set_access) \
+	X(snd_pcm_hw_params_set_buffer_size_near) \
+	X(snd_pcm_hw_params_set_channels) \
+	X(snd_pcm_hw_params_set_format) \
+	X(snd_pcm_hw_params_set_period_size_near) \
+	X(snd_pcm_hw_params_set_rate) \
+	X(snd_pcm_open) \
+	X(snd_pcm_prepare) \
+	X(snd_pcm_sw_params) \
+	X(snd_pcm_sw_params_current) \
+	X(snd_pcm_sw_params_free) \
+	X(snd_pcm_sw_params_malloc) \
+	X(snd_pcm_sw_params_set_avail_min) \
+	X(snd_pcm_sw_params_set_start_threshold) \
+	X(snd_pcm_wait) \
+	X(snd_pcm_writei)
+
+TINYAUDIO_ALSA_SYMBOLS(TINYAUDIO_DYNLOAD_DECLARE)
+
+static bool load_library()
+{
+	static const char* const sonames[] = { "libasound.so.2", NULL };
+	void* handle = dynload_open(sonames);
+	if (!handle)
+		return false;
+
+	bool ok = true;
+	TINYAUDIO_ALSA_SYMBOLS(TINYAUDIO_DYNLOAD_RESOLVE)
+	return ok;
+}
+#endif
 
 static const int c_nsamples = 2048;
+static const int c_nperiods = 2;
 static int g_sample_rate;
 static samples_callback g_callback;
 static pthread_t g_thread;
 static snd_pcm_t* g_handle;
 static bool g_running;
+static int g_min_latency;
+static int g_max_latency;
+static latency_callback g_latency_callback;
+static AdaptivePeriod g_period;
+static buffer_pool g_pool;
+static int g_nframes;
+static std::atomic<uint64_t> g_periods;
+static std::atomic<uint64_t> g_underruns;
 static const int c_nlasterror = 128;
 static char g_lasterror[c_nlasterror];
 
-static bool alsa_init()
+// (Re)configure the device for the current period. Expects the device to be
+// in the OPEN or SETUP state.
+static bool alsa_configure()
 {
 	int err;
 
-	if (0 > (err = snd_pcm_open(&g_handle, "plughw:0,0", SND_PCM_STREAM_PLAYBACK, 0))) {
-		snprintf(g_lasterror, c_nlasterror, "failed to open alsa device: %d", err);
-		return false;
-	}
-	
 	snd_pcm_hw_params_t* hwparams;
 	if (0 > (err = snd_pcm_hw_params_malloc(&hwparams))) {
 		snprintf(g_lasterror, c_nlasterror, "failed to alloc hw params: %d", err);
@@ -92,12 +150,34 @@ static bool alsa_init()
 		return false;
 	}
 
+	if (g_max_latency) {
+		snd_pcm_uframes_t period = g_period.frames;
+		if (0 > (err = snd_pcm_hw_params_set_period_size_near(g_handle, hwparams, &period, 0))) {
+			snd_pcm_hw_params_free(hwparams);
+			snprintf(g_lasterror, c_nlasterror, "failed to set hwparams period size: %d", err);
+			return false;
+		}
+
+		snd_pcm_uframes_t buffer = period * c_nperiods;
+		if (0 > (err = snd_pcm_hw_params_set_buffer_size_near(g_handle, hwparams, &buffer))) {
+			snd_pcm_hw_params_free(hwparams);
+			snprintf(g_lasterror, c_nlasterror, "failed to set hwparams buffer size: %d", err);
+			return false;
+		}
+
+		g_nframes = (period < (snd_pcm_uframes_t)c_nmaxperiod) ? (int)period : c_nmaxperiod;
+	} else {
+		g_nframes = c_nsamples;
+	}
+
 	if (0 > (err = snd_pcm_hw_params(g_handle, hwparams))) {
 		snd_pcm_hw_params_free(hwparams);
 		snprintf(g_lasterror, c_nlasterror, "failed to set device hwparams: %d", err);
 		return false;
 	}
 
+	snd_pcm_uframes_t latency = 0;
+	snd_pcm_hw_params_get_buffer_size(hwparams, &latency);
 	snd_pcm_hw_params_free(hwparams);
 
 	snd_pcm_sw_params_t* swparams;
@@ -112,7 +192,7 @@ static bool alsa_init()
 		return false;
 	}
 
-	if (0 > (err = snd_pcm_sw_params_set_avail_min(g_handle, swparams, 4096))) {
+	if (0 > (err = snd_pcm_sw_params_set_avail_min(g_handle, swparams, g_max_latency ? g_nframes : 4096))) {
 		snd_pcm_sw_params_free(swparams);
 		snprintf(g_lasterror, c_nlasterror, "failed to set swparams avail min: %d", err);
 		return false;
@@ -137,13 +217,32 @@ static bool alsa_init()
 		return false;
 	}
 
+	if (g_latency_callback)
+		g_latency_callback(g_nframes, (int)latency);
+
 	return true;
 }
 
+static bool alsa_init()
+{
+	int err;
+
+	if (0 > (err = snd_pcm_open(&g_handle, "plughw:0,0", SND_PCM_STREAM_PLAYBACK, 0))) {
+		snprintf(g_lasterror, c_nlasterror, "failed to open alsa device: %d", err);
+		return false;
+	}
+
+	if (g_max_latency)
+		adaptive_reset(&g_period, g_sample_rate, g_min_latency / c_nperiods, g_max_latency / c_nperiods);
+
+	return alsa_configure();
+}
+
 static void* alsa_thread(void* context)
 {
 	sem_t* init = (sem_t*)context;
 
+	TINYAUDIO_TRACE_THREAD("tinyaudio alsa");
 	if (!alsa_init()) {
 		
 		if (g_handle) {
@@ -157,23 +256,63 @@ static void* alsa_thread(void* context)
 		return 0;
 
 	int err;
-	sample_type samples[c_nsamples * 2];
+	sample_type* samples = (sample_type*)pool_block(&g_pool, 0);
 	snd_pcm_t* pcm = g_handle;
 	g_running = true;
 	while (g_running) {
 
-		if (0 > (err = snd_pcm_wait(pcm, 1000)))
+		TINYAUDIO_TRACE_BEGIN(trace_wait);
+		err = snd_pcm_wait(pcm, 1000);
+		TINYAUDIO_TRACE_END("wait", trace_wait);
+		if (0 > err)
 			break;
+		const uint64_t wake = adaptive_now_ns();
 
+		bool xrun = false;
 		const int frames = snd_pcm_avail_update(pcm);
-		if (frames == -EPIPE)
+		if (frames == -EPIPE) {
+			TINYAUDIO_TRACE_BEGIN(trace_recover);
 			snd_pcm_prepare(pcm);
-		else if (frames < 0)
+			TINYAUDIO_TRACE_END("recover", trace_recover);
+			xrun = true;
+		} else if (frames < 0) {
 			break;
+		}
 
-		g_callback(samples, c_nsamples);
-		if (0 > (err = snd_pcm_writei(pcm, samples, c_nsamples)))
+		const uint64_t start = adaptive_now_ns();
+		TINYAUDIO_TRACE_BEGIN(trace_callback);
+		g_callback(samples, g_nframes);
+		TINYAUDIO_TRACE_END("callback", trace_callback);
+		const uint64_t callback_ns = adaptive_now_ns() - start;
+		run_output_tap(samples, g_nframes);
+
+		TINYAUDIO_TRACE_BEGIN(trace_write);
+		err = snd_pcm_writei(pcm, samples, g_nframes);
+		TINYAUDIO_TRACE_END("write", trace_write);
+		if (0 > err) {
+			TINYAUDIO_TRACE_BEGIN(trace_recover);
 			snd_pcm_prepare(pcm);
+			TINYAUDIO_TRACE_END("recover", trace_recover);
+			xrun = true;
+		}
+
+		g_periods.fetch_add(1, std::memory_order_relaxed);
+		if (xrun)
+			g_underruns.fetch_add(1, std::memory_order_relaxed);
+
+		// the device wants the next period about one period after this
+		// wakeup
+		const uint64_t period_ns = (uint64_t)g_nframes * 1000000000ULL / g_sample_rate;
+		run_background_jobs(wake + period_ns, period_ns);
+
+		if (g_max_latency && adaptive_update(&g_period, xrun, callback_ns)) {
+			TINYAUDIO_TRACE_BEGIN(trace_reconfigure);
+			snd_pcm_drain(pcm);
+			const bool configured = alsa_configure();
+			TINYAUDIO_TRACE_END("reconfigure", trace_reconfigure);
+			if (!configured)
+				break;
+		}
 	}
 
 	snd_pcm_close(pcm);
@@ -186,14 +325,33 @@ bool init(int sample_rate, samples_callback callback)
 	g_sample_rate = sample_rate;
 	g_callback = callback;
 
+#if TINYAUDIO_DYNLOAD
+	if (!load_library()) {
+		snprintf(g_lasterror, c_nlasterror, "failed to load libasound");
+		return false;
+	}
+#endif
+
+	if (!pool_create(&g_pool, sizeof(sample_type) * 2 * c_nmaxperiod, 1)) {
+		snprintf(g_lasterror, c_nlasterror, "failed to allocate render buffer");
+		return false;
+	}
+
+	g_periods.store(0);
+	g_underruns.store(0);
+	reset_background_stats();
+
 	sem_t init;
 	sem_init(&init, 0, 0);
 	pthread_create(&g_thread, NULL, &alsa_thread, &init);
 	sem_wait(&init);
 	sem_destroy(&init);
 
-	if (!g_handle)
+	if (!g_handle) {
+		pthread_join(g_thread, NULL);
+		pool_destroy(&g_pool);
 		return false;
+	}
 	return true;
 }
 
@@ -201,6 +359,25 @@ void release()
 {
 	g_running = false;
 	pthread_join(g_thread, NULL);
+	pool_destroy(&g_pool);
+}
+
+void set_latency_limits(int min_frames, int max_frames)
+{
+	g_min_latency = min_frames;
+	g_max_latency = (max_frames > 0) ? max_frames : 0;
+}
+
+void set_latency_callback(latency_callback callback)
+{
+	g_latency_callback = callback;
+}
+
+void read_driver_stats(driver_stats* stats)
+{
+	stats->periods = g_periods.load(std::memory_order_relaxed);
+	stats->underruns = g_underruns.load(std::memory_order_relaxed);
+	read_background_stats(&stats->background_budget_ns, &stats->background_used_ns);
 }
 
 const char* last_error()
@@ -208,4 +385,5 @@ const char* last_error()
 	return g_lasterror;
 }
 
+TINYAUDIO_DRIVER_END
 }
@@ -25,6 +25,8 @@
  */
 
 #include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
 
 #include <stdint.h>
 #include <stdio.h>
@@ -39,10 +41,7 @@ struct AndroidPlayer {
 
 	static const int c_nbuffers = 2;
 	static const int c_nsamples = 2048;
-	sample_type buffers[c_nbuffers][c_nsamples * 2];
-#if TINYAUDIO_FLOAT_BUS
-	int16_t scratch[c_nsamples * 2];
-#endif
+	buffer_pool buffers; // c_nbuffers of sample_type, then the int16_t scratch
 };
 
 static AndroidPlayer g_player = {0};
@@ -54,17 +53,22 @@ static void SLAPIENTRY audio_callback(SLAndroidSimpleBufferQueueItf bq, void* co
 
 	AndroidPlayer* p = (AndroidPlayer*)context;
 
-	sample_type* buffer = p->buffers[p->currentBuffer];
+	sample_type* buffer = (sample_type*)pool_block(&p->buffers, p->currentBuffer);
 
+	TINYAUDIO_TRACE_BEGIN(trace_callback);
 	p->callback(buffer, p->c_nsamples);
+	TINYAUDIO_TRACE_END("callback", trace_callback);
 
 #if TINYAUDIO_FLOAT_BUS
 	// convert from float to int16_t
+	int16_t* scratch = (int16_t*)pool_block(&p->buffers, p->c_nbuffers);
+	TINYAUDIO_TRACE_BEGIN(trace_convert);
 	for (int ii = 0; ii < p->c_nsamples*2; ++ii) {
-		p->scratch[ii] = (int16_t)(0x8000 * buffer[ii]);
+		scratch[ii] = (int16_t)(0x8000 * buffer[ii]);
 	}
+	TINYAUDIO_TRACE_END("conversion", trace_convert);
 
-	const int16_t* s16buffer = p->scratch;
+	const int16_t* s16buffer = scratch;
 #else
 	const int16_t* s16buffer = buffer;
 #endif
@@ -99,6 +103,11 @@ bool init(int sample_rate, samples_callback callback) {
 		return false;
 	}
 
+	if (!g_player.buffers.base && !pool_create(&g_player.buffers, sizeof(sample_type) * 2 * g_player.c_nsamples, g_player.c_nbuffers + 1)) {
+		snprintf(g_lasterror, c_nlasterror, "Failed to allocate sample buffers");
+		return false;
+	}
+
 	const SLEngineOption engineOpts[] = {
 		{SL_ENGINEOPTION_THREADSAFE}, {SL_BOOLEAN_FALSE},
 	};
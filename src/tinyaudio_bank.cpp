@@ -0,0 +1,484 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_bank.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tinyaudio {
+
+// File layout, little endian and used in place:
+//   BankHeader
+//   BankEntry[nsounds]
+//   sound data, each starting on a 64-byte boundary
+//
+// PCM data is interleaved int16. ADPCM data is a sequence of blocks, each
+// holding one AdpcmBlock per channel: the first sample verbatim, the step
+// index, then one nibble for each remaining frame.
+
+static const char c_magic[4] = { 'T', 'A', 'B', 'K' };
+static const uint32_t c_version = 1;
+static const size_t c_data_alignment = 64;
+
+struct BankHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t nsounds;
+	uint32_t reserved;
+	uint64_t size;
+};
+
+struct BankEntry {
+	uint64_t offset;
+	uint32_t nframes;
+	uint16_t channels;
+	uint16_t codec;
+};
+
+struct AdpcmBlock {
+	int16_t first;
+	uint8_t index;
+	uint8_t reserved;
+	uint8_t nibbles[bank_block_frames / 2];
+};
+
+struct bank {
+	const uint8_t* base;
+	size_t size;
+	bool mapped;
+	bool locked;
+};
+
+static const int16_t c_steps[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+	11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+	32767,
+};
+
+static const int8_t c_index_adjust[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+// One IMA-ADPCM step, shared by the encoder and decoder so they agree
+static inline void ima_expand(int* pred, int* index, int nibble)
+{
+	const int step = c_steps[*index];
+	int diff = step >> 3;
+	diff += (nibble & 1) ? (step >> 2) : 0;
+	diff += (nibble & 2) ? (step >> 1) : 0;
+	diff += (nibble & 4) ? step : 0;
+
+	int p = (nibble & 8) ? *pred - diff : *pred + diff;
+	p = (p < -32768) ? -32768 : ((p > 32767) ? 32767 : p);
+	*pred = p;
+
+	int i = *index + c_index_adjust[nibble];
+	i = (i < 0) ? 0 : ((i > 88) ? 88 : i);
+	*index = i;
+}
+
+static inline int ima_encode(int pred, int index, int sample)
+{
+	int diff = sample - pred;
+	int nibble = 0;
+	if (diff < 0) {
+		nibble = 8;
+		diff = -diff;
+	}
+
+	int step = c_steps[index];
+	if (diff >= step) {
+		nibble |= 4;
+		diff -= step;
+	}
+	step >>= 1;
+	if (diff >= step) {
+		nibble |= 2;
+		diff -= step;
+	}
+	step >>= 1;
+	if (diff >= step)
+		nibble |= 1;
+
+	return nibble;
+}
+
+// Decode frames [from, to) of a block into out. *pred and *index hold the
+// decoder state after frame at - 1 (at 0 starts from the block header) and
+// are left holding it after frame to - 1.
+static void decode_block(const AdpcmBlock* block, int at, int from, int to, int* pred, int* index, int16_t* out)
+{
+	if (at == 0) {
+		*pred = block->first;
+		*index = (block->index > 88) ? 88 : block->index;
+		if (from == 0)
+			out[0] = (int16_t)*pred;
+		at = 1;
+	}
+
+	for (int ii = at; ii < to; ++ii) {
+		const int nibble = (block->nibbles[(ii - 1) >> 1] >> (((ii - 1) & 1) * 4)) & 15;
+		ima_expand(pred, index, nibble);
+		if (ii >= from)
+			out[ii - from] = (int16_t)*pred;
+	}
+}
+
+static const BankHeader* header(const bank* b)
+{
+	return (const BankHeader*)b->base;
+}
+
+// NULL for an index out of range
+static const BankEntry* entry(const bank* b, int sound)
+{
+	if (sound < 0 || (uint32_t)sound >= header(b)->nsounds)
+		return NULL;
+	return (const BankEntry*)(b->base + sizeof(BankHeader)) + sound;
+}
+
+static uint64_t sound_bytes(const BankEntry* e)
+{
+	if (e->codec == bank_adpcm) {
+		const uint64_t nblocks = (e->nframes + bank_block_frames - 1) / bank_block_frames;
+		return nblocks * e->channels * sizeof(AdpcmBlock);
+	}
+
+	return (uint64_t)e->nframes * e->channels * sizeof(int16_t);
+}
+
+static bool validate(const uint8_t* base, size_t size)
+{
+	if (size < sizeof(BankHeader) || ((uintptr_t)base & 7))
+		return false;
+
+	const BankHeader* h = (const BankHeader*)base;
+	if (memcmp(h->magic, c_magic, sizeof(c_magic)) || h->version != c_version || h->size > size)
+		return false;
+	if (h->nsounds > (size - sizeof(BankHeader)) / sizeof(BankEntry))
+		return false;
+
+	// bounds only; the audio thread must never read past the end
+	const BankEntry* entries = (const BankEntry*)(base + sizeof(BankHeader));
+	for (uint32_t ii = 0; ii < h->nsounds; ++ii) {
+		const BankEntry* e = &entries[ii];
+		if ((e->channels != 1 && e->channels != 2) || e->codec > bank_adpcm)
+			return false;
+		if (e->offset > h->size || sound_bytes(e) > h->size - e->offset)
+			return false;
+	}
+
+	return true;
+}
+
+static const bank* adopt(const uint8_t* base, size_t size, bool mapped)
+{
+	bank* b = (bank*)allocate(sizeof(bank));
+	if (!b)
+		return NULL;
+
+	b->base = base;
+	b->size = size;
+	b->mapped = mapped;
+	b->locked = false;
+
+	// the audio thread decodes straight out of these pages
+	if (!(memory_settings()->flags & buffer_no_lock))
+		b->locked = (0 == mlock(base, size));
+	if (!b->locked) {
+		volatile uint8_t sink = 0;
+		for (size_t off = 0; off < size; off += 4096)
+			sink ^= base[off];
+		(void)sink;
+	}
+
+	return b;
+}
+
+const bank* bank_open(const char* path)
+{
+	const int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	struct stat st;
+	if (0 != fstat(fd, &st) || st.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+
+	const size_t size = (size_t)st.st_size;
+	void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	const bank* b = NULL;
+	if (validate((const uint8_t*)map, size))
+		b = adopt((const uint8_t*)map, size, true);
+	if (!b)
+		munmap(map, size);
+
+	return b;
+}
+
+const bank* bank_open_memory(const void* data, size_t size)
+{
+	if (!validate((const uint8_t*)data, size))
+		return NULL;
+
+	return adopt((const uint8_t*)data, size, false);
+}
+
+void bank_close(const bank* b)
+{
+	if (!b)
+		return;
+
+	if (b->locked)
+		munlock(b->base, b->size);
+	if (b->mapped)
+		munmap((void*)b->base, b->size);
+
+	deallocate((void*)b, sizeof(bank));
+}
+
+int bank_sound_count(const bank* b)
+{
+	return (int)header(b)->nsounds;
+}
+
+int bank_sound_frames(const bank* b, int sound)
+{
+	const BankEntry* e = entry(b, sound);
+	return e ? (int)e->nframes : 0;
+}
+
+int bank_sound_channels(const bank* b, int sound)
+{
+	const BankEntry* e = entry(b, sound);
+	return e ? e->channels : 0;
+}
+
+size_t bank_bytes(const bank* b)
+{
+	return b->size;
+}
+
+static inline sample_type to_bus(int16_t v)
+{
+#if TINYAUDIO_FLOAT_BUS
+	return v * (1.0f / 32768.0f);
+#else
+	return v;
+#endif
+}
+
+static void decode_pcm(const BankEntry* e, const int16_t* data, int frame, sample_type* out, int nframes)
+{
+	if (e->channels == 2) {
+		data += frame * 2;
+#if TINYAUDIO_FLOAT_BUS
+		for (int ii = 0; ii < nframes * 2; ++ii)
+			out[ii] = to_bus(data[ii]);
+#else
+		memcpy(out, data, sizeof(int16_t) * 2 * nframes);
+#endif
+		return;
+	}
+
+	data += frame;
+	for (int ii = 0; ii < nframes; ++ii)
+		out[ii * 2 + 0] = out[ii * 2 + 1] = to_bus(data[ii]);
+}
+
+static void decode_adpcm(const BankEntry* e, const AdpcmBlock* blocks, int frame, sample_type* out, int nframes, bank_cursor* cursor)
+{
+	const int channels = e->channels;
+	const int end = frame + nframes;
+
+	for (int block = frame / bank_block_frames; block * bank_block_frames < end; ++block) {
+		const int start = block * bank_block_frames;
+		const int from = (frame > start) ? frame : start;
+		const int to = (end < start + bank_block_frames) ? end : start + bank_block_frames;
+
+		// carry on from where this voice's last call stopped in this block
+		int at = 0;
+		int pred[2], index[2];
+		if (cursor && cursor->sound == e && cursor->frame == from && from != start) {
+			at = from - start;
+			for (int ch = 0; ch < channels; ++ch) {
+				pred[ch] = cursor->pred[ch];
+				index[ch] = cursor->index[ch];
+			}
+		}
+
+		int16_t decoded[2][bank_block_frames];
+		for (int ch = 0; ch < channels; ++ch)
+			decode_block(&blocks[block * channels + ch], at, from - start, to - start, &pred[ch], &index[ch], decoded[ch]);
+
+		const int16_t* left = decoded[0];
+		const int16_t* right = decoded[channels - 1];
+		sample_type* dst = out + (from - frame) * 2;
+		for (int ii = 0; ii < to - from; ++ii, dst += 2) {
+			dst[0] = to_bus(left[ii]);
+			dst[1] = to_bus(right[ii]);
+		}
+
+		if (cursor) {
+			cursor->sound = e;
+			cursor->frame = to;
+			for (int ch = 0; ch < channels; ++ch) {
+				cursor->pred[ch] = pred[ch];
+				cursor->index[ch] = index[ch];
+			}
+		}
+	}
+}
+
+int bank_decode(const bank* b, int sound, int frame, sample_type* out, int nframes, bank_cursor* cursor)
+{
+	const BankEntry* e = entry(b, sound);
+	if (!e || frame < 0 || (uint32_t)frame >= e->nframes || nframes <= 0)
+		return 0;
+
+	if ((uint32_t)nframes > e->nframes - frame)
+		nframes = (int)(e->nframes - frame);
+
+	const uint8_t* data = b->base + e->offset;
+	if (e->codec == bank_adpcm)
+		decode_adpcm(e, (const AdpcmBlock*)data, frame, out, nframes, cursor);
+	else
+		decode_pcm(e, (const int16_t*)data, frame, out, nframes);
+
+	return nframes;
+}
+
+static void encode_block(const short* samples, int channels, int channel, int nframes, int* index, AdpcmBlock* block)
+{
+	memset(block, 0, sizeof(*block));
+
+	int pred = samples[channel];
+	block->first = (int16_t)pred;
+	block->index = (uint8_t)*index;
+
+	for (int ii = 1; ii < nframes; ++ii) {
+		const int nibble = ima_encode(pred, *index, samples[ii * channels + channel]);
+		ima_expand(&pred, index, nibble);
+		block->nibbles[(ii - 1) >> 1] |= (uint8_t)(nibble << (((ii - 1) & 1) * 4));
+	}
+}
+
+static bool write_padding(FILE* fp, uint64_t* offset)
+{
+	static const uint8_t zeros[c_data_alignment] = { 0 };
+	const size_t pad = (size_t)((c_data_alignment - (*offset & (c_data_alignment - 1))) & (c_data_alignment - 1));
+	*offset += pad;
+	return pad == fwrite(zeros, 1, pad, fp);
+}
+
+bool bank_write(const char* path, const bank_sound* sounds, int nsounds)
+{
+	if (nsounds < 0)
+		return false;
+
+	for (int ii = 0; ii < nsounds; ++ii) {
+		const bank_sound* s = &sounds[ii];
+		if (!s->samples || s->nframes <= 0 || (s->channels != 1 && s->channels != 2))
+			return false;
+		if (s->codec != bank_pcm16 && s->codec != bank_adpcm)
+			return false;
+	}
+
+	FILE* fp = fopen(path, "wb");
+	if (!fp)
+		return false;
+
+	BankHeader h;
+	memcpy(h.magic, c_magic, sizeof(c_magic));
+	h.version = c_version;
+	h.nsounds = (uint32_t)nsounds;
+	h.reserved = 0;
+	h.size = 0;
+
+	// lay out the entries first so the whole table is known up front
+	uint64_t offset = sizeof(BankHeader) + sizeof(BankEntry) * (uint64_t)nsounds;
+	bool ok = (1 == fwrite(&h, sizeof(h), 1, fp));
+	for (int ii = 0; ii < nsounds && ok; ++ii) {
+		BankEntry e;
+		e.nframes = (uint32_t)sounds[ii].nframes;
+		e.channels = (uint16_t)sounds[ii].channels;
+		e.codec = (uint16_t)sounds[ii].codec;
+		offset = (offset + c_data_alignment - 1) & ~(uint64_t)(c_data_alignment - 1);
+		e.offset = offset;
+		offset += sound_bytes(&e);
+		ok = (1 == fwrite(&e, sizeof(e), 1, fp));
+	}
+	h.size = offset;
+
+	offset = sizeof(BankHeader) + sizeof(BankEntry) * (uint64_t)nsounds;
+	for (int ii = 0; ii < nsounds && ok; ++ii) {
+		const bank_sound* s = &sounds[ii];
+		ok = write_padding(fp, &offset);
+
+		if (s->codec == bank_pcm16) {
+			const size_t count = (size_t)s->nframes * s->channels;
+			ok = ok && (count == fwrite(s->samples, sizeof(short), count, fp));
+			offset += count * sizeof(short);
+			continue;
+		}
+
+		int index[2] = { 0, 0 };
+		for (int start = 0; start < s->nframes && ok; start += bank_block_frames) {
+			const int n = (s->nframes - start < bank_block_frames) ? s->nframes - start : bank_block_frames;
+			for (int ch = 0; ch < s->channels && ok; ++ch) {
+				AdpcmBlock block;
+				encode_block(s->samples + start * s->channels, s->channels, ch, n, &index[ch], &block);
+				ok = (1 == fwrite(&block, sizeof(block), 1, fp));
+				offset += sizeof(block);
+			}
+		}
+	}
+
+	// now the total size is known
+	ok = ok && 0 == fseek(fp, 0, SEEK_SET) && 1 == fwrite(&h, sizeof(h), 1, fp);
+	ok = (0 == fclose(fp)) && ok;
+	return ok;
+}
+
+}
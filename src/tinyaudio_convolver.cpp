@@ -0,0 +1,351 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_convolver.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "tinyaudio_fft.h"
+#include "tinyaudio_kernels.h"
+
+#include <atomic>
+#include <pthread.h>
+#include <semaphore.h>
+#include <string.h>
+
+namespace tinyaudio {
+
+static const int c_nminblock = 16;
+static const int c_nmaxblock = 1024;
+static const int c_nchunk = 256; // frames converted per pass
+static const int c_nworker_lead = 2048; // frames of warning the worker gets
+static const int c_nmaxlead = c_nworker_lead / c_nminblock + 1;
+
+// Spectra are m = block bins stored as [re | im]
+struct ConvolverChannel {
+	float* head; // first `block` taps
+	float* input; // previous block, then the current one
+	float* tail; // tail output for the current block
+	float* partitions; // spectra of the tail partitions
+	float* spectra; // input spectra, a ring of g_nslots
+	float* sums; // worker results, g_lead + 1 slots
+	float* acc;
+	float* scratch; // 2 * block time-domain samples
+};
+
+static samples_callback g_render;
+static buffer_pool g_pool;
+static Fft g_fft;
+static ConvolverChannel g_channels[2];
+static float* g_left;
+static float* g_right;
+static int g_block;
+static int g_npartitions;
+static int g_nslots;
+static int g_lead; // partitions below this index stay on the audio thread
+static int g_pos; // frames into the current block
+static unsigned g_nblocks; // blocks completed
+
+static bool g_use_worker;
+static pthread_t g_thread;
+static sem_t g_wake;
+static std::atomic<bool> g_running;
+static std::atomic<unsigned> g_published; // newest block whose spectrum is in the ring
+static std::atomic<unsigned> g_ready[c_nmaxlead + 1]; // block each sum slot holds
+static std::atomic<unsigned> g_misses;
+
+static float* spectrum(const ConvolverChannel* ch, unsigned block)
+{
+	return ch->spectra + (block % g_nslots) * 2 * g_block;
+}
+
+// acc += x * h, complex, over [re | im] spectra. Bin 0 holds two real
+// values (DC, Nyquist) and is patched up after the vector loop.
+static void mac(float* acc, const float* x, const float* h)
+{
+	const int m = g_block;
+	float* ar = acc;
+	float* ai = acc + m;
+	const float* xr = x;
+	const float* xi = x + m;
+	const float* hr = h;
+	const float* hi = h + m;
+
+	const float dc = ar[0] + xr[0] * hr[0];
+	const float nyquist = ai[0] + xi[0] * hi[0];
+
+	for (int ii = 0; ii < m; ii += c_simd_width) {
+		const vfloat a = vload(xr + ii), b = vload(xi + ii);
+		const vfloat c = vload(hr + ii), d = vload(hi + ii);
+		vstore(ar + ii, vadd(vload(ar + ii), vsub(vmul(a, c), vmul(b, d))));
+		vstore(ai + ii, vmadd(a, d, vmadd(b, c, vload(ai + ii))));
+	}
+
+	ar[0] = dc;
+	ai[0] = nyquist;
+}
+
+// Add partitions [first, last] of the output of `block`; partition p only
+// needs the spectrum of block - p
+static void sum_tail(const ConvolverChannel* ch, unsigned block, unsigned first, unsigned last, float* out)
+{
+	if (last > block)
+		last = block;
+
+	for (unsigned p = first; p <= last; ++p)
+		mac(out, spectrum(ch, block - p), ch->partitions + p * 2 * g_block);
+}
+
+static float* sum_slot(const ConvolverChannel* ch, unsigned block)
+{
+	return ch->sums + (block % (g_lead + 1)) * 2 * g_block;
+}
+
+// Sums the far partitions (g_lead and up) of a block g_lead blocks ahead of
+// the newest spectrum, so it has about c_nworker_lead frames to finish
+static void* convolver_worker(void*)
+{
+	unsigned next = 0;
+	for (;;) {
+		sem_wait(&g_wake);
+		if (!g_running.load(std::memory_order_acquire))
+			break;
+
+		const unsigned newest = g_published.load(std::memory_order_acquire);
+		if ((int)(newest + 1 - (next + g_lead)) > 0)
+			next = newest + 1 - g_lead; // fell behind, skip what is already due
+
+		for (; (int)(newest - next) >= 0; ++next) {
+			const unsigned block = next + g_lead;
+			for (int c = 0; c < 2; ++c) {
+				float* out = sum_slot(&g_channels[c], block);
+				memset(out, 0, sizeof(float) * 2 * g_block);
+				sum_tail(&g_channels[c], block, g_lead, g_npartitions - 1, out);
+			}
+
+			g_ready[block % (g_lead + 1)].store(block, std::memory_order_release);
+		}
+	}
+
+	return NULL;
+}
+
+static void head_fir(const ConvolverChannel* ch, float* out, int n)
+{
+	const float* x = ch->input + g_block + g_pos;
+	const int nvec = n & ~(c_simd_width - 1);
+
+	for (int ii = 0; ii < nvec; ii += c_simd_width) {
+		vfloat acc = vload(ch->tail + g_pos + ii);
+		for (int t = 0; t < g_block; ++t)
+			acc = vmadd(vset1(ch->head[t]), vload(x + ii - t), acc);
+		vstore(out + ii, acc);
+	}
+
+	for (int ii = nvec; ii < n; ++ii) {
+		float acc = ch->tail[g_pos + ii];
+		for (int t = 0; t < g_block; ++t)
+			acc += ch->head[t] * x[ii - t];
+		out[ii] = acc;
+	}
+}
+
+// The current block is complete: transform it and produce the tail output
+// for the next one
+static void end_block()
+{
+	const unsigned block = g_nblocks;
+
+	// before block g_lead the far partitions only see silence
+	bool far_done = false;
+	if (g_use_worker) {
+		far_done = block < (unsigned)g_lead || g_ready[block % (g_lead + 1)].load(std::memory_order_acquire) == block;
+		if (!far_done)
+			g_misses.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	for (int c = 0; c < 2; ++c) {
+		ConvolverChannel* ch = &g_channels[c];
+		if (!g_npartitions) {
+			memcpy(ch->input, ch->input + g_block, sizeof(float) * g_block);
+			continue;
+		}
+
+		float* x = spectrum(ch, block);
+		fft_real_forward(&g_fft, ch->input, x, x + g_block);
+
+		if (far_done && block >= (unsigned)g_lead)
+			memcpy(ch->acc, sum_slot(ch, block), sizeof(float) * 2 * g_block);
+		else
+			memset(ch->acc, 0, sizeof(float) * 2 * g_block);
+		sum_tail(ch, block, 1, far_done ? g_lead - 1 : g_npartitions - 1, ch->acc);
+
+		mac(ch->acc, x, ch->partitions);
+		fft_real_inverse(&g_fft, ch->acc, ch->acc + g_block, ch->scratch);
+		memcpy(ch->tail, ch->scratch + g_block, sizeof(float) * g_block);
+
+		memcpy(ch->input, ch->input + g_block, sizeof(float) * g_block);
+	}
+
+	++g_nblocks;
+	if (g_use_worker) {
+		g_published.store(block, std::memory_order_release);
+		sem_post(&g_wake);
+	}
+}
+
+bool convolver_init(samples_callback render, const float* ir_left, const float* ir_right, int ir_frames, int block_frames, bool worker)
+{
+	if (!render || !ir_left || !ir_right || ir_frames <= 0)
+		return false;
+
+	int block = c_nminblock;
+	while (block < block_frames && block < c_nmaxblock)
+		block <<= 1;
+
+	const int tail_frames = (ir_frames > block) ? ir_frames - block : 0;
+	const int npartitions = (tail_frames + block - 1) / block;
+	const int nslots = npartitions + 1;
+	const int lead = c_nworker_lead / block + 1;
+
+	// every piece is a multiple of 16 floats, so all stay 64-byte aligned
+	const size_t spectrum_floats = 2 * (size_t)block;
+	const size_t channel_floats = block + 2 * block + block
+		+ spectrum_floats * npartitions + spectrum_floats * nslots
+		+ spectrum_floats * (lead + 1) + spectrum_floats + 2 * block;
+	const size_t bytes = fft_bytes(block) + sizeof(float) * (2 * channel_floats + 2 * c_nchunk);
+	if (!pool_create(&g_pool, bytes, 1))
+		return false;
+
+	char* base = (char*)pool_block(&g_pool, 0);
+	fft_setup(&g_fft, block, base);
+	float* p = (float*)(base + fft_bytes(block));
+
+	g_block = block;
+	g_npartitions = npartitions;
+	g_nslots = nslots;
+	g_lead = lead;
+
+	const float scale = 1.0f / block; // undoes the unnormalized inverse
+	const float* irs[2] = { ir_left, ir_right };
+	for (int c = 0; c < 2; ++c) {
+		ConvolverChannel* ch = &g_channels[c];
+		ch->head = p; p += block;
+		ch->input = p; p += 2 * block;
+		ch->tail = p; p += block;
+		ch->partitions = p; p += spectrum_floats * npartitions;
+		ch->spectra = p; p += spectrum_floats * nslots;
+		ch->sums = p; p += spectrum_floats * (lead + 1);
+		ch->acc = p; p += spectrum_floats;
+		ch->scratch = p; p += 2 * block;
+
+		const float* ir = irs[c];
+		for (int t = 0; t < block && t < ir_frames; ++t)
+			ch->head[t] = ir[t];
+
+		for (int part = 0; part < npartitions; ++part) {
+			memset(ch->scratch, 0, sizeof(float) * 2 * block);
+			const int start = block + part * block;
+			for (int t = 0; t < block && start + t < ir_frames; ++t)
+				ch->scratch[t] = ir[start + t] * scale;
+
+			float* h = ch->partitions + part * spectrum_floats;
+			fft_real_forward(&g_fft, ch->scratch, h, h + block);
+		}
+	}
+	g_left = p; p += c_nchunk;
+	g_right = p;
+
+	g_render = render;
+	g_pos = 0;
+	g_nblocks = 0;
+	g_misses.store(0);
+	g_published.store(0);
+	for (int ii = 0; ii <= c_nmaxlead; ++ii)
+		g_ready[ii].store(~0u);
+
+	// only worth a thread when there are partitions past the lead
+	g_use_worker = worker && npartitions > lead;
+	if (g_use_worker) {
+		sem_init(&g_wake, 0, 0);
+		g_running.store(true);
+		if (0 != pthread_create(&g_thread, NULL, &convolver_worker, NULL)) {
+			sem_destroy(&g_wake);
+			g_use_worker = false;
+		}
+	}
+
+	return true;
+}
+
+void convolver_release()
+{
+	if (g_use_worker) {
+		g_running.store(false, std::memory_order_release);
+		sem_post(&g_wake);
+		pthread_join(g_thread, NULL);
+		sem_destroy(&g_wake);
+		g_use_worker = false;
+	}
+
+	pool_destroy(&g_pool);
+	g_render = NULL;
+}
+
+void convolver_render(sample_type* samples, int nsamples)
+{
+	g_render(samples, nsamples);
+
+	while (nsamples) {
+		int n = g_block - g_pos;
+		if (n > c_nchunk)
+			n = c_nchunk;
+		if (n > nsamples)
+			n = nsamples;
+
+		bus_to_stereo(samples, g_left, g_right, n);
+		memcpy(g_channels[0].input + g_block + g_pos, g_left, sizeof(float) * n);
+		memcpy(g_channels[1].input + g_block + g_pos, g_right, sizeof(float) * n);
+
+		head_fir(&g_channels[0], g_left, n);
+		head_fir(&g_channels[1], g_right, n);
+		stereo_to_bus(g_left, g_right, samples, n);
+
+		samples += n * 2;
+		nsamples -= n;
+		g_pos += n;
+		if (g_pos == g_block) {
+			end_block();
+			g_pos = 0;
+		}
+	}
+}
+
+unsigned convolver_worker_misses()
+{
+	return g_misses.load(std::memory_order_relaxed);
+}
+
+}
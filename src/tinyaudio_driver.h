@@ -0,0 +1,88 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_DRIVER_H
+#define TINYAUDIO_DRIVER_H
+
+// Lets one translation unit (tinyaudio_linux.cpp) include several drivers
+// and pick one at runtime. Internal.
+//
+// Built normally, a driver's entry points are tinyaudio::init and friends
+// and it links its system library directly. With TINYAUDIO_DYNLOAD=1 each
+// driver's body moves into namespace
+// tinyaudio::TINYAUDIO_DRIVER_NAMESPACE (set before including it), and
+// every library function it calls becomes a function pointer of the same
+// name in that namespace, resolved from dlopen when the driver's init
+// runs.
+
+#ifndef TINYAUDIO_DYNLOAD
+#define TINYAUDIO_DYNLOAD 0
+#endif
+
+#if TINYAUDIO_DYNLOAD
+
+#include <dlfcn.h>
+#include <string.h>
+
+#define TINYAUDIO_DRIVER_BEGIN namespace TINYAUDIO_DRIVER_NAMESPACE {
+#define TINYAUDIO_DRIVER_END }
+
+// X-macros over a driver's symbol list
+#define TINYAUDIO_DYNLOAD_DECLARE(fn) static decltype(&::fn) fn;
+#define TINYAUDIO_DYNLOAD_RESOLVE(fn) ok = dynload_symbol(handle, #fn, &fn) && ok;
+
+namespace tinyaudio {
+
+// First of the sonames that loads; the library then stays loaded
+static inline void* dynload_open(const char* const* sonames)
+{
+	for (; *sonames; ++sonames) {
+		void* handle = dlopen(*sonames, RTLD_NOW | RTLD_LOCAL);
+		if (handle)
+			return handle;
+	}
+
+	return NULL;
+}
+
+template <typename T>
+static inline bool dynload_symbol(void* handle, const char* name, T* fn)
+{
+	void* symbol = dlsym(handle, name);
+	memcpy(fn, &symbol, sizeof(symbol));
+	return symbol != NULL;
+}
+
+}
+
+#else
+
+#define TINYAUDIO_DRIVER_BEGIN
+#define TINYAUDIO_DRIVER_END
+
+#endif
+
+#endif
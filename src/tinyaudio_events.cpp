@@ -0,0 +1,118 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_events.h"
+#include "tinyaudio_queue.h"
+
+#include <atomic>
+
+namespace tinyaudio {
+
+static const int c_nevents = 1024;
+
+static samples_callback g_render;
+static event_callback g_on_event;
+static MpscQueue<event, c_nevents> g_queue;
+static std::atomic<uint64_t> g_frame;
+static std::atomic<unsigned> g_late;
+
+// Events pulled off the queue but not yet due, sorted by frame. Audio thread
+// only.
+static event g_pending[c_nevents];
+static int g_npending;
+
+static void pending_insert(const event* ev)
+{
+	// keep posting order for events on the same frame
+	int ii = g_npending++;
+	for (; ii > 0 && g_pending[ii - 1].frame > ev->frame; --ii)
+		g_pending[ii] = g_pending[ii - 1];
+	g_pending[ii] = *ev;
+}
+
+void events_init(samples_callback render, event_callback on_event)
+{
+	g_render = render;
+	g_on_event = on_event;
+	g_queue.reset();
+	g_frame.store(0);
+	g_late.store(0);
+	g_npending = 0;
+}
+
+void events_render(sample_type* samples, int nsamples)
+{
+	event ev;
+	while (g_npending < c_nevents && g_queue.pop(&ev))
+		pending_insert(&ev);
+
+	const uint64_t start = g_frame.load(std::memory_order_relaxed);
+	const uint64_t end = start + nsamples;
+	uint64_t pos = start;
+	int next = 0;
+
+	while (pos < end) {
+
+		for (; next < g_npending && g_pending[next].frame <= pos; ++next) {
+			const bool late = g_pending[next].frame < start;
+			if (late)
+				g_late.fetch_add(1, std::memory_order_relaxed);
+			g_on_event(&g_pending[next], late);
+		}
+
+		uint64_t split = end;
+		if (next < g_npending && g_pending[next].frame < end)
+			split = g_pending[next].frame;
+
+		g_render(samples + (pos - start) * 2, (int)(split - pos));
+		pos = split;
+	}
+
+	// drop the delivered events from the front
+	for (int ii = next; ii < g_npending; ++ii)
+		g_pending[ii - next] = g_pending[ii];
+	g_npending -= next;
+
+	g_frame.store(end, std::memory_order_release);
+}
+
+bool post_event(const event* ev)
+{
+	return g_queue.push(*ev);
+}
+
+uint64_t events_stream_frame()
+{
+	return g_frame.load(std::memory_order_acquire);
+}
+
+unsigned events_late()
+{
+	return g_late.load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,206 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_FFT_H
+#define TINYAUDIO_FFT_H
+
+// Radix-2 FFT on split (separate real/imaginary) arrays, sized for the
+// convolver: tables are set up once into caller-provided memory and the
+// transforms never allocate. Butterflies use the SIMD layer once the
+// stage is wide enough. Transforms are unnormalized. Internal.
+
+#include <math.h>
+#include <stddef.h>
+#include "TINYAUDIO/tinyaudio_simd.h"
+
+namespace tinyaudio {
+
+struct Fft {
+	int m; // complex points, a power of two
+	float* twr; // stage twiddles; the stage with half-size h starts at h - 1
+	float* twi;
+	float* rwr; // exp(-i pi k / m), k < m, for the real transform
+	float* rwi;
+	int* bitrev;
+};
+
+static inline size_t fft_bytes(int m)
+{
+	return sizeof(float) * 4 * m + sizeof(int) * m;
+}
+
+static inline void fft_setup(Fft* f, int m, void* memory)
+{
+	float* p = (float*)memory;
+	f->m = m;
+	f->twr = p;
+	f->twi = p + m;
+	f->rwr = p + 2 * m;
+	f->rwi = p + 3 * m;
+	f->bitrev = (int*)(p + 4 * m);
+
+	for (int h = 1; h < m; h <<= 1) {
+		for (int j = 0; j < h; ++j) {
+			const double angle = -3.14159265358979323846 * j / h;
+			f->twr[h - 1 + j] = (float)cos(angle);
+			f->twi[h - 1 + j] = (float)sin(angle);
+		}
+	}
+
+	for (int k = 0; k < m; ++k) {
+		const double angle = -3.14159265358979323846 * k / m;
+		f->rwr[k] = (float)cos(angle);
+		f->rwi[k] = (float)sin(angle);
+	}
+
+	int bits = 0;
+	while ((1 << bits) < m)
+		++bits;
+	for (int ii = 0; ii < m; ++ii) {
+		int r = 0;
+		for (int b = 0; b < bits; ++b)
+			r |= ((ii >> b) & 1) << (bits - 1 - b);
+		f->bitrev[ii] = r;
+	}
+}
+
+// In-place forward transform. Pass (im, re) instead of (re, im) for the
+// inverse.
+static inline void fft_complex(const Fft* f, float* re, float* im)
+{
+	const int m = f->m;
+	for (int ii = 0; ii < m; ++ii) {
+		const int r = f->bitrev[ii];
+		if (ii < r) {
+			float t = re[ii]; re[ii] = re[r]; re[r] = t;
+			t = im[ii]; im[ii] = im[r]; im[r] = t;
+		}
+	}
+
+	for (int h = 1; h < m; h <<= 1) {
+		const float* wr = f->twr + h - 1;
+		const float* wi = f->twi + h - 1;
+		for (int g = 0; g < m; g += 2 * h) {
+			float* ar = re + g;
+			float* ai = im + g;
+			float* br = re + g + h;
+			float* bi = im + g + h;
+
+			int j = 0;
+			if (h >= c_simd_width) {
+				for (; j < h; j += c_simd_width) {
+					const vfloat xr = vload(br + j), xi = vload(bi + j);
+					const vfloat cr = vload(wr + j), ci = vload(wi + j);
+					const vfloat tr = vsub(vmul(xr, cr), vmul(xi, ci));
+					const vfloat ti = vadd(vmul(xr, ci), vmul(xi, cr));
+					const vfloat yr = vload(ar + j), yi = vload(ai + j);
+					vstore(ar + j, vadd(yr, tr));
+					vstore(ai + j, vadd(yi, ti));
+					vstore(br + j, vsub(yr, tr));
+					vstore(bi + j, vsub(yi, ti));
+				}
+			}
+			for (; j < h; ++j) {
+				const float tr = br[j] * wr[j] - bi[j] * wi[j];
+				const float ti = br[j] * wi[j] + bi[j] * wr[j];
+				br[j] = ar[j] - tr;
+				bi[j] = ai[j] - ti;
+				ar[j] += tr;
+				ai[j] += ti;
+			}
+		}
+	}
+}
+
+// 2m real samples to m bins. Bin 0 packs DC in re[0] and Nyquist in im[0].
+static inline void fft_real_forward(const Fft* f, const float* x, float* re, float* im)
+{
+	const int m = f->m;
+	for (int ii = 0; ii < m; ++ii) {
+		re[ii] = x[ii * 2 + 0];
+		im[ii] = x[ii * 2 + 1];
+	}
+
+	fft_complex(f, re, im);
+
+	// split the even/odd halves, one mirrored pair of bins at a time
+	const float r0 = re[0], i0 = im[0];
+	re[0] = r0 + i0;
+	im[0] = r0 - i0;
+
+	for (int k = 1; k <= m / 2; ++k) {
+		const int n = m - k;
+		const float ar = re[k], ai = im[k], br = re[n], bi = im[n];
+
+		const float er = 0.5f * (ar + br), ei = 0.5f * (ai - bi);
+		const float or_ = 0.5f * (ai + bi), oi = -0.5f * (ar - br);
+		re[k] = er + f->rwr[k] * or_ - f->rwi[k] * oi;
+		im[k] = ei + f->rwr[k] * oi + f->rwi[k] * or_;
+
+		// bin n: E and O of n are the conjugates of those of k
+		const float wr = f->rwr[n], wi = f->rwi[n];
+		re[n] = er + wr * or_ + wi * oi;
+		im[n] = -ei - wr * oi + wi * or_;
+	}
+}
+
+// Inverse of fft_real_forward, scaled by m. Overwrites re/im.
+static inline void fft_real_inverse(const Fft* f, float* re, float* im, float* x)
+{
+	const int m = f->m;
+
+	const float dc = re[0], nyquist = im[0];
+	re[0] = 0.5f * (dc + nyquist);
+	im[0] = 0.5f * (dc - nyquist);
+
+	for (int k = 1; k <= m / 2; ++k) {
+		const int n = m - k;
+		const float ar = re[k], ai = im[k], br = re[n], bi = im[n];
+
+		// E = (X[k] + conj X[n]) / 2, O = (X[k] - conj X[n]) * conj(w^k) / 2
+		const float er = 0.5f * (ar + br), ei = 0.5f * (ai - bi);
+		const float dr = 0.5f * (ar - br), di = 0.5f * (ai + bi);
+		const float wr = f->rwr[k], wi = f->rwi[k];
+		const float or_ = dr * wr + di * wi, oi = di * wr - dr * wi;
+
+		// Z[k] = E + iO, Z[n] = conj(E) + i conj(O)
+		re[k] = er - oi;
+		im[k] = ei + or_;
+		re[n] = er + oi;
+		im[n] = -ei + or_;
+	}
+
+	fft_complex(f, im, re);
+
+	for (int ii = 0; ii < m; ++ii) {
+		x[ii * 2 + 0] = re[ii];
+		x[ii * 2 + 1] = im[ii];
+	}
+}
+
+}
+
+#endif
@@ -0,0 +1,231 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio_generator.h"
+#include "TINYAUDIO/tinyaudio_simd.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace tinyaudio {
+
+static const int c_max_width = 8;
+static const float c_two_pi = 6.283185307f;
+
+// Kellet's economy pink filter; the gain keeps its peaks below full scale
+static const float c_pink_poles[3] = { 0.99765f, 0.96300f, 0.57000f };
+static const float c_pink_zeros[3] = { 0.0990460f, 0.2965164f, 1.0526913f };
+static const float c_pink_direct = 0.1848f;
+static const float c_pink_gain = 0.1f;
+
+static generator g_generator;
+
+// sin(2 pi x) for x in [-0.5, 0.5]: fold into [-0.25, 0.25], then an odd
+// Taylor polynomial that is good to float precision there
+static inline vfloat vsin_cycles(vfloat x)
+{
+	const vfloat excess = vsub(x, vmax(vmin(x, vset1(0.25f)), vset1(-0.25f)));
+	const vfloat t = vmul(vsub(x, vadd(excess, excess)), vset1(c_two_pi));
+	const vfloat t2 = vmul(t, t);
+
+	vfloat p = vset1(-1.0f / 39916800.0f);
+	p = vmadd(p, t2, vset1(1.0f / 362880.0f));
+	p = vmadd(p, t2, vset1(-1.0f / 5040.0f));
+	p = vmadd(p, t2, vset1(1.0f / 120.0f));
+	p = vmadd(p, t2, vset1(-1.0f / 6.0f));
+	p = vmadd(p, t2, vset1(1.0f));
+	return vmul(p, t);
+}
+
+// Saw for x in [-0.5, 0.5], jumping at the ends, with the PolyBLEP
+// residual subtracted within one increment of the jump
+static inline vfloat vsaw_cycles(vfloat x, vfloat inv_dt)
+{
+	const vfloat zero = vset1(0.0f);
+	const vfloat one = vset1(1.0f);
+	const vfloat t = vadd(x, vset1(0.5f));
+	const vfloat u = vmax(zero, vsub(one, vmul(t, inv_dt)));
+	const vfloat v = vmax(zero, vsub(one, vmul(vsub(one, t), inv_dt)));
+	return vadd(vsub(vadd(x, x), vmul(v, v)), vmul(u, u));
+}
+
+static inline float pink_filter(float* state, float white)
+{
+	float out = white * c_pink_direct;
+	for (int ii = 0; ii < 3; ++ii) {
+		state[ii] = state[ii] * c_pink_poles[ii] + white * c_pink_zeros[ii];
+		out += state[ii];
+	}
+
+	return out * c_pink_gain;
+}
+
+// Advance the phase (and the sweep) past n frames. The phase is only
+// wrapped once per fill, keeping the loop-carried chain to one add.
+static void advance(generator* g, int n)
+{
+	g->phase += g->increment * g->offsets[n];
+	if (!g->sweep_frames)
+		return;
+
+	g->increment *= g->ratios[n];
+	g->sweep_left -= n;
+	if (g->sweep_left <= 0) {
+		g->increment = g->start_increment;
+		g->sweep_left += g->sweep_frames;
+	}
+}
+
+// The next c_simd_width frames of the signal, at unit gain
+static inline vfloat next_vector(generator* g, vfloat offsets)
+{
+	vfloat value;
+
+	switch (g->waveform) {
+	case generator_white:
+	case generator_pink: {
+		const vuint state = vxorshift(vuload(g->noise));
+		vustore(g->noise, state);
+		value = vunit(state);
+		if (g->waveform == generator_pink) {
+			float lanes[c_max_width];
+			vstore(lanes, value);
+			for (int ii = 0; ii < c_simd_width; ++ii)
+				lanes[ii] = pink_filter(g->pink, lanes[ii]);
+			value = vload(lanes);
+		}
+		return value;
+	}
+	default:
+		break;
+	}
+
+	const float increment = (float)g->increment;
+	const float phase = (float)(g->phase - (double)(int64_t)g->phase);
+	const vfloat p = vmadd(vset1(increment), offsets, vset1(phase));
+	const vfloat x = vsub(p, vround(p));
+
+	if (g->waveform == generator_sine) {
+		value = vsin_cycles(x);
+	} else if (g->waveform == generator_saw) {
+		value = vsaw_cycles(x, vset1(1.0f / increment));
+	} else {
+		const vfloat inv_dt = vset1(1.0f / increment);
+		const vfloat p2 = vadd(p, vset1(0.5f));
+		const vfloat x2 = vsub(p2, vround(p2));
+		value = vsub(vsaw_cycles(x, inv_dt), vsaw_cycles(x2, inv_dt));
+	}
+
+	advance(g, c_simd_width);
+	return value;
+}
+
+void generator_reset(generator* g, int sample_rate, const generator_settings* settings)
+{
+	memset(g, 0, sizeof(*g));
+	g->waveform = settings->waveform;
+	g->gain = fminf(fmaxf(settings->gain, 0.0f), 1.0f);
+
+	const double nyquist = sample_rate * 0.5;
+	const double start = fmin(fmax(settings->frequency, 1.0e-3), nyquist * 0.99);
+	g->increment = g->start_increment = start / sample_rate;
+	g->sweep_ratio = 1.0;
+	if (settings->end_frequency > 0.0f && settings->sweep_seconds > 0.0f) {
+		const double end = fmin(fmax(settings->end_frequency, 1.0e-3), nyquist * 0.99);
+		g->sweep_frames = (int)ceil(settings->sweep_seconds * sample_rate);
+		g->sweep_left = g->sweep_frames;
+		g->sweep_ratio = pow(end / start, 1.0 / g->sweep_frames);
+	}
+
+	g->offsets[0] = 0.0;
+	g->ratios[0] = 1.0;
+	for (int ii = 1; ii <= c_max_width; ++ii) {
+		g->offsets[ii] = g->offsets[ii - 1] + g->ratios[ii - 1];
+		g->ratios[ii] = g->ratios[ii - 1] * g->sweep_ratio;
+	}
+
+	// distinct, non-zero xorshift states for every lane
+	uint32_t seed = settings->seed;
+	for (int ii = 0; ii < c_max_width; ++ii) {
+		seed = seed * 1664525u + 1013904223u;
+		g->noise[ii] = (seed ^ (seed >> 16)) | 1u;
+	}
+}
+
+void generator_fill(generator* g, sample_type* samples, int nframes)
+{
+	float lane_offsets[c_max_width];
+	for (int ii = 0; ii < c_max_width; ++ii)
+		lane_offsets[ii] = (float)g->offsets[ii];
+	const vfloat offsets = vload(lane_offsets);
+
+	const vfloat one = vset1(1.0f);
+	const vfloat minus_one = vset1(-1.0f);
+#if TINYAUDIO_FLOAT_BUS
+	const vfloat gain = vset1(g->gain);
+#else
+	const vfloat gain = vset1(g->gain * 32767.0f);
+#endif
+
+	for (int ii = 0; ii < nframes; ii += c_simd_width) {
+		const int n = nframes - ii;
+		const double phase = g->phase;
+		const double increment = g->increment;
+		const int sweep_left = g->sweep_left;
+		const vfloat v = vmul(vmax(vmin(next_vector(g, offsets), one), minus_one), gain);
+
+		// a whole vector is rendered for the tail too; keep only its
+		// frames and the phase they reach
+		sample_type frames[c_max_width * 2];
+		sample_type* out = (n < c_simd_width) ? frames : samples + ii * 2;
+#if TINYAUDIO_FLOAT_BUS
+		vstore_stereo(out, v, v);
+#else
+		vstore_stereo_s16(out, v, v);
+#endif
+		if (n < c_simd_width) {
+			memcpy(samples + ii * 2, frames, sizeof(sample_type) * 2 * n);
+			g->phase = phase;
+			g->increment = increment;
+			g->sweep_left = sweep_left;
+			advance(g, n);
+		}
+	}
+
+	g->phase -= (double)(int64_t)g->phase;
+}
+
+void generator_init(int sample_rate, const generator_settings* settings)
+{
+	generator_reset(&g_generator, sample_rate, settings);
+}
+
+void generator_render(sample_type* samples, int nsamples)
+{
+	generator_fill(&g_generator, samples, nsamples);
+}
+
+}
@@ -0,0 +1,419 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_graph.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+#include "tinyaudio_kernels.h"
+
+#include <atomic>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+namespace tinyaudio {
+
+static const int c_nmaxframes = 1024;
+static const int c_nmaxnodes = 1024;
+static const int c_nmaxedges = c_nmaxnodes * 8;
+static const int c_nmaxthreads = 64;
+static const int c_nspins = 4096; // spins before a waiting thread yields its core
+
+struct GraphNode {
+	graph_process process;
+	void* context;
+	int indegree;
+	int ninputs;
+	int first_input; // into g_inputs
+	int nsuccessors;
+	int first_successor; // into g_successors
+};
+
+// Chase-Lev work-stealing deque. Each node is pushed at most once per
+// period, so the buffer never wraps; it is reset between periods while every
+// worker is idle.
+struct WorkDeque {
+	std::atomic<int> top;
+	char pad0[60];
+	std::atomic<int> bottom;
+	char pad1[60];
+	int tasks[c_nmaxnodes];
+
+	void reset()
+	{
+		top.store(0, std::memory_order_relaxed);
+		bottom.store(0, std::memory_order_relaxed);
+	}
+
+	void push(int task)
+	{
+		const int b = bottom.load(std::memory_order_relaxed);
+		tasks[b] = task;
+		bottom.store(b + 1, std::memory_order_release);
+	}
+
+	int pop()
+	{
+		const int b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int t = top.load(std::memory_order_relaxed);
+		if (t > b) {
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return -1;
+		}
+
+		int task = tasks[b];
+		if (t == b) {
+			// last item: race the thieves for it
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				task = -1;
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+
+		return task;
+	}
+
+	int steal()
+	{
+		int t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int b = bottom.load(std::memory_order_acquire);
+		if (t >= b)
+			return -1;
+
+		const int task = tasks[t];
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return -1;
+		return task;
+	}
+};
+
+static GraphNode g_nodes[c_nmaxnodes];
+static int g_nnodes;
+static int g_max_nodes;
+static int g_edge_from[c_nmaxedges];
+static int g_edge_to[c_nmaxedges];
+static int g_nedges;
+static const float* g_inputs[c_nmaxedges];
+static int g_successors[c_nmaxedges];
+static int g_roots[c_nmaxnodes];
+static int g_nroots;
+static int g_output = -1;
+static bool g_compiled;
+
+static std::atomic<int> g_pending[c_nmaxnodes];
+static std::atomic<uint64_t> g_node_ns[c_nmaxnodes];
+static WorkDeque g_deques[c_nmaxthreads];
+static buffer_pool g_pool; // one stereo block per node
+
+static pthread_t g_threads[c_nmaxthreads];
+static int g_nthreads;
+static std::atomic<bool> g_running;
+static std::atomic<unsigned> g_epoch;
+static unsigned g_start_epoch; // epoch at graph_init; workers wait for the next one
+static std::atomic<int> g_completed;
+static std::atomic<int> g_idle;
+static int g_nframes;
+
+static inline void cpu_relax(int* spins)
+{
+	if (++*spins < c_nspins) {
+#if defined(__i386__) || defined(__x86_64__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		__asm__ __volatile__("yield");
+#endif
+	} else {
+		*spins = 0;
+		sched_yield();
+	}
+}
+
+static uint64_t graph_now_ns()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static float* node_buffer(int node)
+{
+	return (float*)pool_block(&g_pool, node);
+}
+
+static void run_node(int self, int index)
+{
+	const GraphNode* node = &g_nodes[index];
+
+	const uint64_t start = graph_now_ns();
+	node->process(node->context, g_inputs + node->first_input, node->ninputs, node_buffer(index), g_nframes);
+	g_node_ns[index].store(graph_now_ns() - start, std::memory_order_relaxed);
+
+	for (int ii = 0; ii < node->nsuccessors; ++ii) {
+		const int successor = g_successors[node->first_successor + ii];
+		if (1 == g_pending[successor].fetch_sub(1, std::memory_order_acq_rel))
+			g_deques[self].push(successor);
+	}
+
+	g_completed.fetch_add(1, std::memory_order_release);
+}
+
+static void run_until_done(int self)
+{
+	int spins = 0;
+	while (g_completed.load(std::memory_order_acquire) < g_nnodes) {
+
+		int task = g_deques[self].pop();
+		for (int ii = 1; task < 0 && ii < g_nthreads; ++ii)
+			task = g_deques[(self + ii) % g_nthreads].steal();
+
+		if (task < 0) {
+			cpu_relax(&spins);
+			continue;
+		}
+
+		spins = 0;
+		run_node(self, task);
+	}
+}
+
+static void* graph_worker(void* context)
+{
+	const int self = (int)(intptr_t)context;
+
+	const long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	if (ncpus > 1) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(self % ncpus, &cpus);
+		pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	}
+
+	TINYAUDIO_TRACE_THREAD("tinyaudio graph worker");
+
+	unsigned seen = g_start_epoch;
+	int spins = 0;
+	while (g_running.load(std::memory_order_relaxed)) {
+
+		const unsigned epoch = g_epoch.load(std::memory_order_acquire);
+		if (epoch == seen) {
+			cpu_relax(&spins);
+			continue;
+		}
+
+		seen = epoch;
+		spins = 0;
+		TINYAUDIO_TRACE_BEGIN(trace_graph);
+		run_until_done(self);
+		TINYAUDIO_TRACE_END("graph", trace_graph);
+		g_idle.fetch_add(1, std::memory_order_release);
+	}
+
+	return 0;
+}
+
+bool graph_init(int nthreads, int max_nodes)
+{
+	if (nthreads < 1)
+		nthreads = 1;
+	else if (nthreads > c_nmaxthreads)
+		nthreads = c_nmaxthreads;
+	if (max_nodes < 1 || max_nodes > c_nmaxnodes)
+		return false;
+
+	if (!pool_create(&g_pool, sizeof(float) * 2 * c_nmaxframes, max_nodes))
+		return false;
+
+	g_max_nodes = max_nodes;
+	g_nnodes = 0;
+	g_nedges = 0;
+	g_output = -1;
+	g_compiled = false;
+
+	g_nthreads = nthreads;
+	g_start_epoch = g_epoch.load(std::memory_order_relaxed);
+	g_running = true;
+	for (int ii = 1; ii < nthreads; ++ii)
+		pthread_create(&g_threads[ii], NULL, &graph_worker, (void*)(intptr_t)ii);
+
+	return true;
+}
+
+void graph_release()
+{
+	g_running = false;
+	for (int ii = 1; ii < g_nthreads; ++ii)
+		pthread_join(g_threads[ii], NULL);
+	g_nthreads = 0;
+
+	pool_destroy(&g_pool);
+}
+
+graph_node graph_add_node(graph_process process, void* context)
+{
+	if (g_compiled || g_nnodes == g_max_nodes)
+		return -1;
+
+	GraphNode* node = &g_nodes[g_nnodes];
+	memset(node, 0, sizeof(*node));
+	node->process = process;
+	node->context = context;
+	return g_nnodes++;
+}
+
+bool graph_connect(graph_node from, graph_node to)
+{
+	if (g_compiled || g_nedges == c_nmaxedges)
+		return false;
+	if (from < 0 || from >= g_nnodes || to < 0 || to >= g_nnodes || from == to)
+		return false;
+
+	g_edge_from[g_nedges] = from;
+	g_edge_to[g_nedges] = to;
+	++g_nedges;
+	return true;
+}
+
+bool graph_set_output(graph_node node)
+{
+	if (node < 0 || node >= g_nnodes)
+		return false;
+
+	g_output = node;
+	return true;
+}
+
+bool graph_compile()
+{
+	// lay the edges out per node: inputs grouped by destination,
+	// successors grouped by source, both in the order they were added
+	for (int ii = 0; ii < g_nnodes; ++ii) {
+		g_nodes[ii].indegree = 0;
+		g_nodes[ii].nsuccessors = 0;
+	}
+
+	for (int ii = 0; ii < g_nedges; ++ii) {
+		++g_nodes[g_edge_to[ii]].indegree;
+		++g_nodes[g_edge_from[ii]].nsuccessors;
+	}
+
+	int ninputs = 0, nsuccessors = 0;
+	for (int ii = 0; ii < g_nnodes; ++ii) {
+		g_nodes[ii].first_input = ninputs;
+		g_nodes[ii].first_successor = nsuccessors;
+		ninputs += g_nodes[ii].indegree;
+		nsuccessors += g_nodes[ii].nsuccessors;
+		g_nodes[ii].ninputs = 0;
+		g_nodes[ii].nsuccessors = 0;
+	}
+
+	for (int ii = 0; ii < g_nedges; ++ii) {
+		GraphNode* from = &g_nodes[g_edge_from[ii]];
+		GraphNode* to = &g_nodes[g_edge_to[ii]];
+		g_inputs[to->first_input + to->ninputs++] = node_buffer(g_edge_from[ii]);
+		g_successors[from->first_successor + from->nsuccessors++] = g_edge_to[ii];
+	}
+
+	// Kahn's algorithm, only to reject cycles (which would never finish)
+	int* order = g_roots;
+	int head = 0, tail = 0;
+	for (int ii = 0; ii < g_nnodes; ++ii) {
+		g_pending[ii].store(g_nodes[ii].indegree, std::memory_order_relaxed);
+		if (!g_nodes[ii].indegree)
+			order[tail++] = ii;
+	}
+
+	g_nroots = tail;
+	while (head < tail) {
+		const GraphNode* node = &g_nodes[order[head++]];
+		for (int ii = 0; ii < node->nsuccessors; ++ii) {
+			const int successor = g_successors[node->first_successor + ii];
+			if (0 == g_pending[successor].fetch_sub(1, std::memory_order_relaxed) - 1)
+				order[tail++] = successor;
+		}
+	}
+
+	if (tail != g_nnodes)
+		return false;
+
+	g_compiled = true;
+	return true;
+}
+
+void graph_render(sample_type* samples, int nsamples)
+{
+	if (!g_compiled || g_output < 0) {
+		memset(samples, 0, sizeof(sample_type) * 2 * nsamples);
+		return;
+	}
+
+	while (nsamples) {
+		const int n = (nsamples < c_nmaxframes) ? nsamples : c_nmaxframes;
+
+		// every worker is idle here, so the shared state can be reset
+		// without synchronization beyond the epoch bump below
+		g_nframes = n;
+		for (int ii = 0; ii < g_nnodes; ++ii)
+			g_pending[ii].store(g_nodes[ii].indegree, std::memory_order_relaxed);
+		for (int ii = 0; ii < g_nthreads; ++ii)
+			g_deques[ii].reset();
+		for (int ii = 0; ii < g_nroots; ++ii)
+			g_deques[ii % g_nthreads].push(g_roots[ii]);
+		g_completed.store(0, std::memory_order_relaxed);
+		g_idle.store(0, std::memory_order_relaxed);
+
+		// fork
+		g_epoch.fetch_add(1, std::memory_order_release);
+		run_until_done(0);
+
+		// join
+		int spins = 0;
+		while (g_idle.load(std::memory_order_acquire) < g_nthreads - 1)
+			cpu_relax(&spins);
+
+		float_to_bus(node_buffer(g_output), samples, n * 2);
+		samples += n * 2;
+		nsamples -= n;
+	}
+}
+
+int graph_max_frames()
+{
+	return c_nmaxframes;
+}
+
+uint64_t graph_node_time_ns(graph_node node)
+{
+	if (node < 0 || node >= g_nnodes)
+		return 0;
+	return g_node_ns[node].load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,250 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_jack.h"
+#include "TINYAUDIO/tinyaudio_latency.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_stats.h"
+#include "TINYAUDIO/tinyaudio_tap.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+#include "tinyaudio_adaptive.h"
+#include "tinyaudio_kernels.h"
+
+#include <atomic>
+#include <jack/jack.h>
+#include <stdio.h>
+
+namespace tinyaudio {
+
+static samples_callback g_callback;
+static jack_client_t* g_client;
+static jack_port_t* g_ports[2];
+static const char* g_client_name = "tinyaudio app";
+static bool g_autoconnect = true;
+static latency_callback g_latency_callback;
+static sample_rate_callback g_sample_rate_callback;
+static buffer_pool g_pool;
+static std::atomic<bool> g_reconfigured; // report the period/latency on the next cycle
+static std::atomic<uint64_t> g_periods;
+static std::atomic<uint64_t> g_underruns;
+static const int c_nlasterror = 128;
+static char g_lasterror[c_nlasterror];
+
+static void report_latency(int nframes)
+{
+	jack_latency_range_t range;
+	jack_port_get_latency_range(g_ports[0], JackPlaybackLatency, &range);
+	if (g_latency_callback)
+		g_latency_callback(nframes, nframes + (int)range.max);
+}
+
+// Runs on the JACK process thread: render, then deinterleave into the
+// float ports. The callback never sees more than c_nmaxperiod frames.
+static int jack_process(jack_nframes_t nframes, void*)
+{
+	float* left = (float*)jack_port_get_buffer(g_ports[0], nframes);
+	float* right = (float*)jack_port_get_buffer(g_ports[1], nframes);
+	sample_type* samples = (sample_type*)pool_block(&g_pool, 0);
+
+	if (g_reconfigured.exchange(false, std::memory_order_acquire))
+		report_latency((int)nframes);
+
+	for (int offset = 0; offset < (int)nframes; ) {
+		int n = (int)nframes - offset;
+		if (n > c_nmaxperiod)
+			n = c_nmaxperiod;
+
+		TINYAUDIO_TRACE_BEGIN(trace_callback);
+		g_callback(samples, n);
+		TINYAUDIO_TRACE_END("callback", trace_callback);
+		run_output_tap(samples, n);
+
+		bus_to_stereo(samples, left + offset, right + offset, n);
+		offset += n;
+	}
+
+	g_periods.fetch_add(1, std::memory_order_relaxed);
+	return 0;
+}
+
+static int jack_buffer_size(jack_nframes_t, void*)
+{
+	g_reconfigured.store(true, std::memory_order_release);
+	return 0;
+}
+
+static void jack_latency(jack_latency_callback_mode_t mode, void*)
+{
+	if (mode == JackPlaybackLatency)
+		g_reconfigured.store(true, std::memory_order_release);
+}
+
+static int jack_sample_rate(jack_nframes_t sample_rate, void*)
+{
+	if (g_sample_rate_callback)
+		g_sample_rate_callback((int)sample_rate);
+	return 0;
+}
+
+static int jack_xrun(void*)
+{
+	TINYAUDIO_TRACE_MARKER("underrun");
+	g_underruns.fetch_add(1, std::memory_order_relaxed);
+	return 0;
+}
+
+static void jack_shutdown(void*)
+{
+	snprintf(g_lasterror, c_nlasterror, "jack server shut down");
+}
+
+static void connect_physical()
+{
+	const char** playback = jack_get_ports(g_client, NULL, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsInput);
+	if (!playback)
+		return;
+
+	for (int c = 0; c < 2 && playback[c]; ++c)
+		jack_connect(g_client, jack_port_name(g_ports[c]), playback[c]);
+
+	// a mono device gets both channels
+	if (playback[0] && !playback[1])
+		jack_connect(g_client, jack_port_name(g_ports[1]), playback[0]);
+
+	jack_free(playback);
+}
+
+bool init(int sample_rate, samples_callback callback)
+{
+	g_callback = callback;
+
+	jack_status_t status;
+	g_client = jack_client_open(g_client_name, JackNoStartServer, &status);
+	if (!g_client) {
+		snprintf(g_lasterror, c_nlasterror, "failed to connect to the jack server (status 0x%x)", (unsigned)status);
+		return false;
+	}
+
+	const int server_rate = (int)jack_get_sample_rate(g_client);
+	if (server_rate != sample_rate && !g_sample_rate_callback) {
+		snprintf(g_lasterror, c_nlasterror, "jack server runs at %d Hz, not %d Hz", server_rate, sample_rate);
+		jack_client_close(g_client);
+		g_client = NULL;
+		return false;
+	}
+
+	g_ports[0] = jack_port_register(g_client, "out_1", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+	g_ports[1] = jack_port_register(g_client, "out_2", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+	if (!g_ports[0] || !g_ports[1]) {
+		snprintf(g_lasterror, c_nlasterror, "failed to register jack ports");
+		jack_client_close(g_client);
+		g_client = NULL;
+		return false;
+	}
+
+	if (!pool_create(&g_pool, sizeof(sample_type) * 2 * c_nmaxperiod, 1)) {
+		snprintf(g_lasterror, c_nlasterror, "failed to allocate render buffer");
+		jack_client_close(g_client);
+		g_client = NULL;
+		return false;
+	}
+
+	if (g_sample_rate_callback)
+		g_sample_rate_callback(server_rate);
+
+	g_periods.store(0);
+	g_underruns.store(0);
+	g_reconfigured.store(true);
+	jack_set_process_callback(g_client, &jack_process, NULL);
+	jack_set_buffer_size_callback(g_client, &jack_buffer_size, NULL);
+	jack_set_latency_callback(g_client, &jack_latency, NULL);
+	jack_set_sample_rate_callback(g_client, &jack_sample_rate, NULL);
+	jack_set_xrun_callback(g_client, &jack_xrun, NULL);
+	jack_on_shutdown(g_client, &jack_shutdown, NULL);
+
+	if (0 != jack_activate(g_client)) {
+		snprintf(g_lasterror, c_nlasterror, "failed to activate jack client");
+		jack_client_close(g_client);
+		g_client = NULL;
+		pool_destroy(&g_pool);
+		return false;
+	}
+
+	if (g_autoconnect)
+		connect_physical();
+	return true;
+}
+
+void release()
+{
+	if (!g_client)
+		return;
+
+	jack_deactivate(g_client);
+	jack_client_close(g_client);
+	g_client = NULL;
+	pool_destroy(&g_pool);
+}
+
+void set_jack_client_name(const char* name)
+{
+	g_client_name = name;
+}
+
+void set_jack_autoconnect(bool connect)
+{
+	g_autoconnect = connect;
+}
+
+void set_jack_sample_rate_callback(sample_rate_callback callback)
+{
+	g_sample_rate_callback = callback;
+}
+
+void set_latency_limits(int /*min_frames*/, int /*max_frames*/)
+{
+}
+
+void set_latency_callback(latency_callback callback)
+{
+	g_latency_callback = callback;
+}
+
+void read_driver_stats(driver_stats* stats)
+{
+	stats->periods = g_periods.load(std::memory_order_relaxed);
+	stats->underruns = g_underruns.load(std::memory_order_relaxed);
+	stats->background_budget_ns = 0;
+	stats->background_used_ns = 0;
+}
+
+const char* last_error()
+{
+	return g_lasterror;
+}
+
+}
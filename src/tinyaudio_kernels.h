@@ -0,0 +1,253 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_KERNELS_H
+#define TINYAUDIO_KERNELS_H
+
+// Hot loops shared by the mixer and DSP modules. Each kernel has a plain
+// scalar reference next to the vector version so the benchmarks can compare
+// the two. Internal.
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_simd.h"
+
+namespace tinyaudio {
+
+// Accumulate a mono source into planar left/right buffers with linearly
+// ramped gains: left[i] += src[i] * (gl + i * dgl), likewise for right.
+static inline void mix_mono_scalar(float* left, float* right, const float* src, int n, float gl, float gr, float dgl, float dgr)
+{
+	for (int ii = 0; ii < n; ++ii) {
+		left[ii] += src[ii] * (gl + ii * dgl);
+		right[ii] += src[ii] * (gr + ii * dgr);
+	}
+}
+
+static inline void mix_mono(float* left, float* right, const float* src, int n, float gl, float gr, float dgl, float dgr)
+{
+	const int nvec = n & ~(c_simd_width - 1);
+
+	if (dgl == 0.0f && dgr == 0.0f) {
+		const vfloat vgl = vset1(gl);
+		const vfloat vgr = vset1(gr);
+		for (int ii = 0; ii < nvec; ii += c_simd_width) {
+			const vfloat s = vload(src + ii);
+			vstore(left + ii, vmadd(s, vgl, vload(left + ii)));
+			vstore(right + ii, vmadd(s, vgr, vload(right + ii)));
+		}
+	} else {
+		vfloat vgl = vadd(vset1(gl), vmul(vset1(dgl), vramp()));
+		vfloat vgr = vadd(vset1(gr), vmul(vset1(dgr), vramp()));
+		const vfloat stepl = vset1(dgl * c_simd_width);
+		const vfloat stepr = vset1(dgr * c_simd_width);
+		for (int ii = 0; ii < nvec; ii += c_simd_width) {
+			const vfloat s = vload(src + ii);
+			vstore(left + ii, vmadd(s, vgl, vload(left + ii)));
+			vstore(right + ii, vmadd(s, vgr, vload(right + ii)));
+			vgl = vadd(vgl, stepl);
+			vgr = vadd(vgr, stepr);
+		}
+	}
+
+	mix_mono_scalar(left + nvec, right + nvec, src + nvec, n - nvec, gl + nvec * dgl, gr + nvec * dgr, dgl, dgr);
+}
+
+// Split bus-format stereo into planar float, scaled to [-1, 1)
+static inline void bus_to_stereo_scalar(const sample_type* in, float* left, float* right, int n)
+{
+#if TINYAUDIO_FLOAT_BUS
+	const float scale = 1.0f;
+#else
+	const float scale = 1.0f / 32768.0f;
+#endif
+	for (int ii = 0; ii < n; ++ii, in += 2) {
+		left[ii] = in[0] * scale;
+		right[ii] = in[1] * scale;
+	}
+}
+
+static inline void bus_to_stereo(const sample_type* in, float* left, float* right, int n)
+{
+	const int nvec = n & ~(c_simd_width - 1);
+
+	for (int ii = 0; ii < nvec; ii += c_simd_width) {
+		vfloat l, r;
+#if TINYAUDIO_FLOAT_BUS
+		vload_stereo(in + ii * 2, &l, &r);
+#else
+		const vfloat scale = vset1(1.0f / 32768.0f);
+		vload_stereo_s16(in + ii * 2, &l, &r);
+		l = vmul(l, scale);
+		r = vmul(r, scale);
+#endif
+		vstore(left + ii, l);
+		vstore(right + ii, r);
+	}
+
+	bus_to_stereo_scalar(in + nvec * 2, left + nvec, right + nvec, n - nvec);
+}
+
+// Interleave planar float stereo into the bus format, saturating to full
+// scale.
+static inline void stereo_to_bus_scalar(const float* left, const float* right, sample_type* out, int n)
+{
+	for (int ii = 0; ii < n; ++ii, out += 2) {
+		float l = left[ii], r = right[ii];
+		l = (l > 1.0f) ? 1.0f : ((l < -1.0f) ? -1.0f : l);
+		r = (r > 1.0f) ? 1.0f : ((r < -1.0f) ? -1.0f : r);
+#if TINYAUDIO_FLOAT_BUS
+		out[0] = l;
+		out[1] = r;
+#else
+		l *= 32767.0f;
+		r *= 32767.0f;
+		out[0] = (sample_type)(l + ((l < 0.0f) ? -0.5f : 0.5f));
+		out[1] = (sample_type)(r + ((r < 0.0f) ? -0.5f : 0.5f));
+#endif
+	}
+}
+
+static inline void stereo_to_bus(const float* left, const float* right, sample_type* out, int n)
+{
+	const int nvec = n & ~(c_simd_width - 1);
+	const vfloat one = vset1(1.0f);
+	const vfloat minus_one = vset1(-1.0f);
+#if !TINYAUDIO_FLOAT_BUS
+	const vfloat scale = vset1(32767.0f);
+#endif
+
+	for (int ii = 0; ii < nvec; ii += c_simd_width) {
+		const vfloat l = vmax(vmin(vload(left + ii), one), minus_one);
+		const vfloat r = vmax(vmin(vload(right + ii), one), minus_one);
+#if TINYAUDIO_FLOAT_BUS
+		vstore_stereo(out + ii * 2, l, r);
+#else
+		vstore_stereo_s16(out + ii * 2, vmul(l, scale), vmul(r, scale));
+#endif
+	}
+
+	stereo_to_bus_scalar(left + nvec, right + nvec, out + nvec * 2, n - nvec);
+}
+
+// Convert nvalues interleaved floats to the bus format, saturating
+static inline void float_to_bus_scalar(const float* in, sample_type* out, int nvalues)
+{
+	for (int ii = 0; ii < nvalues; ++ii) {
+		float v = in[ii];
+		v = (v > 1.0f) ? 1.0f : ((v < -1.0f) ? -1.0f : v);
+#if TINYAUDIO_FLOAT_BUS
+		out[ii] = v;
+#else
+		v *= 32767.0f;
+		out[ii] = (sample_type)(v + ((v < 0.0f) ? -0.5f : 0.5f));
+#endif
+	}
+}
+
+static inline void float_to_bus(const float* in, sample_type* out, int nvalues)
+{
+	const int step = c_simd_width * 2;
+	const int nvec = nvalues - nvalues % step;
+	const vfloat one = vset1(1.0f);
+	const vfloat minus_one = vset1(-1.0f);
+#if !TINYAUDIO_FLOAT_BUS
+	const vfloat scale = vset1(32767.0f);
+#endif
+
+	for (int ii = 0; ii < nvec; ii += step) {
+		const vfloat a = vmax(vmin(vload(in + ii), one), minus_one);
+		const vfloat b = vmax(vmin(vload(in + ii + c_simd_width), one), minus_one);
+#if TINYAUDIO_FLOAT_BUS
+		vstore(out + ii, a);
+		vstore(out + ii + c_simd_width, b);
+#else
+		vstore_s16(out + ii, vmul(a, scale), vmul(b, scale));
+#endif
+	}
+
+	float_to_bus_scalar(in + nvec, out + nvec, nvalues - nvec);
+}
+
+// Per-channel peak and sum of squares of bus-format stereo, scaled to
+// [-1, 1), folded into levels: peak left/right (max), then sum of squares
+// left/right (added).
+static inline void stereo_levels_scalar(const sample_type* in, int n, float* levels)
+{
+#if TINYAUDIO_FLOAT_BUS
+	const float scale = 1.0f;
+#else
+	const float scale = 1.0f / 32768.0f;
+#endif
+	float pl = 0.0f, pr = 0.0f, sl = 0.0f, sr = 0.0f;
+	for (int ii = 0; ii < n; ++ii, in += 2) {
+		const float l = in[0] * scale, r = in[1] * scale;
+		pl = (l > pl) ? l : ((-l > pl) ? -l : pl);
+		pr = (r > pr) ? r : ((-r > pr) ? -r : pr);
+		sl += l * l;
+		sr += r * r;
+	}
+
+	levels[0] = (pl > levels[0]) ? pl : levels[0];
+	levels[1] = (pr > levels[1]) ? pr : levels[1];
+	levels[2] += sl;
+	levels[3] += sr;
+}
+
+static inline void stereo_levels(const sample_type* in, int n, float* levels)
+{
+	const int nvec = n & ~(c_simd_width - 1);
+	vfloat pl = vset1(0.0f), pr = pl, sl = pl, sr = pl;
+
+	for (int ii = 0; ii < nvec; ii += c_simd_width) {
+		vfloat l, r;
+#if TINYAUDIO_FLOAT_BUS
+		vload_stereo(in + ii * 2, &l, &r);
+#else
+		vload_stereo_s16(in + ii * 2, &l, &r);
+#endif
+		pl = vmax(pl, vabs(l));
+		pr = vmax(pr, vabs(r));
+		sl = vmadd(l, l, sl);
+		sr = vmadd(r, r, sr);
+	}
+
+#if TINYAUDIO_FLOAT_BUS
+	const float scale = 1.0f;
+#else
+	const float scale = 1.0f / 32768.0f;
+#endif
+	const float peak_l = vhmax(pl) * scale, peak_r = vhmax(pr) * scale;
+	levels[0] = (peak_l > levels[0]) ? peak_l : levels[0];
+	levels[1] = (peak_r > levels[1]) ? peak_r : levels[1];
+	levels[2] += vhsum(sl) * scale * scale;
+	levels[3] += vhsum(sr) * scale * scale;
+
+	stereo_levels_scalar(in + nvec * 2, n - nvec, levels);
+}
+
+}
+
+#endif
@@ -0,0 +1,206 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Every Linux driver in one translation unit, each in its own namespace
+// and loading its system library on demand (see tinyaudio_driver.h), and
+// the public entry points that pick one at runtime.
+
+#define TINYAUDIO_DYNLOAD 1
+
+#define TINYAUDIO_DRIVER_NAMESPACE pipewire_driver
+#include "tinyaudio_pipewire.cpp"
+#undef TINYAUDIO_DRIVER_NAMESPACE
+
+#define TINYAUDIO_DRIVER_NAMESPACE pulse_driver
+#include "tinyaudio_pulse.cpp"
+#undef TINYAUDIO_DRIVER_NAMESPACE
+
+#define TINYAUDIO_DRIVER_NAMESPACE alsa_driver
+#include "tinyaudio_alsa.cpp"
+#undef TINYAUDIO_DRIVER_NAMESPACE
+
+#define TINYAUDIO_DRIVER_NAMESPACE null_driver
+#include "tinyaudio_null.cpp"
+#undef TINYAUDIO_DRIVER_NAMESPACE
+
+#include "TINYAUDIO/tinyaudio_linux.h"
+#include "TINYAUDIO/tinyaudio_stats.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace tinyaudio {
+
+struct Driver {
+	const char* name;
+	bool (*init)(int sample_rate, samples_callback callback);
+	void (*release)();
+	void (*set_latency_limits)(int min_frames, int max_frames);
+	void (*set_latency_callback)(latency_callback callback);
+	void (*read_driver_stats)(driver_stats* stats);
+	const char* (*last_error)();
+};
+
+#define TINYAUDIO_DRIVER_ENTRY(name) { \
+	#name, \
+	&name##_driver::init, \
+	&name##_driver::release, \
+	&name##_driver::set_latency_limits, \
+	&name##_driver::set_latency_callback, \
+	&name##_driver::read_driver_stats, \
+	&name##_driver::last_error, \
+}
+
+static const Driver c_drivers[] = {
+	TINYAUDIO_DRIVER_ENTRY(pipewire),
+	TINYAUDIO_DRIVER_ENTRY(pulse),
+	TINYAUDIO_DRIVER_ENTRY(alsa),
+	TINYAUDIO_DRIVER_ENTRY(null),
+};
+
+static const int c_ndrivers = (int)(sizeof(c_drivers) / sizeof(c_drivers[0]));
+static const char* const c_default_preference = "pipewire,pulse,alsa,null";
+
+static const char* g_preference = c_default_preference;
+static const Driver* g_driver;
+static int g_min_latency;
+static int g_max_latency;
+static latency_callback g_latency_callback;
+static const int c_nlasterror = 512;
+static char g_lasterror[c_nlasterror];
+
+static const Driver* find_driver(const char* name, size_t len)
+{
+	for (int ii = 0; ii < c_ndrivers; ++ii) {
+		if (strlen(c_drivers[ii].name) == len && 0 == memcmp(c_drivers[ii].name, name, len))
+			return &c_drivers[ii];
+	}
+
+	return NULL;
+}
+
+// Collect why each driver on the list failed
+static void append_error(const char* name, size_t len, const char* error)
+{
+	const size_t used = strlen(g_lasterror);
+	snprintf(g_lasterror + used, c_nlasterror - used, "%s%.*s: %s", used ? "; " : "", (int)len, name, error);
+}
+
+bool init(int sample_rate, samples_callback callback)
+{
+	const char* list = getenv("TINYAUDIO_DRIVER");
+	if (!list || !*list)
+		list = g_preference;
+
+	g_driver = NULL;
+	g_lasterror[0] = 0;
+
+	while (*list) {
+		const char* end = strchr(list, ',');
+		const size_t len = end ? (size_t)(end - list) : strlen(list);
+
+		const Driver* driver = find_driver(list, len);
+		if (!driver) {
+			append_error(list, len, "unknown driver");
+		} else {
+			driver->set_latency_limits(g_min_latency, g_max_latency);
+			driver->set_latency_callback(g_latency_callback);
+			if (driver->init(sample_rate, callback)) {
+				g_driver = driver;
+				return true;
+			}
+			append_error(list, len, driver->last_error());
+		}
+
+		list += len;
+		if (*list == ',')
+			++list;
+	}
+
+	return false;
+}
+
+void release()
+{
+	if (g_driver)
+		g_driver->release();
+	g_driver = NULL;
+}
+
+void set_latency_limits(int min_frames, int max_frames)
+{
+	g_min_latency = min_frames;
+	g_max_latency = max_frames;
+}
+
+void set_latency_callback(latency_callback callback)
+{
+	g_latency_callback = callback;
+}
+
+const char* last_error()
+{
+	return g_driver ? g_driver->last_error() : g_lasterror;
+}
+
+void read_driver_stats(driver_stats* stats)
+{
+	if (g_driver) {
+		g_driver->read_driver_stats(stats);
+	} else {
+		memset(stats, 0, sizeof(*stats));
+	}
+}
+
+void set_driver_preference(const char* names)
+{
+	g_preference = names ? names : c_default_preference;
+}
+
+const char* driver_name()
+{
+	return g_driver ? g_driver->name : NULL;
+}
+
+// driver-specific settings reach the driver they belong to
+
+void set_pulse_application_name(const char* name)
+{
+	pulse_driver::set_pulse_application_name(name);
+}
+
+void set_pipewire_application_name(const char* name)
+{
+	pipewire_driver::set_pipewire_application_name(name);
+}
+
+void set_pipewire_quantum(int frames)
+{
+	pipewire_driver::set_pipewire_quantum(frames);
+}
+
+}
@@ -0,0 +1,230 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_latency.h"
+#include "TINYAUDIO/tinyaudio_loopback.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_stats.h"
+#include "TINYAUDIO/tinyaudio_tap.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+#include "tinyaudio_adaptive.h"
+
+#include <atomic>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+
+namespace tinyaudio {
+
+static const int c_nsamples = 256;
+static const int c_nperiods = 2;
+static samples_callback g_callback;
+static pthread_t g_thread;
+static volatile bool g_running;
+static int g_sample_rate;
+static int g_min_latency;
+static latency_callback g_latency_callback;
+static buffer_pool g_pool;
+static const char* g_lasterror = "";
+static int g_nframes;
+static std::atomic<uint64_t> g_periods;
+static std::atomic<uint64_t> g_underruns;
+
+static sample_type* g_capture;
+static int g_capture_frames;
+static loopback_block* g_blocks;
+static int g_max_blocks;
+static std::atomic<int> g_captured_frames;
+static std::atomic<int> g_captured_blocks;
+
+static timespec timespec_from_ns(uint64_t ns)
+{
+	timespec ts;
+	ts.tv_sec = (time_t)(ns / 1000000000ULL);
+	ts.tv_nsec = (long)(ns % 1000000000ULL);
+	return ts;
+}
+
+// Append frames (or silence, for samples == NULL) to the capture
+static void capture(const sample_type* samples, int nframes)
+{
+	const int used = g_captured_frames.load(std::memory_order_relaxed);
+	if (nframes > g_capture_frames - used)
+		nframes = g_capture_frames - used;
+	if (nframes <= 0)
+		return;
+
+	sample_type* dest = g_capture + used * 2;
+	if (samples)
+		memcpy(dest, samples, sizeof(sample_type) * 2 * nframes);
+	else
+		memset(dest, 0, sizeof(sample_type) * 2 * nframes);
+	g_captured_frames.store(used + nframes, std::memory_order_release);
+}
+
+static void capture_block(uint64_t frame, uint64_t callback_ns, uint64_t output_ns, int nframes)
+{
+	const int used = g_captured_blocks.load(std::memory_order_relaxed);
+	if (used == g_max_blocks || (int64_t)frame + nframes > (int64_t)g_capture_frames)
+		return;
+
+	loopback_block* b = &g_blocks[used];
+	b->frame = frame;
+	b->callback_ns = callback_ns;
+	b->output_ns = output_ns;
+	b->nframes = nframes;
+	g_captured_blocks.store(used + 1, std::memory_order_release);
+}
+
+static void* loopback_thread(void*)
+{
+	sample_type* samples = (sample_type*)pool_block(&g_pool, 0);
+
+	TINYAUDIO_TRACE_THREAD("tinyaudio loopback");
+	if (g_latency_callback)
+		g_latency_callback(g_nframes, g_nframes * c_nperiods);
+
+	// frame N of the stream plays at start_ns + N / rate. The device starts
+	// once the buffer has been filled, so the first periods render up front.
+	uint64_t start_ns = 0;
+	uint64_t written = 0;
+	int prefill = c_nperiods;
+
+	while (g_running) {
+
+		const uint64_t callback_ns = adaptive_now_ns();
+		TINYAUDIO_TRACE_BEGIN(trace_callback);
+		g_callback(samples, g_nframes);
+		TINYAUDIO_TRACE_END("callback", trace_callback);
+		run_output_tap(samples, g_nframes);
+
+		const uint64_t now = adaptive_now_ns();
+		if (prefill && prefill-- == c_nperiods)
+			start_ns = now;
+
+		// a period that arrives after its first frame was due leaves the
+		// device playing silence until now
+		uint64_t output_ns = start_ns + written * 1000000000ULL / g_sample_rate;
+		if (!prefill && now > output_ns) {
+			const uint64_t gap = ((now - output_ns) * g_sample_rate + 999999999ULL) / 1000000000ULL;
+			TINYAUDIO_TRACE_MARKER("underrun");
+			g_underruns.fetch_add(1, std::memory_order_relaxed);
+			capture(NULL, (int)gap);
+			written += gap;
+			output_ns = start_ns + written * 1000000000ULL / g_sample_rate;
+		}
+
+		capture_block(written, callback_ns, output_ns, g_nframes);
+		capture(samples, g_nframes);
+		written += g_nframes;
+		g_periods.fetch_add(1, std::memory_order_relaxed);
+
+		if (prefill)
+			continue;
+
+		// wake once a period has drained from the buffer
+		const uint64_t buffered = (uint64_t)g_nframes * (c_nperiods - 1);
+		const timespec wake = timespec_from_ns(start_ns + (written - buffered) * 1000000000ULL / g_sample_rate);
+		TINYAUDIO_TRACE_BEGIN(trace_wait);
+		while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL))
+			;
+		TINYAUDIO_TRACE_END("wait", trace_wait);
+	}
+
+	return 0;
+}
+
+bool init(int sample_rate, samples_callback callback)
+{
+	g_sample_rate = sample_rate;
+	g_callback = callback;
+
+	g_nframes = g_min_latency ? g_min_latency / c_nperiods : c_nsamples;
+	if (g_nframes < 1)
+		g_nframes = 1;
+	if (g_nframes > c_nmaxperiod)
+		g_nframes = c_nmaxperiod;
+
+	if (!pool_create(&g_pool, sizeof(sample_type) * 2 * c_nmaxperiod, 1)) {
+		g_lasterror = "failed to allocate render buffer";
+		return false;
+	}
+
+	g_periods.store(0);
+	g_underruns.store(0);
+	g_captured_frames.store(0);
+	g_captured_blocks.store(0);
+	g_running = true;
+	pthread_create(&g_thread, NULL, &loopback_thread, NULL);
+	return true;
+}
+
+void release()
+{
+	g_running = false;
+	pthread_join(g_thread, NULL);
+	pool_destroy(&g_pool);
+}
+
+void set_loopback_capture(sample_type* samples, int max_frames, loopback_block* blocks, int max_blocks)
+{
+	g_capture = samples;
+	g_capture_frames = samples ? max_frames : 0;
+	g_blocks = blocks;
+	g_max_blocks = blocks ? max_blocks : 0;
+}
+
+void loopback_captured(int* nframes, int* nblocks)
+{
+	if (nframes)
+		*nframes = g_captured_frames.load(std::memory_order_acquire);
+	if (nblocks)
+		*nblocks = g_captured_blocks.load(std::memory_order_acquire);
+}
+
+// The period is fixed; only the minimum is used
+void set_latency_limits(int min_frames, int /*max_frames*/)
+{
+	g_min_latency = min_frames;
+}
+
+void set_latency_callback(latency_callback callback)
+{
+	g_latency_callback = callback;
+}
+
+void read_driver_stats(driver_stats* stats)
+{
+	stats->periods = g_periods.load(std::memory_order_relaxed);
+	stats->underruns = g_underruns.load(std::memory_order_relaxed);
+	stats->background_budget_ns = 0;
+	stats->background_used_ns = 0;
+}
+
+const char* last_error() { return g_lasterror; }
+
+}
@@ -0,0 +1,302 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_master.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "tinyaudio_kernels.h"
+
+#include <atomic>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace tinyaudio {
+
+static const int c_nchunk = 32; // frames per pass, a multiple of every SIMD width
+static const int c_nmaxlookahead = 16; // chunks
+static const int c_nslots = c_nmaxlookahead + 1;
+static const int c_nnoise = 4096;
+
+static samples_callback g_render;
+static buffer_pool g_pool;
+static float* g_delay; // c_nslots chunks of planar left/right
+static float* g_noise; // TPDF noise in [-1, 1]
+static sample_type* g_stage; // input chunk being filled
+static sample_type* g_out; // processed chunk being played out
+static float g_required[c_nslots]; // limiter gain each chunk needs
+static int g_fill;
+static unsigned g_written;
+
+static bool g_dc_enabled;
+static float g_dc_coef;
+static float g_dc[2];
+
+static bool g_limit_enabled;
+static int g_lookahead;
+static float g_ceiling;
+static float g_release_coef;
+static float g_gain;
+static float g_period_gain;
+static std::atomic<float> g_reported_gain;
+
+static float g_lsb;
+static uint32_t g_rng;
+
+static uint32_t next_random()
+{
+	g_rng ^= g_rng << 13;
+	g_rng ^= g_rng >> 17;
+	g_rng ^= g_rng << 5;
+	return g_rng;
+}
+
+// Subtract a running DC estimate, updated once per chunk from the chunk's
+// mean and ramped across it so the correction never steps
+static void dc_block(float* x, float* dc)
+{
+	vfloat sum = vset1(0.0f);
+	for (int ii = 0; ii < c_nchunk; ii += c_simd_width)
+		sum = vadd(sum, vload(x + ii));
+
+	const float mean = vhsum(sum) * (1.0f / c_nchunk);
+	const float target = *dc + g_dc_coef * (mean - *dc);
+	const float step = (target - *dc) * (1.0f / c_nchunk);
+
+	vfloat offset = vadd(vset1(*dc + step), vmul(vset1(step), vramp()));
+	const vfloat advance = vset1(step * c_simd_width);
+	for (int ii = 0; ii < c_nchunk; ii += c_simd_width) {
+		vstore(x + ii, vsub(vload(x + ii), offset));
+		offset = vadd(offset, advance);
+	}
+
+	*dc = target;
+}
+
+static float required_gain(const float* left, const float* right)
+{
+	vfloat peak = vset1(0.0f);
+	for (int ii = 0; ii < c_nchunk; ii += c_simd_width)
+		peak = vmax(peak, vmax(vabs(vload(left + ii)), vabs(vload(right + ii))));
+
+	const float p = vhmax(peak);
+	return (p > g_ceiling) ? g_ceiling / p : 1.0f;
+}
+
+// Ramp the gain linearly across chunk `k` so that, at every chunk boundary
+// up to the look-ahead horizon, it is at or below what the chunk after that
+// boundary needs. Each chunk's own requirement then holds for every frame
+// in it because the ramp is linear between two values that satisfy it.
+static void limit(float* left, float* right, unsigned k)
+{
+	float target = g_gain + (1.0f - g_gain) * g_release_coef;
+	for (int d = 0; d <= g_lookahead; ++d) {
+		const float required = g_required[(k + d) % c_nslots];
+		const float bound = (d == 0) ? required : g_gain + (required - g_gain) / d;
+		if (bound < target)
+			target = bound;
+	}
+
+	const float step = (target - g_gain) * (1.0f / c_nchunk);
+	vfloat gain = vadd(vset1(g_gain + step), vmul(vset1(step), vramp()));
+	const vfloat advance = vset1(step * c_simd_width);
+	for (int ii = 0; ii < c_nchunk; ii += c_simd_width) {
+		vstore(left + ii, vmul(vload(left + ii), gain));
+		vstore(right + ii, vmul(vload(right + ii), gain));
+		gain = vadd(gain, advance);
+	}
+
+	g_gain = target;
+	if (target < g_period_gain)
+		g_period_gain = target;
+}
+
+static void dither(float* x)
+{
+	const float* noise = g_noise + next_random() % (c_nnoise - c_nchunk);
+	const vfloat lsb = vset1(g_lsb);
+	for (int ii = 0; ii < c_nchunk; ii += c_simd_width)
+		vstore(x + ii, vmadd(vload(noise + ii), lsb, vload(x + ii)));
+}
+
+static void process_chunk()
+{
+	const unsigned slot = g_written % c_nslots;
+	float* left = g_delay + slot * 2 * c_nchunk;
+	float* right = left + c_nchunk;
+
+	bus_to_stereo(g_stage, left, right, c_nchunk);
+	if (g_dc_enabled) {
+		dc_block(left, &g_dc[0]);
+		dc_block(right, &g_dc[1]);
+	}
+	if (g_limit_enabled)
+		g_required[slot] = required_gain(left, right);
+
+	++g_written;
+	if (g_written <= (unsigned)g_lookahead) {
+		// still filling the look-ahead
+		memset(g_out, 0, sizeof(sample_type) * 2 * c_nchunk);
+		return;
+	}
+
+	const unsigned k = g_written - 1 - g_lookahead;
+	left = g_delay + (k % c_nslots) * 2 * c_nchunk;
+	right = left + c_nchunk;
+
+	if (g_limit_enabled) {
+		// nothing has played yet, so start from what the first window needs
+		// rather than ramping down from unity into it
+		if (k == 0) {
+			for (int d = 0; d <= g_lookahead; ++d) {
+				if (g_required[d] < g_gain)
+					g_gain = g_required[d];
+			}
+		}
+		limit(left, right, k);
+	}
+	if (g_lsb > 0.0f) {
+		dither(left);
+		dither(right);
+	}
+
+	stereo_to_bus(left, right, g_out, c_nchunk);
+}
+
+void master_default_settings(master_settings* settings)
+{
+	settings->dc_cutoff_hz = 5.0f;
+	settings->ceiling = 0.989f; // -0.1 dBFS
+	settings->lookahead_ms = 1.5f;
+	settings->release_ms = 60.0f;
+#if TINYAUDIO_FLOAT_BUS
+	settings->dither_bits = 0;
+#else
+	settings->dither_bits = 16; // the chain requantizes the int16 bus
+#endif
+}
+
+bool master_init(int sample_rate, samples_callback render, const master_settings* settings)
+{
+	master_settings defaults;
+	if (!settings) {
+		master_default_settings(&defaults);
+		settings = &defaults;
+	}
+
+	const size_t delay_bytes = sizeof(float) * 2 * c_nchunk * c_nslots;
+	const size_t noise_bytes = sizeof(float) * c_nnoise;
+	const size_t chunk_bytes = sizeof(sample_type) * 2 * c_nchunk;
+	if (!pool_create(&g_pool, delay_bytes + noise_bytes + 2 * chunk_bytes, 1))
+		return false;
+
+	char* base = (char*)pool_block(&g_pool, 0);
+	g_delay = (float*)base;
+	g_noise = (float*)(base + delay_bytes);
+	g_stage = (sample_type*)(base + delay_bytes + noise_bytes);
+	g_out = (sample_type*)(base + delay_bytes + noise_bytes + chunk_bytes);
+
+	g_render = render;
+	g_fill = 0;
+	g_written = 0;
+
+	const float chunk_seconds = (float)c_nchunk / sample_rate;
+
+	g_dc_enabled = settings->dc_cutoff_hz > 0.0f;
+	g_dc_coef = 1.0f - expf(-2.0f * 3.14159265f * settings->dc_cutoff_hz * chunk_seconds);
+	g_dc[0] = g_dc[1] = 0.0f;
+
+	g_limit_enabled = settings->ceiling > 0.0f;
+	g_ceiling = settings->ceiling;
+	g_lookahead = 0;
+	if (g_limit_enabled) {
+		g_lookahead = (int)ceilf(settings->lookahead_ms * 0.001f / chunk_seconds);
+		g_lookahead = (g_lookahead < 1) ? 1 : ((g_lookahead > c_nmaxlookahead) ? c_nmaxlookahead : g_lookahead);
+	}
+	g_release_coef = (settings->release_ms > 0.0f) ? 1.0f - expf(-chunk_seconds / (settings->release_ms * 0.001f)) : 1.0f;
+	g_gain = 1.0f;
+	g_reported_gain.store(1.0f);
+	for (int ii = 0; ii < c_nslots; ++ii)
+		g_required[ii] = 1.0f;
+
+	g_lsb = 0.0f;
+	if (settings->dither_bits >= 8 && settings->dither_bits <= 24)
+		g_lsb = 1.0f / (float)(1 << (settings->dither_bits - 1));
+
+	// triangular noise: the sum of two uniform values
+	g_rng = 0x9e3779b9;
+	for (int ii = 0; ii < c_nnoise; ++ii) {
+		const float a = (next_random() >> 8) * (1.0f / 16777216.0f);
+		const float b = (next_random() >> 8) * (1.0f / 16777216.0f);
+		g_noise[ii] = a - b;
+	}
+
+	return true;
+}
+
+void master_release()
+{
+	pool_destroy(&g_pool);
+	g_render = NULL;
+}
+
+void master_render(sample_type* samples, int nsamples)
+{
+	g_render(samples, nsamples);
+
+	g_period_gain = g_gain;
+	while (nsamples) {
+		int n = c_nchunk - g_fill;
+		if (n > nsamples)
+			n = nsamples;
+
+		// stash the new frames, play out the processed ones they displace
+		memcpy(g_stage + g_fill * 2, samples, sizeof(sample_type) * 2 * n);
+		memcpy(samples, g_out + g_fill * 2, sizeof(sample_type) * 2 * n);
+		samples += n * 2;
+		nsamples -= n;
+
+		g_fill += n;
+		if (g_fill == c_nchunk) {
+			process_chunk();
+			g_fill = 0;
+		}
+	}
+
+	g_reported_gain.store(g_period_gain, std::memory_order_relaxed);
+}
+
+int master_latency_frames()
+{
+	return c_nchunk * (1 + g_lookahead);
+}
+
+float master_gain()
+{
+	return g_reported_gain.load(std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,74 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Windows page allocation for buffer pools, kept out of
+// TINYAUDIO/tinyaudio_memory.h so its includers don't get windows.h.
+
+#include "TINYAUDIO/tinyaudio_memory.h"
+
+#if defined(_WIN32)
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+namespace tinyaudio {
+
+char* win32_map_pages(size_t* bytes, bool huge_pages)
+{
+	if (huge_pages) {
+		const size_t large = GetLargePageMinimum();
+		if (large) {
+			const size_t rounded = (*bytes + large - 1) & ~(large - 1);
+			void* ptr = VirtualAlloc(NULL, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if (ptr) {
+				*bytes = rounded;
+				return (char*)ptr;
+			}
+		}
+	}
+
+	return (char*)VirtualAlloc(NULL, *bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+}
+
+void win32_unmap_pages(void* ptr)
+{
+	VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+bool win32_lock_pages(void* ptr, size_t bytes)
+{
+	return 0 != VirtualLock(ptr, bytes);
+}
+
+void win32_unlock_pages(void* ptr, size_t bytes)
+{
+	VirtualUnlock(ptr, bytes);
+}
+
+}
+
+#endif
@@ -0,0 +1,154 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_meter.h"
+#include "tinyaudio_kernels.h"
+
+#include <atomic>
+#include <math.h>
+#include <string.h>
+
+namespace tinyaudio {
+
+static const float c_rms_seconds = 0.3f;
+static const unsigned c_fresh = 4; // set on the middle index when it holds a new window
+
+static samples_callback g_render;
+static buffer_pool g_pool; // three windows
+static int g_window;
+static int g_fill;
+static float g_rms_coef;
+static float g_mean_square[2];
+
+// Triple buffer: the writer owns g_back, the reader g_front, and the third
+// index sits in g_middle; both sides only ever swap theirs with it
+static unsigned g_back;
+static unsigned g_front;
+static std::atomic<unsigned> g_middle;
+
+static std::atomic<float> g_peak[2];
+static std::atomic<float> g_rms[2];
+
+static sample_type* window(unsigned index)
+{
+	return (sample_type*)pool_block(&g_pool, (int)index);
+}
+
+bool meter_init(int sample_rate, samples_callback render, int window_frames)
+{
+	if (window_frames <= 0 || !pool_create(&g_pool, sizeof(sample_type) * 2 * window_frames, 3))
+		return false;
+
+	g_render = render;
+	g_window = window_frames;
+	g_fill = 0;
+	g_rms_coef = 1.0f / (c_rms_seconds * sample_rate);
+	g_back = 0;
+	g_middle.store(1);
+	g_front = 2;
+
+	for (int c = 0; c < 2; ++c) {
+		g_mean_square[c] = 0.0f;
+		g_peak[c].store(0.0f);
+		g_rms[c].store(0.0f);
+	}
+
+	return true;
+}
+
+void meter_release()
+{
+	pool_destroy(&g_pool);
+	g_render = NULL;
+}
+
+static void raise_peak(std::atomic<float>* peak, float value)
+{
+	float current = peak->load(std::memory_order_relaxed);
+	while (value > current && !peak->compare_exchange_weak(current, value, std::memory_order_relaxed))
+		;
+}
+
+void meter_render(sample_type* samples, int nsamples)
+{
+	g_render(samples, nsamples);
+	if (nsamples <= 0)
+		return;
+
+	float levels[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	stereo_levels(samples, nsamples, levels);
+
+	// one-pole average of the mean square, stepped once per period
+	const float coef = 1.0f - expf(-g_rms_coef * nsamples);
+	for (int c = 0; c < 2; ++c) {
+		g_mean_square[c] += coef * (levels[2 + c] / nsamples - g_mean_square[c]);
+		g_rms[c].store(sqrtf(g_mean_square[c]), std::memory_order_relaxed);
+		raise_peak(&g_peak[c], levels[c]);
+	}
+
+	while (nsamples) {
+		int n = g_window - g_fill;
+		if (n > nsamples)
+			n = nsamples;
+
+		memcpy(window(g_back) + g_fill * 2, samples, sizeof(sample_type) * 2 * n);
+		samples += n * 2;
+		nsamples -= n;
+
+		g_fill += n;
+		if (g_fill == g_window) {
+			g_back = g_middle.exchange(g_back | c_fresh, std::memory_order_acq_rel) & ~c_fresh;
+			g_fill = 0;
+		}
+	}
+}
+
+void meter_read_levels(meter_levels* levels)
+{
+	for (int c = 0; c < 2; ++c) {
+		levels->peak[c] = g_peak[c].exchange(0.0f, std::memory_order_relaxed);
+		levels->rms[c] = g_rms[c].load(std::memory_order_relaxed);
+	}
+}
+
+bool meter_read_window(sample_type* frames)
+{
+	const bool fresh = 0 != (g_middle.load(std::memory_order_relaxed) & c_fresh);
+	if (fresh)
+		g_front = g_middle.exchange(g_front, std::memory_order_acq_rel) & ~c_fresh;
+
+	memcpy(frames, window(g_front), sizeof(sample_type) * 2 * g_window);
+	return fresh;
+}
+
+int meter_window_frames()
+{
+	return g_window;
+}
+
+}
@@ -0,0 +1,290 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_mixer.h"
+#include "tinyaudio_kernels.h"
+#include "tinyaudio_queue.h"
+
+#include <atomic>
+#include <math.h>
+#include <string.h>
+
+namespace tinyaudio {
+
+static const int c_nblock = 1024; // frames mixed per pass
+static const int c_ncommands = 1024;
+static const int c_default_ramp = 64;
+
+enum MixerCommandType {
+	command_play,
+	command_set,
+	command_stop,
+};
+
+struct MixerCommand {
+	MixerCommandType type;
+	voice_handle voice;
+	const float* samples;
+	int nsamples;
+	float gain;
+	float pan;
+	int ramp;
+	bool loop;
+};
+
+struct Voice {
+	voice_handle handle;
+	const float* samples;
+	int nsamples;
+	int position;
+	bool loop;
+	bool stopping;
+	float gl, gr; // current per-channel gain
+	float tgl, tgr; // ramp target
+	int ramp; // frames left in the ramp
+};
+
+static MpscQueue<MixerCommand, c_ncommands> g_commands;
+static std::atomic<voice_handle> g_next_handle;
+static std::atomic<int> g_nactive_shared;
+static buffer_pool g_pool; // accumulators, then voices
+static Voice* g_voices;
+static float* g_left;
+static float* g_right;
+static int g_max_voices;
+static int g_nactive;
+
+static void pan_gains(float gain, float pan, float* gl, float* gr)
+{
+	if (pan < -1.0f)
+		pan = -1.0f;
+	else if (pan > 1.0f)
+		pan = 1.0f;
+
+	const float angle = (pan + 1.0f) * 0.785398163f;
+	*gl = gain * cosf(angle);
+	*gr = gain * sinf(angle);
+}
+
+static Voice* find_voice(voice_handle handle)
+{
+	for (int ii = 0; ii < g_nactive; ++ii) {
+		if (g_voices[ii].handle == handle)
+			return &g_voices[ii];
+	}
+
+	return 0;
+}
+
+static void apply_command(const MixerCommand* cmd)
+{
+	if (cmd->type == command_play) {
+		if (g_nactive == g_max_voices || !cmd->samples || cmd->nsamples <= 0)
+			return;
+
+		Voice* v = &g_voices[g_nactive++];
+		v->handle = cmd->voice;
+		v->samples = cmd->samples;
+		v->nsamples = cmd->nsamples;
+		v->position = 0;
+		v->loop = cmd->loop;
+		v->stopping = false;
+		pan_gains(cmd->gain, cmd->pan, &v->tgl, &v->tgr);
+
+		// fade in over a few frames to avoid a click
+		v->gl = v->gr = 0.0f;
+		v->ramp = c_default_ramp;
+		return;
+	}
+
+	Voice* v = find_voice(cmd->voice);
+	if (!v)
+		return;
+
+	if (cmd->type == command_set)
+		pan_gains(cmd->gain, cmd->pan, &v->tgl, &v->tgr);
+	else {
+		v->tgl = v->tgr = 0.0f;
+		v->stopping = true;
+	}
+
+	v->ramp = (cmd->ramp > 0) ? cmd->ramp : 1;
+}
+
+// Mix up to n frames of one voice; returns false once the voice is done
+static bool mix_voice(Voice* v, int n)
+{
+	int offset = 0;
+	while (offset < n) {
+
+		int count = n - offset;
+		const int remaining = v->nsamples - v->position;
+		if (count > remaining)
+			count = remaining;
+
+		float dgl = 0.0f, dgr = 0.0f;
+		if (v->ramp) {
+			if (count > v->ramp)
+				count = v->ramp;
+			dgl = (v->tgl - v->gl) / v->ramp;
+			dgr = (v->tgr - v->gr) / v->ramp;
+		}
+
+		mix_mono(g_left + offset, g_right + offset, v->samples + v->position, count, v->gl, v->gr, dgl, dgr);
+
+		offset += count;
+		v->position += count;
+		if (v->ramp) {
+			v->ramp -= count;
+			if (v->ramp) {
+				v->gl += dgl * count;
+				v->gr += dgr * count;
+			} else {
+				v->gl = v->tgl;
+				v->gr = v->tgr;
+				if (v->stopping)
+					return false;
+			}
+		}
+
+		if (v->position == v->nsamples) {
+			if (!v->loop)
+				return false;
+			v->position = 0;
+		}
+	}
+
+	return true;
+}
+
+bool mixer_init(int max_voices)
+{
+	const size_t accum_bytes = sizeof(float) * c_nblock;
+	const size_t voice_bytes = sizeof(Voice) * max_voices;
+	const size_t block_bytes = (accum_bytes > voice_bytes) ? accum_bytes : voice_bytes;
+	if (!pool_create(&g_pool, block_bytes, 3))
+		return false;
+
+	g_left = (float*)pool_block(&g_pool, 0);
+	g_right = (float*)pool_block(&g_pool, 1);
+	g_voices = (Voice*)pool_block(&g_pool, 2);
+	g_max_voices = max_voices;
+	g_nactive = 0;
+	g_nactive_shared.store(0);
+	g_next_handle.store(1);
+	g_commands.reset();
+	return true;
+}
+
+void mixer_release()
+{
+	pool_destroy(&g_pool);
+	g_voices = 0;
+	g_left = g_right = 0;
+}
+
+void mixer_render(sample_type* samples, int nsamples)
+{
+	MixerCommand cmd;
+	while (g_commands.pop(&cmd))
+		apply_command(&cmd);
+
+	while (nsamples) {
+		const int n = (nsamples < c_nblock) ? nsamples : c_nblock;
+
+		memset(g_left, 0, sizeof(float) * n);
+		memset(g_right, 0, sizeof(float) * n);
+
+		for (int ii = 0; ii < g_nactive; ) {
+			if (mix_voice(&g_voices[ii], n)) {
+				++ii;
+			} else {
+				g_voices[ii] = g_voices[--g_nactive];
+			}
+		}
+
+		stereo_to_bus(g_left, g_right, samples, n);
+		samples += n * 2;
+		nsamples -= n;
+	}
+
+	g_nactive_shared.store(g_nactive, std::memory_order_relaxed);
+}
+
+voice_handle mixer_play(const float* samples, int nsamples, float gain, float pan, bool loop)
+{
+	voice_handle handle = g_next_handle.fetch_add(1, std::memory_order_relaxed);
+	if (!handle)
+		handle = g_next_handle.fetch_add(1, std::memory_order_relaxed);
+
+	MixerCommand cmd;
+	cmd.type = command_play;
+	cmd.voice = handle;
+	cmd.samples = samples;
+	cmd.nsamples = nsamples;
+	cmd.gain = gain;
+	cmd.pan = pan;
+	cmd.ramp = 0;
+	cmd.loop = loop;
+	return g_commands.push(cmd) ? handle : 0;
+}
+
+void mixer_set(voice_handle voice, float gain, float pan, int ramp_frames)
+{
+	MixerCommand cmd;
+	cmd.type = command_set;
+	cmd.voice = voice;
+	cmd.samples = 0;
+	cmd.nsamples = 0;
+	cmd.gain = gain;
+	cmd.pan = pan;
+	cmd.ramp = ramp_frames;
+	cmd.loop = false;
+	g_commands.push(cmd);
+}
+
+void mixer_stop(voice_handle voice, int ramp_frames)
+{
+	MixerCommand cmd;
+	cmd.type = command_stop;
+	cmd.voice = voice;
+	cmd.samples = 0;
+	cmd.nsamples = 0;
+	cmd.gain = 0.0f;
+	cmd.pan = 0.0f;
+	cmd.ramp = ramp_frames;
+	cmd.loop = false;
+	g_commands.push(cmd);
+}
+
+int mixer_active_voices()
+{
+	return g_nactive_shared.load(std::memory_order_relaxed);
+}
+
+}
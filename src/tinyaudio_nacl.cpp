@@ -25,6 +25,7 @@
  */
 
 #include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
 
 #include <stdint.h>
 #include <string.h>
@@ -42,7 +43,7 @@ static const PPB_Audio* g_ppbAudio;
 static const PPB_AudioConfig* g_ppbAudioConfig;
 static samples_callback g_callback;
 static const char* g_lasterror = "";
-static float scratch[c_nsamples * 2];
+static buffer_pool g_scratch;
 
 #ifdef PPB_AUDIO_CONFIG_INTERFACE_1_1
 static void nacl_stream_callback(void* sample_buffer, uint32_t buffer_size_in_bytes, PP_TimeDelta /*latency*/, void* /*context*/)
@@ -53,6 +54,7 @@ static void nacl_stream_callback(void* sample_buffer, uint32_t buffer_size_in_by
 	if (g_callback) {
 #if TINYAUDIO_FLOAT_BUS
 		const int nvalues = buffer_size_in_bytes / sizeof(short);
+		float* scratch = (float*)pool_block(&g_scratch, 0);
 		g_callback(scratch, nsamples);
 		for (int ii = 0; ii < nvalues; ++ii) {
 			int32_t sample = (int32_t)((float)0x8000 * scratch[ii]);
@@ -108,6 +110,11 @@ bool init(int sample_rate, samples_callback callback)
 		g_ppbAudioConfig->RecommendSampleFrameCount(sampleRate, c_nsamples);
 #endif
 
+	if (!g_scratch.base && !pool_create(&g_scratch, sizeof(float) * 2 * c_nsamples, 1)) {
+		g_lasterror = "failed to allocate the conversion buffer";
+		return false;
+	}
+
 	PP_Resource resource = g_ppbAudioConfig->CreateStereo16Bit(g_ppInstance, sampleRate, nsamples);
 	if (!resource) {
 		g_lasterror = "failed to create a stereo 16bit audio config";
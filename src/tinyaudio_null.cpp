@@ -25,11 +25,176 @@
  */
 
 #include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_latency.h"
+#include "TINYAUDIO/tinyaudio_stats.h"
+#include "tinyaudio_driver.h"
+
+// By default the null driver never calls back. Define TINYAUDIO_NULL_PACED=1
+// to have it run a thread that consumes audio at the wall-clock rate, the
+// way a real device would, without any sound hardware.
+#ifndef TINYAUDIO_NULL_PACED
+#define TINYAUDIO_NULL_PACED 0
+#endif
+
+#if TINYAUDIO_NULL_PACED
+
+#include "TINYAUDIO/tinyaudio_background.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_tap.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+#include "tinyaudio_adaptive.h"
+
+#include <atomic>
+#include <errno.h>
+#include <pthread.h>
+
+namespace tinyaudio {
+TINYAUDIO_DRIVER_BEGIN
+
+static const int c_nsamples = 2048;
+static samples_callback g_callback;
+static pthread_t g_thread;
+static volatile bool g_running;
+static int g_sample_rate;
+static int g_min_latency;
+static int g_max_latency;
+static latency_callback g_latency_callback;
+static AdaptivePeriod g_period;
+static buffer_pool g_pool;
+static const char* g_lasterror = "";
+static int g_nframes;
+static std::atomic<uint64_t> g_periods;
+static std::atomic<uint64_t> g_underruns;
+
+static void timespec_add_ns(timespec* ts, uint64_t ns)
+{
+	ns += ts->tv_nsec;
+	ts->tv_sec += (time_t)(ns / 1000000000ULL);
+	ts->tv_nsec = (long)(ns % 1000000000ULL);
+}
+
+static void* null_thread(void*)
+{
+	sample_type* samples = (sample_type*)pool_block(&g_pool, 0);
+
+	TINYAUDIO_TRACE_THREAD("tinyaudio null");
+	if (g_max_latency) {
+		adaptive_reset(&g_period, g_sample_rate, g_min_latency, g_max_latency);
+		g_nframes = g_period.frames;
+	} else {
+		g_nframes = c_nsamples;
+	}
+
+	if (g_latency_callback)
+		g_latency_callback(g_nframes, g_nframes);
+
+	timespec deadline;
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	while (g_running) {
+
+		const uint64_t start = adaptive_now_ns();
+		TINYAUDIO_TRACE_BEGIN(trace_callback);
+		g_callback(samples, g_nframes);
+		TINYAUDIO_TRACE_END("callback", trace_callback);
+		const uint64_t callback_ns = adaptive_now_ns() - start;
+		run_output_tap(samples, g_nframes);
+
+		// the "device" plays this period until the deadline; finishing
+		// after it means the device would have run dry
+		timespec_add_ns(&deadline, (uint64_t)g_nframes * 1000000000ULL / g_sample_rate);
+
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		const bool xrun = (now.tv_sec > deadline.tv_sec) || (now.tv_sec == deadline.tv_sec && now.tv_nsec > deadline.tv_nsec);
+		g_periods.fetch_add(1, std::memory_order_relaxed);
+		if (xrun) {
+			TINYAUDIO_TRACE_MARKER("underrun");
+			g_underruns.fetch_add(1, std::memory_order_relaxed);
+			deadline = now;
+		}
+
+		if (g_max_latency && adaptive_update(&g_period, xrun, callback_ns)) {
+			g_nframes = g_period.frames;
+			if (g_latency_callback)
+				g_latency_callback(g_nframes, g_nframes);
+		}
+
+		const uint64_t deadline_ns = (uint64_t)deadline.tv_sec * 1000000000ULL + (uint64_t)deadline.tv_nsec;
+		run_background_jobs(deadline_ns, (uint64_t)g_nframes * 1000000000ULL / g_sample_rate);
+
+		TINYAUDIO_TRACE_BEGIN(trace_wait);
+		while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL))
+			;
+		TINYAUDIO_TRACE_END("wait", trace_wait);
+	}
+
+	return 0;
+}
+
+bool init(int sample_rate, samples_callback callback)
+{
+	g_sample_rate = sample_rate;
+	g_callback = callback;
+
+	if (!pool_create(&g_pool, sizeof(sample_type) * 2 * c_nmaxperiod, 1)) {
+		g_lasterror = "failed to allocate render buffer";
+		return false;
+	}
+
+	g_periods.store(0);
+	g_underruns.store(0);
+	reset_background_stats();
+	g_running = true;
+	pthread_create(&g_thread, NULL, &null_thread, NULL);
+	return true;
+}
+
+void release()
+{
+	g_running = false;
+	pthread_join(g_thread, NULL);
+	pool_destroy(&g_pool);
+}
+
+void set_latency_limits(int min_frames, int max_frames)
+{
+	g_min_latency = min_frames;
+	g_max_latency = (max_frames > 0) ? max_frames : 0;
+}
+
+void set_latency_callback(latency_callback callback)
+{
+	g_latency_callback = callback;
+}
+
+void read_driver_stats(driver_stats* stats)
+{
+	stats->periods = g_periods.load(std::memory_order_relaxed);
+	stats->underruns = g_underruns.load(std::memory_order_relaxed);
+	read_background_stats(&stats->background_budget_ns, &stats->background_used_ns);
+}
+
+const char* last_error() { return g_lasterror; }
+
+TINYAUDIO_DRIVER_END
+}
+
+#else
+
+#include <string.h>
 
 namespace tinyaudio {
+TINYAUDIO_DRIVER_BEGIN
 
 bool init(int /*sample_rate*/, samples_callback /*callback*/) { return true; }
 void release() {}
+void set_latency_limits(int /*min_frames*/, int /*max_frames*/) {}
+void set_latency_callback(latency_callback /*callback*/) {}
+void read_driver_stats(driver_stats* stats) { memset(stats, 0, sizeof(*stats)); }
 const char* last_error() { return ""; }
 
+TINYAUDIO_DRIVER_END
 }
+
+#endif
@@ -0,0 +1,316 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_latency.h"
+#include "TINYAUDIO/tinyaudio_pipewire.h"
+#include "TINYAUDIO/tinyaudio_stats.h"
+#include "TINYAUDIO/tinyaudio_tap.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+#include "tinyaudio_adaptive.h"
+#include "tinyaudio_driver.h"
+
+#include <atomic>
+#include <pipewire/pipewire.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/pod/builder.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace tinyaudio {
+TINYAUDIO_DRIVER_BEGIN
+
+#if TINYAUDIO_DYNLOAD
+#if PW_CHECK_VERSION(0, 3, 50)
+#define TINYAUDIO_PIPEWIRE_TIME_SYMBOLS(X) X(pw_stream_get_time_n)
+#else
+#define TINYAUDIO_PIPEWIRE_TIME_SYMBOLS(X)
+#endif
+
+#define TINYAUDIO_PIPEWIRE_SYMBOLS(X) \
+	TINYAUDIO_PIPEWIRE_TIME_SYMBOLS(X) \
+	X(pw_deinit) \
+	X(pw_init) \
+	X(pw_properties_new) \
+	X(pw_properties_setf) \
+	X(pw_stream_connect) \
+	X(pw_stream_dequeue_buffer) \
+	X(pw_stream_destroy) \
+	X(pw_stream_get_state) \
+	X(pw_stream_new_simple) \
+	X(pw_stream_queue_buffer) \
+	X(pw_thread_loop_destroy) \
+	X(pw_thread_loop_get_loop) \
+	X(pw_thread_loop_lock) \
+	X(pw_thread_loop_new) \
+	X(pw_thread_loop_signal) \
+	X(pw_thread_loop_start) \
+	X(pw_thread_loop_stop) \
+	X(pw_thread_loop_timed_wait) \
+	X(pw_thread_loop_unlock)
+
+TINYAUDIO_PIPEWIRE_SYMBOLS(TINYAUDIO_DYNLOAD_DECLARE)
+
+static bool load_library()
+{
+	static const char* const sonames[] = { "libpipewire-0.3.so.0", NULL };
+	void* handle = dynload_open(sonames);
+	if (!handle)
+		return false;
+
+	bool ok = true;
+	TINYAUDIO_PIPEWIRE_SYMBOLS(TINYAUDIO_DYNLOAD_RESOLVE)
+	return ok;
+}
+#endif
+
+static const int c_connect_timeout_s = 5;
+
+static int g_sample_rate;
+static samples_callback g_callback;
+static pw_thread_loop* g_loop;
+static pw_stream* g_stream;
+static const char* g_appname = "tinyaudio app";
+static int g_quantum;
+static int g_min_latency;
+static latency_callback g_latency_callback;
+static int g_nframes; // last period reported
+static std::atomic<uint64_t> g_periods;
+static const int c_nlasterror = 128;
+static char g_lasterror[c_nlasterror];
+
+static void report_latency(int nframes)
+{
+	int latency = nframes;
+#if PW_CHECK_VERSION(0, 3, 50)
+	// plus whatever the graph has queued after us, in our frames
+	pw_time t;
+	if (0 == pw_stream_get_time_n(g_stream, &t, sizeof(t)) && t.rate.denom && t.delay > 0)
+		latency += (int)((uint64_t)t.delay * t.rate.num * g_sample_rate / t.rate.denom);
+#endif
+
+	g_nframes = nframes;
+	if (g_latency_callback)
+		g_latency_callback(nframes, latency);
+}
+
+// Runs on the PipeWire data thread (PW_STREAM_FLAG_RT_PROCESS)
+static void on_process(void*)
+{
+	pw_buffer* b = pw_stream_dequeue_buffer(g_stream);
+	if (!b)
+		return;
+
+	spa_data* d = &b->buffer->datas[0];
+	if (!d->data) {
+		pw_stream_queue_buffer(g_stream, b);
+		return;
+	}
+
+	const int stride = (int)sizeof(sample_type) * 2;
+	int nframes = (int)(d->maxsize / stride);
+#if PW_CHECK_VERSION(0, 3, 49)
+	if (b->requested && (uint64_t)nframes > b->requested)
+		nframes = (int)b->requested;
+#endif
+
+	if (nframes != g_nframes)
+		report_latency(nframes);
+
+	sample_type* samples = (sample_type*)d->data;
+	for (int offset = 0; offset < nframes; ) {
+		int n = nframes - offset;
+		if (n > c_nmaxperiod)
+			n = c_nmaxperiod;
+
+		TINYAUDIO_TRACE_BEGIN(trace_callback);
+		g_callback(samples + offset * 2, n);
+		TINYAUDIO_TRACE_END("callback", trace_callback);
+		run_output_tap(samples + offset * 2, n);
+		offset += n;
+	}
+
+	d->chunk->offset = 0;
+	d->chunk->stride = stride;
+	d->chunk->size = (uint32_t)(nframes * stride);
+	pw_stream_queue_buffer(g_stream, b);
+	g_periods.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void on_state_changed(void*, pw_stream_state, pw_stream_state state, const char* error)
+{
+	if (state == PW_STREAM_STATE_ERROR)
+		snprintf(g_lasterror, c_nlasterror, "pipewire stream error: %s", error ? error : "unknown");
+
+	if (state == PW_STREAM_STATE_ERROR || state == PW_STREAM_STATE_PAUSED || state == PW_STREAM_STATE_STREAMING)
+		pw_thread_loop_signal(g_loop, false);
+}
+
+static pw_stream_events g_events;
+
+static void destroy_stream()
+{
+	if (g_loop)
+		pw_thread_loop_stop(g_loop);
+	if (g_stream)
+		pw_stream_destroy(g_stream);
+	if (g_loop)
+		pw_thread_loop_destroy(g_loop);
+
+	g_stream = NULL;
+	g_loop = NULL;
+	pw_deinit();
+}
+
+bool init(int sample_rate, samples_callback callback)
+{
+	g_sample_rate = sample_rate;
+	g_callback = callback;
+	g_nframes = 0;
+	g_periods.store(0);
+	g_lasterror[0] = 0;
+
+#if TINYAUDIO_DYNLOAD
+	if (!load_library()) {
+		snprintf(g_lasterror, c_nlasterror, "failed to load libpipewire-0.3");
+		return false;
+	}
+#endif
+
+	pw_init(NULL, NULL);
+	g_loop = pw_thread_loop_new("tinyaudio", NULL);
+	if (!g_loop) {
+		snprintf(g_lasterror, c_nlasterror, "failed to create pipewire loop");
+		destroy_stream();
+		return false;
+	}
+
+	pw_properties* props = pw_properties_new(
+		PW_KEY_MEDIA_TYPE, "Audio",
+		PW_KEY_MEDIA_CATEGORY, "Playback",
+		PW_KEY_MEDIA_ROLE, "Game",
+		PW_KEY_APP_NAME, g_appname,
+		NULL);
+	const int quantum = g_quantum ? g_quantum : g_min_latency;
+	if (quantum > 0)
+		pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%d/%d", quantum, sample_rate);
+
+	memset(&g_events, 0, sizeof(g_events));
+	g_events.version = PW_VERSION_STREAM_EVENTS;
+	g_events.state_changed = &on_state_changed;
+	g_events.process = &on_process;
+
+	pw_thread_loop_lock(g_loop);
+	g_stream = pw_stream_new_simple(pw_thread_loop_get_loop(g_loop), g_appname, props, &g_events, NULL);
+	if (!g_stream) {
+		pw_thread_loop_unlock(g_loop);
+		snprintf(g_lasterror, c_nlasterror, "failed to create pipewire stream");
+		destroy_stream();
+		return false;
+	}
+
+	spa_audio_info_raw info;
+	memset(&info, 0, sizeof(info));
+#if TINYAUDIO_FLOAT_BUS
+	info.format = SPA_AUDIO_FORMAT_F32;
+#else
+	info.format = SPA_AUDIO_FORMAT_S16;
+#endif
+	info.rate = (uint32_t)sample_rate;
+	info.channels = 2;
+	info.position[0] = SPA_AUDIO_CHANNEL_FL;
+	info.position[1] = SPA_AUDIO_CHANNEL_FR;
+
+	uint8_t buffer[1024];
+	spa_pod_builder builder;
+	spa_pod_builder_init(&builder, buffer, sizeof(buffer));
+	const spa_pod* params[1] = { spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &info) };
+
+	const pw_stream_flags flags = (pw_stream_flags)(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS);
+	bool ok = (0 == pw_stream_connect(g_stream, PW_DIRECTION_OUTPUT, PW_ID_ANY, flags, params, 1))
+		&& (0 == pw_thread_loop_start(g_loop));
+
+	// wait for the stream to negotiate (or fail) before returning
+	while (ok) {
+		const pw_stream_state state = pw_stream_get_state(g_stream, NULL);
+		if (state == PW_STREAM_STATE_PAUSED || state == PW_STREAM_STATE_STREAMING)
+			break;
+		if (state == PW_STREAM_STATE_ERROR || 0 != pw_thread_loop_timed_wait(g_loop, c_connect_timeout_s))
+			ok = false;
+	}
+	pw_thread_loop_unlock(g_loop);
+
+	if (!ok) {
+		if (!g_lasterror[0])
+			snprintf(g_lasterror, c_nlasterror, "failed to connect pipewire stream");
+		destroy_stream();
+		return false;
+	}
+
+	return true;
+}
+
+void release()
+{
+	destroy_stream();
+}
+
+void set_pipewire_application_name(const char* name)
+{
+	g_appname = name;
+}
+
+void set_pipewire_quantum(int frames)
+{
+	g_quantum = frames;
+}
+
+void set_latency_limits(int min_frames, int /*max_frames*/)
+{
+	g_min_latency = min_frames;
+}
+
+void set_latency_callback(latency_callback callback)
+{
+	g_latency_callback = callback;
+}
+
+// the stream never tells us when the graph ran dry
+void read_driver_stats(driver_stats* stats)
+{
+	stats->periods = g_periods.load(std::memory_order_relaxed);
+	stats->underruns = 0;
+	stats->background_budget_ns = 0;
+	stats->background_used_ns = 0;
+}
+
+const char* last_error()
+{
+	return g_lasterror;
+}
+
+TINYAUDIO_DRIVER_END
+}
@@ -25,7 +25,16 @@
  */
 
 #include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_background.h"
+#include "TINYAUDIO/tinyaudio_latency.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_stats.h"
+#include "TINYAUDIO/tinyaudio_tap.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+#include "tinyaudio_adaptive.h"
+#include "tinyaudio_driver.h"
 
+#include <atomic>
 #include <stdio.h>
 #include <string.h>
 #include <pthread.h>
@@ -33,6 +42,31 @@
 #include <semaphore.h>
 
 namespace tinyaudio {
+TINYAUDIO_DRIVER_BEGIN
+
+#if TINYAUDIO_DYNLOAD
+#define TINYAUDIO_PULSE_SYMBOLS(X) \
+	X(pa_simple_drain) \
+	X(pa_simple_flush) \
+	X(pa_simple_free) \
+	X(pa_simple_get_latency) \
+	X(pa_simple_new) \
+	X(pa_simple_write)
+
+TINYAUDIO_PULSE_SYMBOLS(TINYAUDIO_DYNLOAD_DECLARE)
+
+static bool load_library()
+{
+	static const char* const sonames[] = { "libpulse-simple.so.0", NULL };
+	void* handle = dynload_open(sonames);
+	if (!handle)
+		return false;
+
+	bool ok = true;
+	TINYAUDIO_PULSE_SYMBOLS(TINYAUDIO_DYNLOAD_RESOLVE)
+	return ok;
+}
+#endif
 
 static int g_sample_rate;
 static samples_callback g_callback;
@@ -41,13 +75,20 @@ static pa_simple* g_pulse;
 static const char* g_appname = "tinyaudio app";
 static bool g_running;
 static const int c_nsamples = 2048;
+static const int c_nperiods = 2;
+static int g_min_latency;
+static int g_max_latency;
+static latency_callback g_latency_callback;
+static AdaptivePeriod g_period;
+static buffer_pool g_pool;
+static int g_nframes;
+static std::atomic<uint64_t> g_periods;
+static std::atomic<uint64_t> g_underruns;
 static const int c_nlasterror = 128;
 static char g_lasterror[c_nlasterror];
 
-static void* pulse_thread(void* context)
+static pa_simple* pulse_connect()
 {
-	sem_t* init = (sem_t*)context;
-
 	pa_sample_spec ss;
 #if TINYAUDIO_FLOAT_BUS
 	ss.format = PA_SAMPLE_FLOAT32LE;
@@ -57,24 +98,106 @@ static void* pulse_thread(void* context)
 	ss.channels = 2;
 	ss.rate = g_sample_rate;
 
+	// without limits, leave buffering to the server like we always have
+	pa_buffer_attr attr;
+	pa_buffer_attr* pattr = NULL;
+	int latency = 0;
+	if (g_max_latency) {
+		const uint32_t frame_bytes = sizeof(sample_type) * 2;
+		g_nframes = g_period.frames;
+		latency = g_nframes * c_nperiods;
+
+		attr.maxlength = (uint32_t)-1;
+		attr.tlength = latency * frame_bytes;
+		attr.prebuf = (uint32_t)-1;
+		attr.minreq = g_nframes * frame_bytes;
+		attr.fragsize = (uint32_t)-1;
+		pattr = &attr;
+	} else {
+		g_nframes = c_nsamples;
+	}
+
 	int err;
-	g_pulse = pa_simple_new(NULL, g_appname, PA_STREAM_PLAYBACK, NULL, g_appname, &ss, NULL, NULL, &err);
-	if (!g_pulse) {
+	pa_simple* s = pa_simple_new(NULL, g_appname, PA_STREAM_PLAYBACK, NULL, g_appname, &ss, NULL, pattr, &err);
+	if (!s) {
 		snprintf(g_lasterror, c_nlasterror, "failed to connect to pulse server: %d", err);
+		return 0;
 	}
 
+	if (g_latency_callback) {
+		if (!latency)
+			latency = (int)(pa_simple_get_latency(s, NULL) * g_sample_rate / 1000000);
+		g_latency_callback(g_nframes, latency);
+	}
+
+	return s;
+}
+
+static void* pulse_thread(void* context)
+{
+	sem_t* init = (sem_t*)context;
+
+	TINYAUDIO_TRACE_THREAD("tinyaudio pulse");
+	if (g_max_latency)
+		adaptive_reset(&g_period, g_sample_rate, g_min_latency / c_nperiods, g_max_latency / c_nperiods);
+
+	g_pulse = pulse_connect();
+
 	sem_post(init);
 	if (!g_pulse)
 		return 0;
 
 	pa_simple* s = g_pulse;
-	sample_type samples[c_nsamples*2];
+	sample_type* samples = (sample_type*)pool_block(&g_pool, 0);
+	int written = 0;
 
 	g_running = true;
 	while (g_running) {
-		g_callback(samples, c_nsamples);
-		if (0 > pa_simple_write(s, samples, sizeof(samples), NULL))
+
+		// pa_simple does not report underruns; treat a server-side queue
+		// that has nearly run dry by the time we are back as one
+		bool xrun = false;
+		if (g_max_latency && written >= g_nframes * c_nperiods) {
+			const pa_usec_t queued = pa_simple_get_latency(s, NULL);
+			xrun = (queued * g_sample_rate / 1000000) * 4 < (pa_usec_t)g_nframes;
+			if (xrun) {
+				TINYAUDIO_TRACE_MARKER("underrun");
+				g_underruns.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		const uint64_t start = adaptive_now_ns();
+		TINYAUDIO_TRACE_BEGIN(trace_callback);
+		g_callback(samples, g_nframes);
+		TINYAUDIO_TRACE_END("callback", trace_callback);
+		const uint64_t callback_ns = adaptive_now_ns() - start;
+		run_output_tap(samples, g_nframes);
+
+		TINYAUDIO_TRACE_BEGIN(trace_write);
+		const int err = pa_simple_write(s, samples, sizeof(sample_type) * 2 * g_nframes, NULL);
+		TINYAUDIO_TRACE_END("write", trace_write);
+		if (0 > err)
 			break;
+
+		g_periods.fetch_add(1, std::memory_order_relaxed);
+
+		// the write returned once there was room for a period; the next
+		// callback has to be done about one period from now
+		const uint64_t period_ns = (uint64_t)g_nframes * 1000000000ULL / g_sample_rate;
+		run_background_jobs(adaptive_now_ns() + period_ns - callback_ns, period_ns);
+
+		if (written < g_nframes * c_nperiods)
+			written += g_nframes;
+		if (g_max_latency && adaptive_update(&g_period, xrun, callback_ns)) {
+			TINYAUDIO_TRACE_BEGIN(trace_reconfigure);
+			pa_simple_drain(s, NULL);
+			pa_simple_free(s);
+			g_pulse = s = pulse_connect();
+			TINYAUDIO_TRACE_END("reconfigure", trace_reconfigure);
+			if (!s)
+				return 0;
+			written = 0;
+		}
 	}
 
 	pa_simple_flush(s, NULL);
@@ -93,14 +216,33 @@ bool init(int sample_rate, samples_callback callback)
 	g_sample_rate = sample_rate;
 	g_callback = callback;
 
+#if TINYAUDIO_DYNLOAD
+	if (!load_library()) {
+		snprintf(g_lasterror, c_nlasterror, "failed to load libpulse-simple");
+		return false;
+	}
+#endif
+
+	if (!pool_create(&g_pool, sizeof(sample_type) * 2 * c_nmaxperiod, 1)) {
+		snprintf(g_lasterror, c_nlasterror, "failed to allocate render buffer");
+		return false;
+	}
+
+	g_periods.store(0);
+	g_underruns.store(0);
+	reset_background_stats();
+
 	sem_t init;
 	sem_init(&init, 0, 0);
 	pthread_create(&g_thread, NULL, &pulse_thread, &init);
 	sem_wait(&init);
 	sem_destroy(&init);
 
-	if (!g_pulse)
+	if (!g_pulse) {
+		pthread_join(g_thread, NULL);
+		pool_destroy(&g_pool);
 		return false;
+	}
 	return true;
 }
 
@@ -108,6 +250,25 @@ void release()
 {
 	g_running = false;
 	pthread_join(g_thread, NULL);
+	pool_destroy(&g_pool);
+}
+
+void set_latency_limits(int min_frames, int max_frames)
+{
+	g_min_latency = min_frames;
+	g_max_latency = (max_frames > 0) ? max_frames : 0;
+}
+
+void set_latency_callback(latency_callback callback)
+{
+	g_latency_callback = callback;
+}
+
+void read_driver_stats(driver_stats* stats)
+{
+	stats->periods = g_periods.load(std::memory_order_relaxed);
+	stats->underruns = g_underruns.load(std::memory_order_relaxed);
+	read_background_stats(&stats->background_budget_ns, &stats->background_used_ns);
 }
 
 const char* last_error()
@@ -115,4 +276,5 @@ const char* last_error()
 	return g_lasterror;
 }
 
+TINYAUDIO_DRIVER_END
 }
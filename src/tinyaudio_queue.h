@@ -0,0 +1,99 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_QUEUE_H
+#define TINYAUDIO_QUEUE_H
+
+// Bounded lock-free queue (Vyukov). Any number of producers may push; one
+// consumer pops. Storage is inline, so nothing is allocated after
+// construction. Internal.
+
+#include <atomic>
+#include <stdint.h>
+
+namespace tinyaudio {
+
+template<typename T, int N>
+struct MpscQueue {
+	static_assert((N & (N - 1)) == 0, "queue size must be a power of two");
+
+	struct Cell {
+		std::atomic<uint32_t> sequence;
+		T value;
+	};
+
+	Cell cells[N];
+	std::atomic<uint32_t> tail; // next slot to push
+	uint32_t head; // next slot to pop (consumer only)
+
+	void reset()
+	{
+		for (int ii = 0; ii < N; ++ii)
+			cells[ii].sequence.store((uint32_t)ii, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+		head = 0;
+	}
+
+	bool push(const T& value)
+	{
+		uint32_t pos = tail.load(std::memory_order_relaxed);
+		for (;;) {
+			Cell* cell = &cells[pos & (N - 1)];
+			const uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+			const int32_t diff = (int32_t)(sequence - pos);
+			if (diff == 0) {
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			} else if (diff < 0) {
+				return false; // full
+			} else {
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		Cell* cell = &cells[pos & (N - 1)];
+		cell->value = value;
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T* value)
+	{
+		Cell* cell = &cells[head & (N - 1)];
+		const uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+		if ((int32_t)(sequence - (head + 1)) < 0)
+			return false; // empty, or a producer has not finished writing
+
+		*value = cell->value;
+		cell->sequence.store(head + N, std::memory_order_release);
+		++head;
+		return true;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,235 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_record.h"
+#include "TINYAUDIO/tinyaudio_tap.h"
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace tinyaudio {
+
+static const uint64_t c_ring_bytes = 4 << 20; // ~10 s of 48 kHz float stereo
+static const uint64_t c_write_bytes = 256 << 10;
+static const uint64_t c_data_offset = 4096; // keeps file offsets page aligned
+static const long c_poll_ns = 10000000;
+
+static buffer_pool g_pool;
+static uint8_t* g_ring;
+static int g_fd = -1;
+static pthread_t g_thread;
+static std::atomic<bool> g_running;
+static bool g_failed;
+
+// Single producer (audio thread), single consumer (writer thread)
+static std::atomic<uint64_t> g_head; // bytes produced
+static std::atomic<uint64_t> g_tail; // bytes consumed
+static std::atomic<uint64_t> g_dropped;
+static std::atomic<uint64_t> g_written; // bytes on disk
+
+static void put_u16(uint8_t* p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v)
+{
+	put_u16(p, (uint16_t)v);
+	put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint32_t chunk_size(uint64_t bytes)
+{
+	return bytes > 0xffffffffULL ? 0xffffffffU : (uint32_t)bytes;
+}
+
+// RIFF header padded with a JUNK chunk so the samples start at c_data_offset
+static void wav_header(uint8_t* h, int sample_rate, uint64_t data_bytes)
+{
+	const int sample_bytes = (int)sizeof(sample_type);
+
+	memset(h, 0, c_data_offset);
+	memcpy(h, "RIFF", 4);
+	put_u32(h + 4, chunk_size(c_data_offset - 8 + data_bytes));
+	memcpy(h + 8, "WAVE", 4);
+
+	memcpy(h + 12, "fmt ", 4);
+	put_u32(h + 16, 16);
+	put_u16(h + 20, TINYAUDIO_FLOAT_BUS ? 3 : 1); // IEEE float / PCM
+	put_u16(h + 22, 2);
+	put_u32(h + 24, (uint32_t)sample_rate);
+	put_u32(h + 28, (uint32_t)(sample_rate * 2 * sample_bytes));
+	put_u16(h + 32, (uint16_t)(2 * sample_bytes));
+	put_u16(h + 34, (uint16_t)(8 * sample_bytes));
+
+	memcpy(h + 36, "JUNK", 4);
+	put_u32(h + 40, (uint32_t)(c_data_offset - 8 - 44));
+
+	memcpy(h + c_data_offset - 8, "data", 4);
+	put_u32(h + c_data_offset - 4, chunk_size(data_bytes));
+}
+
+// Audio thread: copy the period into the ring or drop it whole
+static void record_tap(const sample_type* samples, int nframes)
+{
+	const uint64_t bytes = sizeof(sample_type) * 2 * (uint64_t)nframes;
+	const uint64_t head = g_head.load(std::memory_order_relaxed);
+	const uint64_t tail = g_tail.load(std::memory_order_acquire);
+	if (c_ring_bytes - (head - tail) < bytes) {
+		g_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	const uint64_t at = head & (c_ring_bytes - 1);
+	const uint64_t first = (bytes < c_ring_bytes - at) ? bytes : c_ring_bytes - at;
+	memcpy(g_ring + at, samples, first);
+	memcpy(g_ring, (const uint8_t*)samples + first, bytes - first);
+	g_head.store(head + bytes, std::memory_order_release);
+}
+
+static void write_out(const uint8_t* data, uint64_t bytes)
+{
+	const uint64_t offset = c_data_offset + g_written.load(std::memory_order_relaxed);
+	uint64_t done = 0;
+	while (!g_failed && done < bytes) {
+		const ssize_t n = pwrite(g_fd, data + done, bytes - done, (off_t)(offset + done));
+		if (n > 0)
+			done += (uint64_t)n;
+		else if (n < 0 && errno != EINTR)
+			g_failed = true;
+	}
+
+	// after a failure the ring is still drained so the audio side keeps going
+	g_written.store(g_written.load(std::memory_order_relaxed) + done, std::memory_order_relaxed);
+	g_tail.store(g_tail.load(std::memory_order_relaxed) + bytes, std::memory_order_release);
+}
+
+// Writer thread: whole c_write_bytes chunks only, which never straddle the
+// ring's end, so every write is one aligned pwrite from the ring itself
+static void drain(bool flush)
+{
+	for (;;) {
+		const uint64_t tail = g_tail.load(std::memory_order_relaxed);
+		const uint64_t avail = g_head.load(std::memory_order_acquire) - tail;
+		const uint64_t at = tail & (c_ring_bytes - 1);
+		const uint64_t to_end = c_ring_bytes - at;
+
+		if (avail >= c_write_bytes && to_end >= c_write_bytes)
+			write_out(g_ring + at, c_write_bytes);
+		else if (flush && avail)
+			write_out(g_ring + at, avail < to_end ? avail : to_end);
+		else
+			break;
+	}
+}
+
+static void* writer_thread(void*)
+{
+	while (g_running.load(std::memory_order_acquire)) {
+		drain(false);
+
+		timespec wait = { 0, c_poll_ns };
+		nanosleep(&wait, NULL);
+	}
+
+	return NULL;
+}
+
+bool record_start(const char* path, int sample_rate)
+{
+	if (g_fd >= 0)
+		return false;
+
+	const int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd < 0)
+		return false;
+
+	uint8_t header[c_data_offset];
+	wav_header(header, sample_rate, 0);
+	if (!pool_create(&g_pool, (int)c_ring_bytes, 1) || (ssize_t)sizeof(header) != pwrite(fd, header, sizeof(header), 0)) {
+		pool_destroy(&g_pool);
+		close(fd);
+		return false;
+	}
+
+	g_ring = (uint8_t*)pool_block(&g_pool, 0);
+	g_fd = fd;
+	g_failed = false;
+	g_head.store(0);
+	g_tail.store(0);
+	g_dropped.store(0);
+	g_written.store(0);
+	g_running.store(true);
+	pthread_create(&g_thread, NULL, &writer_thread, NULL);
+
+	set_output_tap(&record_tap);
+	return true;
+}
+
+bool record_stop()
+{
+	if (g_fd < 0)
+		return false;
+
+	set_output_tap(NULL);
+	g_running.store(false, std::memory_order_release);
+	pthread_join(g_thread, NULL);
+	drain(true);
+
+	// patch the RIFF and data sizes now that the length is known
+	const uint64_t bytes = g_written.load();
+	uint8_t riff[4], data[4];
+	put_u32(riff, chunk_size(c_data_offset - 8 + bytes));
+	put_u32(data, chunk_size(bytes));
+	bool ok = !g_failed
+		&& 4 == pwrite(g_fd, riff, 4, 4)
+		&& 4 == pwrite(g_fd, data, 4, (off_t)(c_data_offset - 4));
+	ok = (0 == close(g_fd)) && ok;
+
+	g_fd = -1;
+	pool_destroy(&g_pool);
+	return ok;
+}
+
+uint64_t record_frames_written()
+{
+	return g_written.load(std::memory_order_relaxed) / (sizeof(sample_type) * 2);
+}
+
+uint64_t record_dropped_blocks()
+{
+	return g_dropped.load(std::memory_order_relaxed);
+}
+
+}
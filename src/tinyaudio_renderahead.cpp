@@ -0,0 +1,204 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_renderahead.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+
+#include <atomic>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+namespace tinyaudio {
+
+static const int c_nsamples = 2048;
+static const int c_nmaxdepth = 16;
+
+static buffer_pool g_pool;
+static unsigned g_generations[c_nmaxdepth];
+static samples_callback g_callback;
+static pthread_t g_thread;
+static sem_t g_space;
+static sem_t g_primed;
+static std::atomic<bool> g_running;
+static std::atomic<int> g_depth;
+static std::atomic<unsigned> g_generation;
+static std::atomic<unsigned> g_write; // blocks produced by the render thread
+static std::atomic<unsigned> g_read; // blocks consumed by the device thread
+static std::atomic<unsigned> g_underruns;
+static int g_offset; // frames already copied out of the head block
+
+static void* render_thread(void*)
+{
+	bool primed = false;
+	TINYAUDIO_TRACE_THREAD("tinyaudio render-ahead");
+	while (g_running.load(std::memory_order_relaxed)) {
+
+		const unsigned write = g_write.load(std::memory_order_relaxed);
+		const unsigned read = g_read.load(std::memory_order_acquire);
+		if (write - read >= (unsigned)g_depth.load(std::memory_order_relaxed)) {
+			if (!primed) {
+				primed = true;
+				sem_post(&g_primed);
+			}
+
+			sem_wait(&g_space);
+			continue;
+		}
+
+		// tag the block before rendering so a flush that happens while
+		// the callback runs still discards it
+		const int index = write % c_nmaxdepth;
+		g_generations[index] = g_generation.load(std::memory_order_acquire);
+		TINYAUDIO_TRACE_BEGIN(trace_callback);
+		g_callback((sample_type*)pool_block(&g_pool, index), c_nsamples);
+		TINYAUDIO_TRACE_END("callback", trace_callback);
+		g_write.store(write + 1, std::memory_order_release);
+	}
+
+	if (!primed)
+		sem_post(&g_primed);
+	return 0;
+}
+
+static void consume_block(unsigned read)
+{
+	g_offset = 0;
+	g_read.store(read + 1, std::memory_order_release);
+	sem_post(&g_space);
+}
+
+static void device_callback(sample_type* samples, int nsamples)
+{
+	const unsigned generation = g_generation.load(std::memory_order_acquire);
+
+	while (nsamples) {
+
+		const unsigned read = g_read.load(std::memory_order_relaxed);
+		if (read == g_write.load(std::memory_order_acquire)) {
+			memset(samples, 0, sizeof(sample_type) * 2 * nsamples);
+			g_underruns.fetch_add(1, std::memory_order_relaxed);
+			TINYAUDIO_TRACE_MARKER("render-ahead underrun");
+			return;
+		}
+
+		const int index = read % c_nmaxdepth;
+		if (g_generations[index] != generation) {
+			consume_block(read);
+			continue;
+		}
+
+		int n = c_nsamples - g_offset;
+		if (n > nsamples)
+			n = nsamples;
+
+		const sample_type* block = (const sample_type*)pool_block(&g_pool, index);
+		memcpy(samples, block + g_offset * 2, sizeof(sample_type) * 2 * n);
+		samples += n * 2;
+		nsamples -= n;
+
+		g_offset += n;
+		if (g_offset == c_nsamples)
+			consume_block(read);
+	}
+}
+
+bool renderahead_init(int sample_rate, samples_callback callback, int depth)
+{
+	if (!pool_create(&g_pool, sizeof(sample_type) * 2 * c_nsamples, c_nmaxdepth))
+		return false;
+
+	g_callback = callback;
+	g_generation.store(0);
+	g_write.store(0);
+	g_read.store(0);
+	g_underruns.store(0);
+	g_offset = 0;
+
+	sem_init(&g_space, 0, 0);
+	sem_init(&g_primed, 0, 0);
+	renderahead_set_depth(depth);
+
+	// let the render thread fill the queue before the device starts pulling
+	g_running = true;
+	pthread_create(&g_thread, NULL, &render_thread, NULL);
+	sem_wait(&g_primed);
+
+	if (!init(sample_rate, &device_callback)) {
+		g_running = false;
+		sem_post(&g_space);
+		pthread_join(g_thread, NULL);
+		sem_destroy(&g_primed);
+		sem_destroy(&g_space);
+		pool_destroy(&g_pool);
+		return false;
+	}
+
+	return true;
+}
+
+void renderahead_release()
+{
+	release();
+
+	g_running = false;
+	sem_post(&g_space);
+	pthread_join(g_thread, NULL);
+
+	sem_destroy(&g_primed);
+	sem_destroy(&g_space);
+	pool_destroy(&g_pool);
+}
+
+void renderahead_set_depth(int depth)
+{
+	if (depth < 1)
+		depth = 1;
+	else if (depth > c_nmaxdepth)
+		depth = c_nmaxdepth;
+
+	g_depth.store(depth, std::memory_order_relaxed);
+	sem_post(&g_space);
+}
+
+int renderahead_max_depth()
+{
+	return c_nmaxdepth;
+}
+
+void renderahead_flush()
+{
+	g_generation.fetch_add(1, std::memory_order_acq_rel);
+}
+
+unsigned renderahead_underruns()
+{
+	return g_underruns.load(std::memory_order_relaxed);
+}
+
+}
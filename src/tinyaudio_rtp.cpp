@@ -0,0 +1,287 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_latency.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_rtp.h"
+#include "TINYAUDIO/tinyaudio_tap.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+#include "tinyaudio_adaptive.h"
+#include "tinyaudio_rtp_packet.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace tinyaudio {
+
+static const int c_nslots = 256; // packets in flight, including ones held back by jitter_us
+
+static samples_callback g_callback;
+static pthread_t g_thread;
+static volatile bool g_running;
+static int g_sample_rate;
+static latency_callback g_latency_callback;
+static rtp_settings g_settings = rtp_default_settings();
+static buffer_pool g_pool; // render buffer, then the packet slots
+static const char* g_lasterror = "";
+
+static int g_fd = -1;
+static sockaddr_storage g_addr;
+static socklen_t g_addrlen;
+static uint32_t g_rng;
+
+struct Packet {
+	uint64_t due_ns;
+	int bytes;
+	uint8_t data[c_rtp_max_packet];
+};
+
+static Packet* g_packets;
+static int g_free[c_nslots];
+static int g_nfree;
+static int g_pending[c_nslots];
+static int g_npending;
+
+static uint32_t random_u32()
+{
+	g_rng ^= g_rng << 13;
+	g_rng ^= g_rng >> 17;
+	g_rng ^= g_rng << 5;
+	return g_rng;
+}
+
+static void timespec_from_ns(timespec* ts, uint64_t ns)
+{
+	ts->tv_sec = (time_t)(ns / 1000000000ULL);
+	ts->tv_nsec = (long)(ns % 1000000000ULL);
+}
+
+static void sleep_until(uint64_t ns)
+{
+	timespec deadline;
+	timespec_from_ns(&deadline, ns);
+	while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL))
+		;
+}
+
+// Split one rendered burst into packets due at burst_ns (plus any jitter)
+static void packetize(const sample_type* samples, uint16_t* seq, uint32_t* timestamp, uint32_t ssrc, uint64_t burst_ns)
+{
+	const int frames = g_settings.packet_frames;
+	const uint32_t loss = (uint32_t)(g_settings.loss * 4294967295.0f);
+	const uint64_t jitter_ns = (uint64_t)g_settings.jitter_us * 1000;
+
+	for (int p = 0; p < g_settings.burst_packets; ++p, samples += 2 * frames) {
+		const uint16_t s = (*seq)++;
+		const uint32_t ts = *timestamp;
+		*timestamp += frames;
+
+		if ((loss && random_u32() < loss) || !g_nfree)
+			continue;
+
+		Packet* packet = &g_packets[g_free[--g_nfree]];
+		packet->due_ns = burst_ns + (jitter_ns ? random_u32() % jitter_ns : 0);
+		packet->bytes = c_rtp_header_bytes + frames * rtp_frame_bytes(g_settings.encoding);
+		rtp_write_header(packet->data, g_settings.payload_type, s, ts, ssrc);
+		rtp_encode(g_settings.encoding, samples, frames, packet->data + c_rtp_header_bytes);
+		g_pending[g_npending++] = (int)(packet - g_packets);
+	}
+}
+
+// Send every pending packet that is due in one sendmmsg call; returns the
+// earliest due time still pending, or UINT64_MAX
+static uint64_t send_due(uint64_t now_ns)
+{
+	mmsghdr msgs[c_nslots];
+	iovec iovs[c_nslots];
+	int sending[c_nslots];
+	int nsend = 0;
+	uint64_t next = UINT64_MAX;
+
+	for (int i = 0; i < g_npending; ) {
+		Packet* packet = &g_packets[g_pending[i]];
+		if (packet->due_ns > now_ns) {
+			if (packet->due_ns < next)
+				next = packet->due_ns;
+			++i;
+			continue;
+		}
+
+		iovs[nsend].iov_base = packet->data;
+		iovs[nsend].iov_len = (size_t)packet->bytes;
+		memset(&msgs[nsend], 0, sizeof(mmsghdr));
+		msgs[nsend].msg_hdr.msg_name = &g_addr;
+		msgs[nsend].msg_hdr.msg_namelen = g_addrlen;
+		msgs[nsend].msg_hdr.msg_iov = &iovs[nsend];
+		msgs[nsend].msg_hdr.msg_iovlen = 1;
+		sending[nsend++] = g_pending[i];
+		g_pending[i] = g_pending[--g_npending];
+	}
+
+	TINYAUDIO_TRACE_BEGIN(trace_send);
+	for (int sent = 0; sent < nsend; ) {
+		const int n = sendmmsg(g_fd, msgs + sent, (unsigned)(nsend - sent), 0);
+		if (n > 0)
+			sent += n;
+		else if (errno != EINTR)
+			break; // the network dropped them; the receiver conceals the gap
+	}
+	TINYAUDIO_TRACE_END("send", trace_send);
+
+	for (int i = 0; i < nsend; ++i)
+		g_free[g_nfree++] = sending[i];
+
+	return next;
+}
+
+static void* rtp_thread(void*)
+{
+	sample_type* samples = (sample_type*)pool_block(&g_pool, 0);
+	const int nframes = g_settings.packet_frames * g_settings.burst_packets;
+	const uint64_t period_ns = (uint64_t)nframes * 1000000000ULL / g_sample_rate;
+
+	TINYAUDIO_TRACE_THREAD("tinyaudio rtp");
+	if (g_latency_callback)
+		g_latency_callback(nframes, nframes);
+
+	g_rng = (uint32_t)adaptive_now_ns() | 1;
+	uint16_t seq = (uint16_t)random_u32();
+	uint32_t timestamp = random_u32();
+	const uint32_t ssrc = random_u32();
+
+	// the stream clock: burst k is due k periods after the first
+	uint64_t due = adaptive_now_ns();
+
+	while (g_running) {
+
+		TINYAUDIO_TRACE_BEGIN(trace_callback);
+		g_callback(samples, nframes);
+		TINYAUDIO_TRACE_END("callback", trace_callback);
+		run_output_tap(samples, nframes);
+
+		packetize(samples, &seq, &timestamp, ssrc, due);
+
+		// packets held back by jitter go out between bursts
+		const uint64_t next_burst = due + period_ns;
+		uint64_t next = send_due(adaptive_now_ns());
+		while (next < next_burst && g_running) {
+			sleep_until(next);
+			next = send_due(adaptive_now_ns());
+		}
+
+		due = next_burst;
+		const uint64_t now = adaptive_now_ns();
+		if (now > due + period_ns) {
+			TINYAUDIO_TRACE_MARKER("underrun");
+			due = now;
+		}
+
+		TINYAUDIO_TRACE_BEGIN(trace_wait);
+		sleep_until(due);
+		TINYAUDIO_TRACE_END("wait", trace_wait);
+	}
+
+	return 0;
+}
+
+bool init(int sample_rate, samples_callback callback)
+{
+	g_sample_rate = sample_rate;
+	g_callback = callback;
+
+	if (!rtp_valid_settings(&g_settings)) {
+		g_lasterror = "invalid rtp settings";
+		return false;
+	}
+
+	if (!rtp_resolve(g_settings.address, g_settings.port, false, &g_addr, &g_addrlen)) {
+		g_lasterror = "failed to resolve rtp destination";
+		return false;
+	}
+
+	g_fd = socket(g_addr.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (g_fd < 0) {
+		g_lasterror = "failed to create socket";
+		return false;
+	}
+
+	// DSCP AF41, the class AES67 uses for media
+	const int tos = 34 << 2;
+	if (g_addr.ss_family == AF_INET6)
+		setsockopt(g_fd, IPPROTO_IPV6, IPV6_TCLASS, &tos, sizeof(tos));
+	else
+		setsockopt(g_fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+
+	const int render_bytes = (int)sizeof(sample_type) * 2 * g_settings.packet_frames * g_settings.burst_packets;
+	const int render_blocks = (render_bytes + (int)sizeof(Packet) - 1) / (int)sizeof(Packet);
+	if (!pool_create(&g_pool, sizeof(Packet), render_blocks + c_nslots)) {
+		g_lasterror = "failed to allocate packet buffers";
+		close(g_fd);
+		g_fd = -1;
+		return false;
+	}
+
+	g_packets = (Packet*)pool_block(&g_pool, render_blocks);
+	for (int i = 0; i < c_nslots; ++i)
+		g_free[i] = c_nslots - 1 - i;
+	g_nfree = c_nslots;
+	g_npending = 0;
+
+	g_running = true;
+	pthread_create(&g_thread, NULL, &rtp_thread, NULL);
+	return true;
+}
+
+void release()
+{
+	g_running = false;
+	pthread_join(g_thread, NULL);
+	pool_destroy(&g_pool);
+	close(g_fd);
+	g_fd = -1;
+}
+
+void set_rtp_settings(const rtp_settings* settings)
+{
+	g_settings = *settings;
+}
+
+void set_latency_limits(int /*min_frames*/, int /*max_frames*/)
+{
+}
+
+void set_latency_callback(latency_callback callback)
+{
+	g_latency_callback = callback;
+}
+
+const char* last_error() { return g_lasterror; }
+
+}
@@ -0,0 +1,179 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_RTP_PACKET_H
+#define TINYAUDIO_RTP_PACKET_H
+
+// RTP framing and L16/L24 payload conversion shared by the RTP driver and
+// receiver. Internal.
+
+#include <math.h>
+#include <netdb.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_rtp.h"
+
+namespace tinyaudio {
+
+static const int c_rtp_header_bytes = 12;
+static const int c_rtp_max_packet = 1472; // one unfragmented datagram on ethernet
+
+static inline int rtp_frame_bytes(rtp_encoding encoding)
+{
+	return (encoding == rtp_l24) ? 6 : 4;
+}
+
+static inline bool rtp_valid_settings(const rtp_settings* s)
+{
+	return s->packet_frames > 0 && s->burst_packets > 0
+		&& c_rtp_header_bytes + s->packet_frames * rtp_frame_bytes(s->encoding) <= c_rtp_max_packet
+		&& s->payload_type >= 0 && s->payload_type < 128;
+}
+
+static inline void rtp_write_header(uint8_t* p, int payload_type, uint16_t seq, uint32_t timestamp, uint32_t ssrc)
+{
+	p[0] = 0x80; // version 2, no padding, extension or CSRCs
+	p[1] = (uint8_t)payload_type;
+	p[2] = (uint8_t)(seq >> 8);
+	p[3] = (uint8_t)seq;
+	for (int i = 0; i < 4; ++i) {
+		p[4 + i] = (uint8_t)(timestamp >> (24 - 8 * i));
+		p[8 + i] = (uint8_t)(ssrc >> (24 - 8 * i));
+	}
+}
+
+// Returns the payload length, or -1 if this is not an RTP packet of ours
+static inline int rtp_parse_header(const uint8_t* p, int len, int payload_type, uint32_t* timestamp, const uint8_t** payload)
+{
+	if (len < c_rtp_header_bytes || (p[0] >> 6) != 2 || (p[1] & 0x7f) != payload_type)
+		return -1;
+
+	int offset = c_rtp_header_bytes + 4 * (p[0] & 0x0f);
+	if (p[0] & 0x10) { // header extension
+		if (offset + 4 > len)
+			return -1;
+		offset += 4 + 4 * ((p[offset + 2] << 8) | p[offset + 3]);
+	}
+	if (p[0] & 0x20) // padding
+		len -= p[len - 1];
+	if (offset > len)
+		return -1;
+
+	*timestamp = ((uint32_t)p[4] << 24) | ((uint32_t)p[5] << 16) | ((uint32_t)p[6] << 8) | p[7];
+	*payload = p + offset;
+	return len - offset;
+}
+
+#if TINYAUDIO_FLOAT_BUS
+static inline int32_t rtp_quantize(float v, float scale)
+{
+	v *= scale;
+	if (v > scale - 1.0f)
+		v = scale - 1.0f;
+	else if (v < -scale)
+		v = -scale;
+	return (int32_t)lrintf(v);
+}
+#endif
+
+static inline void rtp_encode(rtp_encoding encoding, const sample_type* in, int nframes, uint8_t* out)
+{
+	const int n = nframes * 2;
+	if (encoding == rtp_l24) {
+		for (int i = 0; i < n; ++i, out += 3) {
+#if TINYAUDIO_FLOAT_BUS
+			const int32_t v = rtp_quantize(in[i], 8388608.0f);
+#else
+			const int32_t v = (int32_t)in[i] * 256;
+#endif
+			out[0] = (uint8_t)(v >> 16);
+			out[1] = (uint8_t)(v >> 8);
+			out[2] = (uint8_t)v;
+		}
+	} else {
+		for (int i = 0; i < n; ++i, out += 2) {
+#if TINYAUDIO_FLOAT_BUS
+			const int32_t v = rtp_quantize(in[i], 32768.0f);
+#else
+			const int32_t v = in[i];
+#endif
+			out[0] = (uint8_t)(v >> 8);
+			out[1] = (uint8_t)v;
+		}
+	}
+}
+
+static inline void rtp_decode(rtp_encoding encoding, const uint8_t* in, int nframes, sample_type* out)
+{
+	const int n = nframes * 2;
+	if (encoding == rtp_l24) {
+		for (int i = 0; i < n; ++i, in += 3) {
+			const int32_t v = (int32_t)(((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8)) >> 8;
+#if TINYAUDIO_FLOAT_BUS
+			out[i] = (float)v * (1.0f / 8388608.0f);
+#else
+			out[i] = (short)(v >> 8);
+#endif
+		}
+	} else {
+		for (int i = 0; i < n; ++i, in += 2) {
+			const int16_t v = (int16_t)((in[0] << 8) | in[1]);
+#if TINYAUDIO_FLOAT_BUS
+			out[i] = (float)v * (1.0f / 32768.0f);
+#else
+			out[i] = v;
+#endif
+		}
+	}
+}
+
+static inline bool rtp_resolve(const char* address, int port, bool passive, sockaddr_storage* addr, socklen_t* addrlen)
+{
+	char service[16];
+	snprintf(service, sizeof(service), "%d", port);
+
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+	hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+	addrinfo* result;
+	if (0 != getaddrinfo(address, service, &hints, &result))
+		return false;
+
+	memcpy(addr, result->ai_addr, result->ai_addrlen);
+	*addrlen = result->ai_addrlen;
+	freeaddrinfo(result);
+	return true;
+}
+
+}
+
+#endif
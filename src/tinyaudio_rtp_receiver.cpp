@@ -0,0 +1,348 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_rtp.h"
+#include "tinyaudio_adaptive.h"
+#include "tinyaudio_rtp_packet.h"
+
+#include <atomic>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+namespace tinyaudio {
+
+// The jitter buffer is a ring of packet slots indexed by RTP timestamp.
+// The network thread decodes each packet into its slot and then stamps
+// the slot with (epoch, timestamp); the audio thread plays a slot only if
+// it carries the stamp it expects, and conceals it with silence otherwise.
+// The network thread never writes within c_nmaxperiod frames of the ring
+// behind the published playout position, so a slot is never rewritten
+// while it is being read.
+//
+// The epoch changes whenever a new SSRC shows up (a sender restart), which
+// invalidates every slot and restarts playout.
+
+static const int c_ring_frames = 32768;
+static const int c_nrecv = 32; // packets per recvmmsg call
+static const float c_jitter_factor = 4.0f;
+static const float c_shrink_seconds = 2.0f; // how slowly the delay comes back down
+
+static rtp_settings g_settings;
+static int g_sample_rate;
+static int g_frame_bytes;
+static int g_nslots;
+static buffer_pool g_pool;
+static std::atomic<uint64_t>* g_stamps; // epoch << 32 | timestamp of the packet in each slot
+static int g_fd = -1;
+static pthread_t g_thread;
+static std::atomic<bool> g_running;
+
+// written by the network thread
+static std::atomic<uint32_t> g_epoch; // 0 until the first packet
+static std::atomic<uint32_t> g_base; // timestamp that maps to slot 0 this epoch
+static std::atomic<uint32_t> g_newest; // end timestamp of the newest packet this epoch
+static std::atomic<float> g_jitter;
+
+// written by the audio thread
+static std::atomic<uint64_t> g_playout; // epoch << 32 | next timestamp to play
+
+// audio thread state
+static uint32_t g_play_epoch;
+static uint32_t g_play;
+static uint32_t g_restart; // timestamp playout (re)starts buffering from
+static bool g_playing;
+static float g_target;
+
+static std::atomic<uint64_t> g_packets;
+static std::atomic<uint64_t> g_lost;
+static std::atomic<uint64_t> g_late;
+static std::atomic<uint64_t> g_underruns;
+static std::atomic<uint64_t> g_skipped;
+static std::atomic<int> g_delay;
+
+static sample_type* slot_frames(int slot)
+{
+	return (sample_type*)pool_block(&g_pool, 0) + 2 * slot * g_settings.packet_frames;
+}
+
+static int slot_of(uint32_t timestamp, uint32_t base)
+{
+	return (int)(((timestamp - base) / (uint32_t)g_settings.packet_frames) % (uint32_t)g_nslots);
+}
+
+static uint64_t stamp(uint32_t epoch, uint32_t timestamp)
+{
+	return ((uint64_t)epoch << 32) | timestamp;
+}
+
+static void receive_packet(const uint8_t* data, int len, uint32_t* ssrc, uint32_t* transit)
+{
+	const int frames = g_settings.packet_frames;
+	uint32_t timestamp = 0;
+	const uint8_t* payload = NULL;
+	if (rtp_parse_header(data, len, g_settings.payload_type, &timestamp, &payload) != frames * g_frame_bytes)
+		return;
+
+	const uint32_t packet_ssrc = ((uint32_t)data[8] << 24) | ((uint32_t)data[9] << 16) | ((uint32_t)data[10] << 8) | data[11];
+	const uint32_t arrival = (uint32_t)(adaptive_now_ns() / 1000 * g_sample_rate / 1000000);
+
+	uint32_t epoch = g_epoch.load(std::memory_order_relaxed);
+	uint32_t base = g_base.load(std::memory_order_relaxed);
+	if (!epoch || packet_ssrc != *ssrc) {
+		*ssrc = packet_ssrc;
+		*transit = arrival - timestamp;
+		base = timestamp;
+		g_base.store(base, std::memory_order_relaxed);
+		g_newest.store(timestamp, std::memory_order_relaxed);
+		g_epoch.store(++epoch, std::memory_order_release);
+	}
+
+	if ((timestamp - base) % (uint32_t)frames)
+		return;
+
+	// RFC 3550 interarrival jitter, in frames
+	const uint32_t packet_transit = arrival - timestamp;
+	const int32_t d = (int32_t)(packet_transit - *transit);
+	*transit = packet_transit;
+	const float jitter = g_jitter.load(std::memory_order_relaxed);
+	g_jitter.store(jitter + ((float)(d < 0 ? -d : d) - jitter) * (1.0f / 16.0f), std::memory_order_relaxed);
+
+	g_packets.fetch_add(1, std::memory_order_relaxed);
+
+	// stay clear of what the audio thread may be reading
+	const uint64_t playout = g_playout.load(std::memory_order_acquire);
+	const uint32_t from = ((uint32_t)(playout >> 32) == epoch) ? (uint32_t)playout : base;
+	const int32_t ahead = (int32_t)(timestamp - from);
+	if (ahead < 0) {
+		g_late.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	if (ahead + frames > c_ring_frames - c_nmaxperiod)
+		return;
+
+	const int slot = slot_of(timestamp, base);
+	rtp_decode(g_settings.encoding, payload, frames, slot_frames(slot));
+	g_stamps[slot].store(stamp(epoch, timestamp), std::memory_order_release);
+
+	const uint32_t end = timestamp + frames;
+	if ((int32_t)(end - g_newest.load(std::memory_order_relaxed)) > 0)
+		g_newest.store(end, std::memory_order_release);
+}
+
+static void* receiver_thread(void*)
+{
+	uint8_t buffers[c_nrecv][c_rtp_max_packet];
+	iovec iovs[c_nrecv];
+	mmsghdr msgs[c_nrecv];
+	uint32_t ssrc = 0;
+	uint32_t transit = 0;
+
+	while (g_running.load(std::memory_order_acquire)) {
+		for (int i = 0; i < c_nrecv; ++i) {
+			iovs[i].iov_base = buffers[i];
+			iovs[i].iov_len = sizeof(buffers[i]);
+			memset(&msgs[i], 0, sizeof(mmsghdr));
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		// blocks for the first packet (or the socket timeout), then takes
+		// whatever else is already queued
+		const int n = recvmmsg(g_fd, msgs, c_nrecv, MSG_WAITFORONE, NULL);
+		for (int i = 0; i < n; ++i)
+			receive_packet(buffers[i], (int)msgs[i].msg_len, &ssrc, &transit);
+	}
+
+	return NULL;
+}
+
+bool rtp_receiver_init(int sample_rate, const rtp_settings* settings)
+{
+	if (!rtp_valid_settings(settings))
+		return false;
+
+	sockaddr_storage addr;
+	socklen_t addrlen;
+	if (!rtp_resolve(settings->address, settings->port, true, &addr, &addrlen))
+		return false;
+
+	g_settings = *settings;
+	g_sample_rate = sample_rate;
+	g_frame_bytes = rtp_frame_bytes(settings->encoding);
+	g_nslots = (c_ring_frames + settings->packet_frames - 1) / settings->packet_frames;
+
+	const size_t ring_bytes = sizeof(sample_type) * 2 * g_nslots * settings->packet_frames;
+	if (!pool_create(&g_pool, ring_bytes + sizeof(std::atomic<uint64_t>) * g_nslots, 1))
+		return false;
+
+	g_stamps = (std::atomic<uint64_t>*)((uint8_t*)pool_block(&g_pool, 0) + ring_bytes);
+	for (int i = 0; i < g_nslots; ++i)
+		g_stamps[i].store(0);
+
+	g_fd = socket(addr.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	const timeval timeout = { 0, 20000 }; // lets the thread notice release
+	const int rcvbuf = 1 << 20;
+	if (g_fd < 0 || 0 != bind(g_fd, (const sockaddr*)&addr, addrlen)) {
+		if (g_fd >= 0)
+			close(g_fd);
+		g_fd = -1;
+		pool_destroy(&g_pool);
+		return false;
+	}
+	setsockopt(g_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(g_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	g_epoch.store(0);
+	g_base.store(0);
+	g_newest.store(0);
+	g_jitter.store(0.0f);
+	g_playout.store(0);
+	g_play_epoch = 0;
+	g_playing = false;
+	g_target = (float)settings->min_delay_frames;
+	g_packets.store(0);
+	g_lost.store(0);
+	g_late.store(0);
+	g_underruns.store(0);
+	g_skipped.store(0);
+	g_delay.store(settings->min_delay_frames);
+
+	g_running.store(true);
+	pthread_create(&g_thread, NULL, &receiver_thread, NULL);
+	return true;
+}
+
+void rtp_receiver_release()
+{
+	g_running.store(false, std::memory_order_release);
+	pthread_join(g_thread, NULL);
+	close(g_fd);
+	g_fd = -1;
+	pool_destroy(&g_pool);
+}
+
+// Delay grows at once when jitter rises and eases back down over a few seconds
+static int update_target(int nsamples)
+{
+	const int frames = g_settings.packet_frames;
+	float goal = nsamples + 2.0f * frames + c_jitter_factor * g_jitter.load(std::memory_order_relaxed);
+	if (goal < g_settings.min_delay_frames)
+		goal = (float)g_settings.min_delay_frames;
+	const float max_delay = (float)(c_ring_frames - c_nmaxperiod - 2 * frames);
+	if (goal > max_delay)
+		goal = max_delay;
+
+	if (goal > g_target)
+		g_target = goal;
+	else
+		g_target += (goal - g_target) * (nsamples / (c_shrink_seconds * g_sample_rate));
+
+	const int target = (int)g_target;
+	g_delay.store(target, std::memory_order_relaxed);
+	return target;
+}
+
+void rtp_receiver_render(sample_type* samples, int nsamples)
+{
+	const uint32_t epoch = g_epoch.load(std::memory_order_acquire);
+	const uint32_t base = g_base.load(std::memory_order_relaxed);
+	const uint32_t newest = g_newest.load(std::memory_order_acquire);
+	const int target = update_target(nsamples);
+
+	if (epoch != g_play_epoch) {
+		g_play_epoch = epoch;
+		g_playing = false;
+		g_restart = base;
+	}
+
+	if (!g_playing && epoch && (int32_t)(newest - g_restart) >= target) {
+		g_play = newest - (uint32_t)target;
+		g_playing = true;
+	}
+
+	if (g_playing) {
+		const int32_t depth = (int32_t)(newest - g_play);
+		const int32_t slack = (target / 2 > 2 * g_settings.packet_frames) ? target / 2 : 2 * g_settings.packet_frames;
+		if (depth < nsamples) {
+			// ran dry: buffer up to the target again before resuming
+			g_underruns.fetch_add(1, std::memory_order_relaxed);
+			g_playing = false;
+			g_restart = newest;
+		} else if (depth > target + slack) {
+			// the sender's clock is ahead of ours, or a burst of delay has passed
+			g_skipped.fetch_add((uint64_t)(depth - target), std::memory_order_relaxed);
+			g_play = newest - (uint32_t)target;
+		}
+	}
+
+	if (!g_playing) {
+		memset(samples, 0, sizeof(sample_type) * 2 * nsamples);
+		return;
+	}
+
+	const uint32_t frames = (uint32_t)g_settings.packet_frames;
+	uint32_t pos = g_play;
+	g_playout.store(stamp(epoch, pos), std::memory_order_release);
+
+	for (int remaining = nsamples; remaining; ) {
+		const uint32_t offset = (pos - base) % frames;
+		int n = (int)(frames - offset);
+		if (n > remaining)
+			n = remaining;
+
+		const int slot = slot_of(pos, base);
+		if (g_stamps[slot].load(std::memory_order_acquire) == stamp(epoch, pos - offset)) {
+			memcpy(samples, slot_frames(slot) + 2 * offset, sizeof(sample_type) * 2 * n);
+		} else {
+			memset(samples, 0, sizeof(sample_type) * 2 * n);
+			if (!offset)
+				g_lost.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		samples += 2 * n;
+		remaining -= n;
+		pos += (uint32_t)n;
+	}
+
+	g_play = pos;
+	g_playout.store(stamp(epoch, pos), std::memory_order_release);
+}
+
+void rtp_receiver_read_stats(rtp_receiver_stats* stats)
+{
+	stats->packets = g_packets.load(std::memory_order_relaxed);
+	stats->lost_packets = g_lost.load(std::memory_order_relaxed);
+	stats->late_packets = g_late.load(std::memory_order_relaxed);
+	stats->underruns = g_underruns.load(std::memory_order_relaxed);
+	stats->skipped_frames = g_skipped.load(std::memory_order_relaxed);
+	stats->jitter_frames = g_jitter.load(std::memory_order_relaxed);
+	stats->delay_frames = g_delay.load(std::memory_order_relaxed);
+}
+
+}
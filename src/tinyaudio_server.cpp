@@ -0,0 +1,402 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_server.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+#include "tinyaudio_adaptive.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+namespace tinyaudio {
+
+static const int c_nmaxstreams = 16384;
+static const int c_nmaxthreads = 64;
+static const int c_resync_periods = 4; // how far behind a stream may fall
+
+enum StreamState {
+	stream_free,
+	stream_active,
+	stream_closing,
+};
+
+struct StreamHeap;
+
+struct ServerStream {
+	stream_render render;
+	void* context;
+	int sample_rate;
+	int period_frames;
+	uint64_t period_ns;
+	uint64_t start_ns; // clock origin
+	uint64_t frames; // rendered since start_ns
+	uint64_t release_ns; // of the next period
+	uint64_t deadline_ns;
+	StreamState state;
+	bool running;
+	StreamHeap* heap; // the heap it waits in, if not running
+	int heap_pos;
+	server_stream_stats stats;
+};
+
+// Binary min-heap of stream indices, keyed by release or deadline
+struct StreamHeap {
+	int items[c_nmaxstreams];
+	int size;
+	bool by_deadline;
+};
+
+static ServerStream g_streams[c_nmaxstreams];
+static int g_free[c_nmaxstreams];
+static int g_nfree;
+static StreamHeap g_pending; // waiting for their release, by release
+static StreamHeap g_ready; // released, by deadline
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_wake; // work may be ready
+static pthread_cond_t g_closed; // a running period finished on a closing stream
+static uint64_t g_timed_until; // earliest time a worker is already waiting for
+static pthread_t g_threads[c_nmaxthreads];
+static int g_nthreads;
+static bool g_running;
+static buffer_pool g_pool; // one render block per worker
+
+static inline uint64_t heap_key(const StreamHeap* h, int index)
+{
+	return h->by_deadline ? g_streams[index].deadline_ns : g_streams[index].release_ns;
+}
+
+static inline void heap_set(StreamHeap* h, int pos, int index)
+{
+	h->items[pos] = index;
+	g_streams[index].heap = h;
+	g_streams[index].heap_pos = pos;
+}
+
+static void heap_sift_up(StreamHeap* h, int pos, int index)
+{
+	const uint64_t key = heap_key(h, index);
+	while (pos > 0) {
+		const int parent = (pos - 1) / 2;
+		if (heap_key(h, h->items[parent]) <= key)
+			break;
+		heap_set(h, pos, h->items[parent]);
+		pos = parent;
+	}
+	heap_set(h, pos, index);
+}
+
+static void heap_sift_down(StreamHeap* h, int pos, int index)
+{
+	const uint64_t key = heap_key(h, index);
+	for (;;) {
+		int child = pos * 2 + 1;
+		if (child >= h->size)
+			break;
+		if (child + 1 < h->size && heap_key(h, h->items[child + 1]) < heap_key(h, h->items[child]))
+			++child;
+		if (key <= heap_key(h, h->items[child]))
+			break;
+		heap_set(h, pos, h->items[child]);
+		pos = child;
+	}
+	heap_set(h, pos, index);
+}
+
+static void heap_push(StreamHeap* h, int index)
+{
+	heap_sift_up(h, h->size++, index);
+}
+
+static void heap_remove(StreamHeap* h, int pos)
+{
+	g_streams[h->items[pos]].heap = NULL;
+
+	const int last = h->items[--h->size];
+	if (pos == h->size)
+		return;
+	if (pos > 0 && heap_key(h, last) < heap_key(h, h->items[(pos - 1) / 2]))
+		heap_sift_up(h, pos, last);
+	else
+		heap_sift_down(h, pos, last);
+}
+
+static int heap_pop(StreamHeap* h)
+{
+	const int top = h->items[0];
+	heap_remove(h, 0);
+	return top;
+}
+
+// Clock time of the stream's frame count, without overflowing on long runs
+static uint64_t stream_time_ns(const ServerStream* s)
+{
+	const uint64_t rate = (uint64_t)s->sample_rate;
+	return s->start_ns + (s->frames / rate) * 1000000000ULL + (s->frames % rate) * 1000000000ULL / rate;
+}
+
+static void free_stream(int index)
+{
+	g_streams[index].state = stream_free;
+	g_free[g_nfree++] = index;
+}
+
+// With the lock held: account for a finished period and queue the next one
+static void finish_period(int index, uint64_t start, uint64_t end)
+{
+	ServerStream* s = &g_streams[index];
+
+	s->stats.periods += 1;
+	s->stats.frames += s->period_frames;
+	s->stats.render_ns += end - start;
+	if (end > s->deadline_ns) {
+		s->stats.deadline_misses += 1;
+		if (end - s->deadline_ns > s->stats.max_lateness_ns)
+			s->stats.max_lateness_ns = end - s->deadline_ns;
+	}
+
+	if (s->state == stream_closing) {
+		free_stream(index);
+		pthread_cond_broadcast(&g_closed);
+		return;
+	}
+
+	s->frames += s->period_frames;
+	uint64_t release = stream_time_ns(s);
+	if (end > release + c_resync_periods * s->period_ns) {
+		TINYAUDIO_TRACE_MARKER("stream resync");
+		s->start_ns = end;
+		s->frames = 0;
+		s->stats.resyncs += 1;
+		release = end;
+	}
+
+	s->release_ns = release;
+	s->deadline_ns = release + s->period_ns;
+	heap_push(&g_pending, index);
+}
+
+// With the lock held and nothing ready: sleep until the next release, unless
+// another worker already wakes for it
+static void wait_for_work()
+{
+	if (!g_pending.size) {
+		pthread_cond_wait(&g_wake, &g_lock);
+		return;
+	}
+
+	const uint64_t release = g_streams[g_pending.items[0]].release_ns;
+	if (release >= g_timed_until) {
+		pthread_cond_wait(&g_wake, &g_lock);
+		return;
+	}
+
+	g_timed_until = release;
+	timespec ts;
+	ts.tv_sec = (time_t)(release / 1000000000ULL);
+	ts.tv_nsec = (long)(release % 1000000000ULL);
+	pthread_cond_timedwait(&g_wake, &g_lock, &ts);
+	if (g_timed_until == release)
+		g_timed_until = UINT64_MAX;
+}
+
+static void* server_worker(void* context)
+{
+	const int self = (int)(intptr_t)context;
+	sample_type* samples = (sample_type*)pool_block(&g_pool, self);
+
+	TINYAUDIO_TRACE_THREAD("tinyaudio server worker");
+
+	pthread_mutex_lock(&g_lock);
+	while (g_running) {
+
+		const uint64_t now = adaptive_now_ns();
+		while (g_pending.size && g_streams[g_pending.items[0]].release_ns <= now)
+			heap_push(&g_ready, heap_pop(&g_pending));
+
+		if (!g_ready.size) {
+			wait_for_work();
+			continue;
+		}
+
+		const int index = heap_pop(&g_ready);
+
+		// hand what is left, and the timer for the next release, to
+		// another worker
+		if (g_ready.size || (g_pending.size && g_timed_until == UINT64_MAX))
+			pthread_cond_signal(&g_wake);
+
+		ServerStream* s = &g_streams[index];
+		s->running = true;
+		pthread_mutex_unlock(&g_lock);
+
+		const uint64_t start = adaptive_now_ns();
+		TINYAUDIO_TRACE_BEGIN(trace_render);
+		s->render(s->context, samples, s->period_frames);
+		TINYAUDIO_TRACE_END("stream", trace_render);
+		const uint64_t end = adaptive_now_ns();
+
+		pthread_mutex_lock(&g_lock);
+		s->running = false;
+		finish_period(index, start, end);
+	}
+	pthread_mutex_unlock(&g_lock);
+
+	return 0;
+}
+
+bool server_init(int nthreads, int max_streams)
+{
+	if (nthreads <= 0)
+		nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (nthreads < 1)
+		nthreads = 1;
+	else if (nthreads > c_nmaxthreads)
+		nthreads = c_nmaxthreads;
+	if (max_streams < 1 || max_streams > c_nmaxstreams)
+		return false;
+
+	if (!pool_create(&g_pool, sizeof(sample_type) * 2 * c_nmaxperiod, nthreads))
+		return false;
+
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&g_wake, &attr);
+	pthread_cond_init(&g_closed, NULL);
+	pthread_condattr_destroy(&attr);
+
+	// hand out low indices first
+	g_nfree = 0;
+	for (int ii = max_streams - 1; ii >= 0; --ii) {
+		g_streams[ii].state = stream_free;
+		g_free[g_nfree++] = ii;
+	}
+
+	g_pending.size = 0;
+	g_pending.by_deadline = false;
+	g_ready.size = 0;
+	g_ready.by_deadline = true;
+	g_timed_until = UINT64_MAX;
+
+	g_nthreads = nthreads;
+	g_running = true;
+	for (int ii = 0; ii < nthreads; ++ii)
+		pthread_create(&g_threads[ii], NULL, &server_worker, (void*)(intptr_t)ii);
+
+	return true;
+}
+
+void server_release()
+{
+	pthread_mutex_lock(&g_lock);
+	g_running = false;
+	pthread_cond_broadcast(&g_wake);
+	pthread_mutex_unlock(&g_lock);
+
+	for (int ii = 0; ii < g_nthreads; ++ii)
+		pthread_join(g_threads[ii], NULL);
+	g_nthreads = 0;
+
+	pthread_cond_destroy(&g_wake);
+	pthread_cond_destroy(&g_closed);
+	pool_destroy(&g_pool);
+}
+
+server_stream server_open(int sample_rate, int period_frames, stream_render render, void* context)
+{
+	if (sample_rate <= 0 || period_frames < 1 || period_frames > c_nmaxperiod || !render)
+		return -1;
+
+	pthread_mutex_lock(&g_lock);
+	if (!g_nfree) {
+		pthread_mutex_unlock(&g_lock);
+		return -1;
+	}
+
+	const int index = g_free[--g_nfree];
+	ServerStream* s = &g_streams[index];
+	memset(s, 0, sizeof(*s));
+	s->render = render;
+	s->context = context;
+	s->sample_rate = sample_rate;
+	s->period_frames = period_frames;
+	s->period_ns = (uint64_t)period_frames * 1000000000ULL / (uint64_t)sample_rate;
+	s->start_ns = adaptive_now_ns();
+	s->release_ns = s->start_ns;
+	s->deadline_ns = s->start_ns + s->period_ns;
+	s->state = stream_active;
+
+	heap_push(&g_pending, index);
+	pthread_cond_broadcast(&g_wake);
+	pthread_mutex_unlock(&g_lock);
+	return index;
+}
+
+void server_close(server_stream stream)
+{
+	if (stream < 0 || stream >= c_nmaxstreams)
+		return;
+
+	pthread_mutex_lock(&g_lock);
+	ServerStream* s = &g_streams[stream];
+	if (s->state == stream_active) {
+		if (s->running) {
+			s->state = stream_closing;
+			while (s->running)
+				pthread_cond_wait(&g_closed, &g_lock);
+		} else {
+			heap_remove(s->heap, s->heap_pos);
+			free_stream(stream);
+		}
+	}
+	pthread_mutex_unlock(&g_lock);
+}
+
+bool server_read_stats(server_stream stream, server_stream_stats* stats)
+{
+	if (stream < 0 || stream >= c_nmaxstreams)
+		return false;
+
+	pthread_mutex_lock(&g_lock);
+	const bool active = (g_streams[stream].state == stream_active);
+	if (active)
+		*stats = g_streams[stream].stats;
+	pthread_mutex_unlock(&g_lock);
+	return active;
+}
+
+int server_threads()
+{
+	return g_nthreads;
+}
+
+}
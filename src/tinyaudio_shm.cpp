@@ -0,0 +1,220 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_latency.h"
+#include "TINYAUDIO/tinyaudio_shm.h"
+#include "TINYAUDIO/tinyaudio_tap.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+#include "tinyaudio_adaptive.h"
+#include "tinyaudio_shm_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace tinyaudio {
+
+static const int c_wait_ms = 100; // lets the thread notice release without a host
+
+static samples_callback g_callback;
+static pthread_t g_thread;
+static volatile bool g_running;
+static int g_sample_rate;
+static latency_callback g_latency_callback;
+static const char* g_lasterror = "";
+
+static int g_period_frames = 256;
+static int g_nperiods = 3;
+static int g_memfd = -1;
+static int g_eventfd = -1;
+static ShmRing* g_ring;
+static size_t g_ring_bytes;
+
+// Sleep until the host frees a period. The flag is set before the final
+// check of read_pos and the host stores read_pos before checking the flag,
+// so one of the two always sees the other.
+static void wait_for_space(uint64_t write_pos, uint64_t capacity)
+{
+	g_ring->waiting.store(1);
+	if (write_pos - g_ring->read_pos.load() + g_period_frames > capacity) {
+		pollfd pfd = { g_eventfd, POLLIN, 0 };
+		if (poll(&pfd, 1, c_wait_ms) > 0) {
+			uint64_t count;
+			while (read(g_eventfd, &count, sizeof(count)) < 0 && errno == EINTR)
+				;
+		}
+	}
+	g_ring->waiting.store(0, std::memory_order_relaxed);
+}
+
+static void* shm_thread(void*)
+{
+	sample_type* data = shm_ring_data(g_ring);
+	const uint64_t capacity = (uint64_t)g_period_frames * g_nperiods;
+
+	TINYAUDIO_TRACE_THREAD("tinyaudio shm");
+	if (g_latency_callback)
+		g_latency_callback(g_period_frames, (int)capacity);
+
+	while (g_running) {
+		const uint64_t write_pos = g_ring->write_pos.load(std::memory_order_relaxed);
+		if (write_pos - g_ring->read_pos.load(std::memory_order_acquire) + g_period_frames > capacity) {
+			TINYAUDIO_TRACE_BEGIN(trace_wait);
+			wait_for_space(write_pos, capacity);
+			TINYAUDIO_TRACE_END("wait", trace_wait);
+			continue;
+		}
+
+		sample_type* samples = data + 2 * (write_pos % capacity);
+		TINYAUDIO_TRACE_BEGIN(trace_callback);
+		g_callback(samples, g_period_frames);
+		TINYAUDIO_TRACE_END("callback", trace_callback);
+		run_output_tap(samples, g_period_frames);
+
+		g_ring->write_pos.store(write_pos + g_period_frames, std::memory_order_release);
+	}
+
+	return 0;
+}
+
+bool init(int sample_rate, samples_callback callback)
+{
+	g_sample_rate = sample_rate;
+	g_callback = callback;
+
+	if (g_period_frames <= 0 || g_period_frames > c_nmaxperiod || g_nperiods < 2) {
+		g_lasterror = "invalid shm buffer geometry";
+		return false;
+	}
+
+	g_ring_bytes = shm_ring_bytes(g_period_frames, g_nperiods);
+	// sealed at its size so the host's mapping can never be cut short
+	g_memfd = memfd_create("tinyaudio", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (g_memfd < 0 || 0 != ftruncate(g_memfd, (off_t)g_ring_bytes)
+		|| 0 != fcntl(g_memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)) {
+		g_lasterror = "failed to create shared memory";
+		release();
+		return false;
+	}
+
+	g_eventfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	g_ring = shm_map(g_memfd, g_ring_bytes);
+	if (g_eventfd < 0 || !g_ring) {
+		g_lasterror = "failed to map shared memory";
+		release();
+		return false;
+	}
+
+	g_ring->magic = c_shm_magic;
+	g_ring->version = c_shm_version;
+	g_ring->sample_rate = sample_rate;
+	g_ring->sample_bytes = (int32_t)sizeof(sample_type);
+	g_ring->period_frames = g_period_frames;
+	g_ring->nperiods = g_nperiods;
+	g_ring->write_pos.store(0);
+	g_ring->read_pos.store(0);
+	g_ring->waiting.store(0);
+
+	g_running = true;
+	pthread_create(&g_thread, NULL, &shm_thread, NULL);
+	return true;
+}
+
+void release()
+{
+	if (g_running) {
+		g_running = false;
+		pthread_join(g_thread, NULL);
+	}
+
+	if (g_ring)
+		shm_unmap(g_ring, g_ring_bytes);
+	if (g_eventfd >= 0)
+		close(g_eventfd);
+	if (g_memfd >= 0)
+		close(g_memfd);
+
+	g_ring = NULL;
+	g_eventfd = -1;
+	g_memfd = -1;
+}
+
+void set_shm_buffer(int period_frames, int nperiods)
+{
+	g_period_frames = period_frames;
+	g_nperiods = nperiods;
+}
+
+int shm_memfd() { return g_memfd; }
+int shm_eventfd() { return g_eventfd; }
+
+bool shm_send(int socket, int memfd, int eventfd)
+{
+	const int fds[2] = { memfd, eventfd };
+	char byte = 0;
+	iovec iov = { &byte, 1 };
+
+	union {
+		cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(fds))];
+	} control;
+	memset(&control, 0, sizeof(control));
+
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+
+	cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+	ssize_t n;
+	while ((n = sendmsg(socket, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+		;
+	return n == 1;
+}
+
+void set_latency_limits(int /*min_frames*/, int /*max_frames*/)
+{
+}
+
+void set_latency_callback(latency_callback callback)
+{
+	g_latency_callback = callback;
+}
+
+const char* last_error() { return g_lasterror; }
+
+}
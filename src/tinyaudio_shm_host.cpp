@@ -0,0 +1,216 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_shm.h"
+#include "tinyaudio_shm_ring.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tinyaudio {
+
+// The audio thread reads through g_current; attach fills the other slot,
+// switches g_current and waits for the audio thread to leave the old ring
+// before unmapping it (same handoff as set_output_tap).
+
+struct HostRing {
+	ShmRing* ring;
+	size_t bytes;
+	int memfd;
+	int eventfd;
+	uint64_t capacity;
+	uint64_t read_pos; // our own copy; the renderer can't move it
+	bool started;
+};
+
+static HostRing g_rings[2];
+static std::atomic<int> g_current(-1);
+static std::atomic<int> g_busy;
+static std::atomic<uint64_t> g_underruns;
+
+static void close_ring(HostRing* h)
+{
+	if (h->ring)
+		shm_unmap(h->ring, h->bytes);
+	if (h->memfd >= 0)
+		close(h->memfd);
+	if (h->eventfd >= 0)
+		close(h->eventfd);
+	memset(h, 0, sizeof(*h));
+	h->memfd = -1;
+	h->eventfd = -1;
+}
+
+static void switch_ring(int next)
+{
+	const int previous = g_current.exchange(next);
+	while (g_busy.load())
+		sched_yield();
+
+	if (previous >= 0)
+		close_ring(&g_rings[previous]);
+}
+
+bool shm_host_attach(int memfd, int eventfd, int sample_rate)
+{
+	const int next = (g_current.load() == 0) ? 1 : 0;
+	HostRing* h = &g_rings[next];
+	memset(h, 0, sizeof(*h));
+	h->memfd = memfd;
+	h->eventfd = eventfd;
+
+	// the renderer is untrusted: check the header against the real size
+	// once (the memfd must be sealed against shrinking), and keep our own
+	// copies of everything the audio thread needs
+	struct stat st;
+	if (0 != fstat(memfd, &st) || (size_t)st.st_size < shm_ring_bytes(1, 2)
+		|| !(fcntl(memfd, F_GET_SEALS) & F_SEAL_SHRINK)) {
+		close_ring(h);
+		return false;
+	}
+
+	h->bytes = (size_t)st.st_size;
+	h->ring = shm_map(memfd, h->bytes);
+	const ShmRing* r = h->ring;
+	if (!r || r->magic != c_shm_magic || r->version != c_shm_version
+		|| r->sample_rate != sample_rate || r->sample_bytes != (int32_t)sizeof(sample_type)
+		|| r->period_frames <= 0 || r->nperiods < 2
+		|| r->period_frames > (1 << 20) / r->nperiods
+		|| shm_ring_bytes(r->period_frames, r->nperiods) > h->bytes) {
+		close_ring(h);
+		return false;
+	}
+
+	h->capacity = (uint64_t)r->period_frames * r->nperiods;
+	h->read_pos = h->ring->read_pos.load();
+	switch_ring(next);
+	return true;
+}
+
+void shm_host_detach()
+{
+	switch_ring(-1);
+}
+
+void shm_host_render(sample_type* samples, int nsamples)
+{
+	g_busy.fetch_add(1);
+	const int current = g_current.load();
+	if (current < 0) {
+		g_busy.fetch_sub(1);
+		memset(samples, 0, sizeof(sample_type) * 2 * nsamples);
+		return;
+	}
+
+	HostRing* h = &g_rings[current];
+	const sample_type* data = shm_ring_data(h->ring);
+	uint64_t available = h->ring->write_pos.load(std::memory_order_acquire) - h->read_pos;
+	if (available > h->capacity) {
+		// a confused or hostile renderer; start over from where it claims to be
+		h->read_pos += available;
+		available = 0;
+	}
+
+	int take = (available < (uint64_t)nsamples) ? (int)available : nsamples;
+	const int copied = take;
+	while (take) {
+		const uint64_t at = h->read_pos % h->capacity;
+		int n = (int)(h->capacity - at);
+		if (n > take)
+			n = take;
+
+		memcpy(samples, data + 2 * at, sizeof(sample_type) * 2 * n);
+		samples += 2 * n;
+		take -= n;
+		h->read_pos += (uint64_t)n;
+	}
+
+	if (copied < nsamples) {
+		memset(samples, 0, sizeof(sample_type) * 2 * (nsamples - copied));
+		if (h->started)
+			g_underruns.fetch_add(1, std::memory_order_relaxed);
+	}
+	h->started = h->started || copied;
+
+	// read_pos before the flag; see wait_for_space in tinyaudio_shm.cpp
+	h->ring->read_pos.store(h->read_pos);
+	if (copied && h->ring->waiting.load()) {
+		const uint64_t one = 1;
+		while (write(h->eventfd, &one, sizeof(one)) < 0 && errno == EINTR)
+			;
+	}
+
+	g_busy.fetch_sub(1);
+}
+
+uint64_t shm_host_underruns()
+{
+	return g_underruns.load(std::memory_order_relaxed);
+}
+
+bool shm_receive(int socket, int* memfd, int* eventfd)
+{
+	int fds[2];
+	char byte;
+	iovec iov = { &byte, 1 };
+
+	union {
+		cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(fds))];
+	} control;
+
+	msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+
+	ssize_t n;
+	while ((n = recvmsg(socket, &msg, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+		;
+
+	const cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+	if (n != 1 || !cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+		if (cmsg && cmsg->cmsg_type == SCM_RIGHTS) {
+			const int count = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+			for (int i = 0; i < count; ++i)
+				close(((const int*)CMSG_DATA(cmsg))[i]);
+		}
+		return false;
+	}
+
+	memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+	*memfd = fds[0];
+	*eventfd = fds[1];
+	return true;
+}
+
+}
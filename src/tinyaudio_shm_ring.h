@@ -0,0 +1,96 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef TINYAUDIO_SHM_RING_H
+#define TINYAUDIO_SHM_RING_H
+
+// Layout of the shared ring between the shm driver and the shm host, and
+// the descriptor passing both sides use. Positions are in frames and only
+// ever grow; the ring holds nperiods whole periods, so a period never
+// wraps. Internal.
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+
+namespace tinyaudio {
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared ring positions must be lock-free across processes");
+
+static const uint32_t c_shm_magic = 0x4d534154; // "TASM"
+static const uint32_t c_shm_version = 1;
+static const size_t c_shm_data_offset = 4096;
+
+struct ShmRing {
+	// written once by the renderer before the ring is shared
+	uint32_t magic;
+	uint32_t version;
+	int32_t sample_rate;
+	int32_t sample_bytes;
+	int32_t period_frames;
+	int32_t nperiods;
+
+	alignas(64) std::atomic<uint64_t> write_pos; // renderer
+	alignas(64) std::atomic<uint64_t> read_pos; // host
+	alignas(64) std::atomic<uint32_t> waiting; // renderer is asleep on the doorbell
+};
+
+static inline size_t shm_ring_bytes(int period_frames, int nperiods)
+{
+	const size_t bytes = c_shm_data_offset + sizeof(sample_type) * 2 * (size_t)period_frames * nperiods;
+	return (bytes + 4095) & ~(size_t)4095;
+}
+
+static inline sample_type* shm_ring_data(ShmRing* ring)
+{
+	return (sample_type*)((uint8_t*)ring + c_shm_data_offset);
+}
+
+// Maps, pre-faults and (unless buffer_no_lock is set) locks the ring
+static inline ShmRing* shm_map(int fd, size_t bytes)
+{
+	void* ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+
+	if (!(memory_settings()->flags & buffer_no_lock))
+		mlock(ptr, bytes);
+	return (ShmRing*)ptr;
+}
+
+static inline void shm_unmap(ShmRing* ring, size_t bytes)
+{
+	munlock(ring, bytes);
+	munmap(ring, bytes);
+}
+
+}
+
+#endif
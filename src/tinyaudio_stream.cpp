@@ -0,0 +1,621 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_stream.h"
+#include "tinyaudio_kernels.h"
+
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <new>
+#include <pthread.h>
+#include <semaphore.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace tinyaudio {
+
+// Positions are published together with a generation number that changes on
+// every seek and loop wrap, so a stale read-ahead window is never mistaken
+// for the current one.
+static const int c_ngenshift = 40;
+static const uint64_t c_framemask = (uint64_t(1) << c_ngenshift) - 1;
+static const unsigned c_genmask = (1u << (64 - c_ngenshift)) - 1;
+static const int c_nconvert = 256; // frames converted per pass
+static const long c_idle_ns = 50 * 1000 * 1000;
+
+struct stream {
+	const uint8_t* map;
+	size_t map_bytes;
+	size_t data_offset;
+	uint64_t nframes;
+	int channels;
+	stream_sample format;
+	int frame_bytes;
+	int sample_rate;
+	uint64_t readahead;
+
+	// audio thread
+	uint64_t pos;
+	unsigned gen;
+	unsigned seeks_seen;
+	uint64_t seek_end_frame; // end of the window prefetched for the last seek
+
+	// shared
+	std::atomic<uint64_t> cursor; // gen|pos, written by the audio thread
+	std::atomic<uint64_t> resident; // gen|end, written by the prefetch thread
+	std::atomic<uint64_t> head_frames; // frames resident from the start of the data
+	std::atomic<uint64_t> seek_target;
+	std::atomic<uint64_t> seek_ready; // seeks|target, target is resident
+	std::atomic<unsigned> seeks;
+	std::atomic<unsigned> seeks_applied;
+	std::atomic<unsigned> starved;
+	std::atomic<bool> loop;
+	std::atomic<bool> running;
+	sem_t wake;
+	pthread_t thread;
+
+	// prefetch thread
+	size_t lock_begin, lock_end;
+	size_t head_end;
+	size_t seek_begin, seek_end;
+	unsigned seeks_done;
+	bool seek_pending;
+	bool can_lock;
+};
+
+static size_t page_size()
+{
+	static const size_t size = (size_t)sysconf(_SC_PAGESIZE);
+	return size;
+}
+
+static size_t page_floor(size_t offset)
+{
+	return offset & ~(page_size() - 1);
+}
+
+static size_t page_ceil(size_t offset)
+{
+	return (offset + page_size() - 1) & ~(page_size() - 1);
+}
+
+static size_t frame_offset(const stream* s, uint64_t frame)
+{
+	return s->data_offset + (size_t)frame * s->frame_bytes;
+}
+
+static uint64_t pack(unsigned gen, uint64_t frame)
+{
+	return (uint64_t(gen & c_genmask) << c_ngenshift) | (frame & c_framemask);
+}
+
+static void bring_in(stream* s, size_t lo, size_t hi)
+{
+	if (lo >= hi)
+		return;
+
+	madvise((void*)(s->map + lo), hi - lo, MADV_WILLNEED);
+
+	if (s->can_lock && 0 == mlock(s->map + lo, hi - lo))
+		return;
+
+	// no lock budget: fault the pages in here instead, they just may get
+	// evicted again under memory pressure
+	s->can_lock = false;
+	volatile uint8_t sink = 0;
+	for (size_t off = lo; off < hi; off += page_size())
+		sink ^= s->map[off];
+	(void)sink;
+}
+
+static void let_go(stream* s, size_t lo, size_t hi)
+{
+	if (lo < s->head_end)
+		lo = s->head_end;
+	if (lo >= hi || !s->can_lock)
+		return;
+
+	munlock(s->map + lo, hi - lo);
+}
+
+// Byte range of the read-ahead window starting at `frame`
+static void window(const stream* s, uint64_t frame, size_t* begin, size_t* end, uint64_t* end_frame)
+{
+	*end_frame = frame + s->readahead;
+	if (*end_frame > s->nframes)
+		*end_frame = s->nframes;
+
+	*begin = page_floor(frame_offset(s, frame));
+	*end = page_ceil(frame_offset(s, *end_frame));
+	if (*end > s->map_bytes)
+		*end = s->map_bytes;
+}
+
+static void prefetch(stream* s)
+{
+	if (s->loop.load(std::memory_order_relaxed) && !s->head_end) {
+		const uint64_t frames = (s->readahead < s->nframes) ? s->readahead : s->nframes;
+		const size_t end = page_ceil(frame_offset(s, frames));
+		bring_in(s, page_floor(s->data_offset), end);
+		s->head_end = end;
+		s->head_frames.store(frames, std::memory_order_release);
+	}
+
+	size_t begin, end;
+	uint64_t end_frame;
+
+	// A seek is handed to the audio thread only once its target is resident;
+	// until then the old window stays locked too.
+	const unsigned seeks = s->seeks.load(std::memory_order_acquire) & c_genmask;
+	if (seeks != s->seeks_done) {
+		uint64_t target = s->seek_target.load(std::memory_order_relaxed);
+		if (target > s->nframes)
+			target = s->nframes;
+
+		if (s->seek_pending) {
+			let_go(s, s->seek_begin, s->seek_end);
+			bring_in(s, s->lock_begin, s->lock_end);
+		}
+
+		window(s, target, &s->seek_begin, &s->seek_end, &end_frame);
+		bring_in(s, s->seek_begin, s->seek_end);
+		s->seek_pending = true;
+		s->seeks_done = seeks;
+		s->seek_ready.store(pack(seeks, target), std::memory_order_release);
+	}
+
+	const uint64_t cursor = s->cursor.load(std::memory_order_acquire);
+	const unsigned gen = (unsigned)(cursor >> c_ngenshift);
+	const uint64_t pos = cursor & c_framemask;
+
+	if (s->seek_pending) {
+		if (s->seeks_applied.load(std::memory_order_relaxed) != s->seeks_done)
+			return;
+
+		// the seek window becomes the current one
+		let_go(s, s->lock_begin, s->lock_end);
+		bring_in(s, s->seek_begin, s->seek_end);
+		s->lock_begin = s->seek_begin;
+		s->lock_end = s->seek_end;
+		s->seek_pending = false;
+	}
+
+	window(s, pos, &begin, &end, &end_frame);
+
+	// move the window: release what fell out of it, bring in what is new
+	const size_t ob = s->lock_begin, oe = s->lock_end;
+	if (end <= ob || begin >= oe) {
+		let_go(s, ob, oe);
+		bring_in(s, begin, end);
+	} else {
+		let_go(s, ob, begin);
+		let_go(s, end, oe);
+		bring_in(s, begin, ob);
+		bring_in(s, oe, end);
+	}
+
+	s->lock_begin = begin;
+	s->lock_end = end;
+	s->resident.store(pack(gen, end_frame), std::memory_order_release);
+}
+
+static void* prefetch_thread(void* arg)
+{
+	stream* s = (stream*)arg;
+
+	while (s->running.load(std::memory_order_acquire)) {
+		prefetch(s);
+
+		timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += c_idle_ns;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_nsec -= 1000000000;
+			++deadline.tv_sec;
+		}
+
+		while (0 != sem_timedwait(&s->wake, &deadline) && errno == EINTR)
+			;
+	}
+
+	return NULL;
+}
+
+static uint32_t read_u32(const uint8_t* p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t read_u16(const uint8_t* p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Locate the PCM data in a RIFF/WAVE file
+static bool parse_wav(stream* s)
+{
+	const uint8_t* p = s->map;
+	const size_t size = s->map_bytes;
+	if (size < 12 || memcmp(p, "RIFF", 4) || memcmp(p + 8, "WAVE", 4))
+		return false;
+
+	int bits = 0, tag = 0;
+	bool have_fmt = false;
+	size_t off = 12;
+	while (off + 8 <= size) {
+		const uint8_t* chunk = p + off;
+		size_t len = read_u32(chunk + 4);
+		off += 8;
+
+		if (!memcmp(chunk, "fmt ", 4) && len >= 16 && off + len <= size) {
+			tag = read_u16(chunk + 8);
+			s->channels = read_u16(chunk + 10);
+			s->sample_rate = (int)read_u32(chunk + 12);
+			bits = read_u16(chunk + 22);
+			if (tag == 0xfffe && len >= 26)
+				tag = read_u16(chunk + 32); // WAVE_FORMAT_EXTENSIBLE sub-format
+			have_fmt = true;
+		} else if (!memcmp(chunk, "data", 4) && have_fmt) {
+			if (len > size - off)
+				len = size - off;
+
+			if (tag == 1 && bits == 16)
+				s->format = stream_s16;
+			else if (tag == 1 && bits == 24)
+				s->format = stream_s24;
+			else if (tag == 3 && bits == 32)
+				s->format = stream_float;
+			else
+				return false;
+
+			s->data_offset = off;
+			s->frame_bytes = s->channels * (bits / 8);
+			s->nframes = (s->channels == 1 || s->channels == 2) ? len / s->frame_bytes : 0;
+			return s->nframes != 0;
+		}
+
+		off += len + (len & 1);
+	}
+
+	return false;
+}
+
+static stream* open_stream(const char* path, bool raw, int channels, stream_sample format, int period_frames, int readahead_periods)
+{
+	const int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	struct stat st;
+	if (0 != fstat(fd, &st) || st.st_size <= 0) {
+		close(fd);
+		return NULL;
+	}
+
+	void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+
+	void* mem = allocate(sizeof(stream));
+	if (!mem) {
+		munmap(map, (size_t)st.st_size);
+		return NULL;
+	}
+
+	stream* s = new (mem) stream();
+	s->map = (const uint8_t*)map;
+	s->map_bytes = (size_t)st.st_size;
+
+	bool valid;
+	if (raw) {
+		static const int sizes[] = { 2, 3, 4 };
+		s->channels = channels;
+		s->format = format;
+		s->sample_rate = 0;
+		s->data_offset = 0;
+		valid = (channels == 1 || channels == 2) && format >= stream_s16 && format <= stream_float;
+		if (valid) {
+			s->frame_bytes = channels * sizes[format];
+			s->nframes = s->map_bytes / s->frame_bytes;
+			valid = s->nframes != 0;
+		}
+	} else {
+		valid = parse_wav(s);
+	}
+
+	if (!valid || period_frames <= 0 || readahead_periods <= 0) {
+		munmap(map, s->map_bytes);
+		s->~stream();
+		deallocate(mem, sizeof(stream));
+		return NULL;
+	}
+
+	madvise(map, s->map_bytes, MADV_SEQUENTIAL);
+
+	s->readahead = (uint64_t)period_frames * readahead_periods;
+	s->pos = 0;
+	s->gen = 0;
+	s->seeks_seen = 0;
+	s->seek_end_frame = 0;
+	s->cursor.store(0);
+	s->resident.store(0);
+	s->head_frames.store(0);
+	s->seek_target.store(0);
+	s->seek_ready.store(0);
+	s->seeks.store(0);
+	s->seeks_applied.store(0);
+	s->starved.store(0);
+	s->loop.store(false);
+	s->lock_begin = s->lock_end = 0;
+	s->head_end = 0;
+	s->seek_begin = s->seek_end = 0;
+	s->seeks_done = 0;
+	s->seek_pending = false;
+	s->can_lock = 0 == (memory_settings()->flags & buffer_no_lock);
+
+	// fill the first window before returning so playback starts clean
+	prefetch(s);
+
+	sem_init(&s->wake, 0, 0);
+	s->running.store(true);
+	pthread_create(&s->thread, NULL, &prefetch_thread, s);
+	return s;
+}
+
+stream* stream_open(const char* path, int period_frames, int readahead_periods)
+{
+	return open_stream(path, false, 0, stream_s16, period_frames, readahead_periods);
+}
+
+stream* stream_open_raw(const char* path, int channels, stream_sample format, int period_frames, int readahead_periods)
+{
+	if (format < stream_s16 || format > stream_float)
+		return NULL;
+
+	return open_stream(path, true, channels, format, period_frames, readahead_periods);
+}
+
+void stream_close(stream* s)
+{
+	if (!s)
+		return;
+
+	s->running.store(false, std::memory_order_release);
+	sem_post(&s->wake);
+	pthread_join(s->thread, NULL);
+	sem_destroy(&s->wake);
+
+	munmap((void*)s->map, s->map_bytes);
+	s->~stream();
+	deallocate(s, sizeof(stream));
+}
+
+int stream_sample_rate(const stream* s)
+{
+	return s->sample_rate;
+}
+
+// Audio thread: pick up a pending seek, wrap at the end when looping
+static void advance_cursor(stream* s)
+{
+	const uint64_t ready = s->seek_ready.load(std::memory_order_acquire);
+	const unsigned seeks = (unsigned)(ready >> c_ngenshift);
+	if (seeks != s->seeks_seen) {
+		s->seeks_seen = seeks;
+		s->pos = ready & c_framemask;
+		s->seek_end_frame = s->pos + s->readahead;
+		s->seeks_applied.store(seeks, std::memory_order_relaxed);
+		++s->gen;
+	}
+
+	if (s->pos == s->nframes && s->loop.load(std::memory_order_relaxed)) {
+		s->pos = 0;
+		s->seek_end_frame = 0;
+		++s->gen;
+	}
+}
+
+// Frames from the cursor the prefetch thread has made resident
+static uint64_t resident_frames(const stream* s)
+{
+	const uint64_t resident = s->resident.load(std::memory_order_acquire);
+	uint64_t end = 0;
+	if ((unsigned)(resident >> c_ngenshift) == (s->gen & c_genmask))
+		end = resident & c_framemask;
+
+	const uint64_t head = s->head_frames.load(std::memory_order_acquire);
+	if (s->pos < head && head > end)
+		end = head;
+	if (s->seek_end_frame > end)
+		end = s->seek_end_frame;
+
+	if (end > s->nframes)
+		end = s->nframes;
+	return (end > s->pos) ? end - s->pos : 0;
+}
+
+static void publish_cursor(stream* s)
+{
+	s->cursor.store(pack(s->gen, s->pos), std::memory_order_release);
+	sem_post(&s->wake);
+}
+
+static float decode(const stream* s, const uint8_t* p)
+{
+	switch (s->format) {
+	case stream_s16:
+		return (int16_t)read_u16(p) * (1.0f / 32768.0f);
+	case stream_s24:
+		return (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24)) * (1.0f / 2147483648.0f);
+	default:
+		float f;
+		memcpy(&f, p, sizeof(f));
+		return f;
+	}
+}
+
+static void convert(const stream* s, sample_type* out, uint64_t frame, int n)
+{
+	const uint8_t* src = s->map + frame_offset(s, frame);
+
+	if (s->channels == 2) {
+#if TINYAUDIO_FLOAT_BUS
+		if (s->format == stream_float) {
+			memcpy(out, src, sizeof(float) * 2 * n);
+			return;
+		}
+#else
+		if (s->format == stream_s16) {
+			memcpy(out, src, sizeof(int16_t) * 2 * n);
+			return;
+		}
+		if (s->format == stream_float) {
+			float tmp[2 * c_nconvert];
+			for (int done = 0; done < n; ) {
+				const int m = (n - done < c_nconvert) ? n - done : c_nconvert;
+				memcpy(tmp, src + (size_t)done * s->frame_bytes, sizeof(float) * 2 * m);
+				float_to_bus(tmp, out + done * 2, m * 2);
+				done += m;
+			}
+			return;
+		}
+#endif
+	}
+
+	const int sample_bytes = s->frame_bytes / s->channels;
+	float tmp[2 * c_nconvert];
+	for (int done = 0; done < n; ) {
+		const int m = (n - done < c_nconvert) ? n - done : c_nconvert;
+		const uint8_t* p = src + (size_t)done * s->frame_bytes;
+		for (int ii = 0; ii < m; ++ii, p += s->frame_bytes) {
+			tmp[ii * 2 + 0] = decode(s, p);
+			tmp[ii * 2 + 1] = (s->channels == 2) ? decode(s, p + sample_bytes) : tmp[ii * 2 + 0];
+		}
+
+		float_to_bus(tmp, out + done * 2, m * 2);
+		done += m;
+	}
+}
+
+void stream_render(stream* s, sample_type* samples, int nframes)
+{
+	int done = 0;
+	while (done < nframes) {
+		advance_cursor(s);
+		if (s->pos == s->nframes)
+			break; // end of file
+
+		uint64_t n = s->nframes - s->pos;
+		const uint64_t resident = resident_frames(s);
+		if (n > resident)
+			n = resident;
+		if (n > (uint64_t)(nframes - done))
+			n = nframes - done;
+
+		if (!n) {
+			s->starved.fetch_add(1, std::memory_order_relaxed);
+			break;
+		}
+
+		convert(s, samples + done * 2, s->pos, (int)n);
+		s->pos += n;
+		done += (int)n;
+	}
+
+	if (done < nframes)
+		memset(samples + done * 2, 0, sizeof(sample_type) * 2 * (nframes - done));
+
+	publish_cursor(s);
+}
+
+int stream_read_span(stream* s, int nframes, const sample_type** span)
+{
+	*span = NULL;
+
+#if TINYAUDIO_FLOAT_BUS
+	const stream_sample bus_format = stream_float;
+#else
+	const stream_sample bus_format = stream_s16;
+#endif
+	if (s->channels != 2 || s->format != bus_format)
+		return 0;
+
+	advance_cursor(s);
+
+	uint64_t n = s->nframes - s->pos;
+	if (n > (uint64_t)nframes)
+		n = nframes;
+	const uint64_t resident = resident_frames(s);
+	if (n > resident) {
+		n = resident;
+		s->starved.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if (n) {
+		*span = (const sample_type*)(s->map + frame_offset(s, s->pos));
+		s->pos += n;
+	}
+
+	publish_cursor(s);
+	return (int)n;
+}
+
+void stream_seek(stream* s, uint64_t frame)
+{
+	s->seek_target.store(frame, std::memory_order_relaxed);
+	s->seeks.fetch_add(1, std::memory_order_release);
+	sem_post(&s->wake);
+}
+
+void stream_set_loop(stream* s, bool loop)
+{
+	s->loop.store(loop, std::memory_order_relaxed);
+	sem_post(&s->wake);
+}
+
+uint64_t stream_position(const stream* s)
+{
+	return s->cursor.load(std::memory_order_relaxed) & c_framemask;
+}
+
+uint64_t stream_length(const stream* s)
+{
+	return s->nframes;
+}
+
+unsigned stream_starved(const stream* s)
+{
+	return s->starved.load(std::memory_order_relaxed);
+}
+
+}
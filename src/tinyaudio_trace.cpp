@@ -0,0 +1,256 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(TINYAUDIO_TRACE)
+#	define TINYAUDIO_TRACE 1
+#endif
+
+#include "TINYAUDIO/tinyaudio_memory.h"
+#include "TINYAUDIO/tinyaudio_trace.h"
+
+#if TINYAUDIO_TRACE
+
+#include <atomic>
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace tinyaudio {
+
+static const int c_nthreads = 16;
+static const uint32_t c_nevents = 8192; // per thread, power of two
+
+struct TraceEvent {
+	const char* name;
+	uint64_t ts;
+	uint64_t dur;
+	char phase;
+};
+
+struct TraceRing {
+	std::atomic<uint32_t> head;
+	long tid;
+	std::atomic<const char*> name;
+	std::atomic<bool> owned; // by a live thread
+};
+
+static TraceRing g_rings[c_nthreads];
+static buffer_pool g_pool; // one block of c_nevents per ring
+static std::atomic<bool> g_allocated;
+static std::atomic<int> g_nrings; // rings ever handed out
+static std::atomic<bool> g_enabled;
+static thread_local TraceRing* t_ring;
+static pthread_once_t g_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_key; // gives a thread's ring back when it exits
+
+static uint64_t trace_now()
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void release_ring(void* ring)
+{
+	((TraceRing*)ring)->owned.store(false, std::memory_order_release);
+}
+
+static void create_key()
+{
+	pthread_key_create(&g_key, &release_ring);
+}
+
+// A new thread takes a ring no thread has used yet while there are any,
+// so older history survives as long as possible, then one given back by
+// an exited thread
+static TraceRing* claim_ring()
+{
+	const int index = g_nrings.fetch_add(1, std::memory_order_relaxed);
+	if (index < c_nthreads) {
+		g_rings[index].owned.store(true, std::memory_order_relaxed);
+		return &g_rings[index];
+	}
+	g_nrings.fetch_sub(1, std::memory_order_relaxed);
+
+	for (int ii = 0; ii < c_nthreads; ++ii) {
+		bool owned = false;
+		if (g_rings[ii].owned.compare_exchange_strong(owned, true, std::memory_order_acquire)) {
+			g_rings[ii].name.store(0, std::memory_order_relaxed);
+			g_rings[ii].head.store(0, std::memory_order_release);
+			return &g_rings[ii];
+		}
+	}
+
+	return 0;
+}
+
+static TraceRing* trace_ring()
+{
+	TraceRing* ring = t_ring;
+	if (!ring) {
+		ring = claim_ring();
+		if (!ring)
+			return 0;
+
+		ring->tid = (long)syscall(SYS_gettid);
+		pthread_once(&g_key_once, &create_key);
+		pthread_setspecific(g_key, ring);
+		t_ring = ring;
+	}
+
+	return ring;
+}
+
+static void trace_record(const char* name, uint64_t ts, uint64_t dur, char phase)
+{
+	TraceRing* ring = trace_ring();
+	if (!ring || !g_allocated.load(std::memory_order_acquire))
+		return;
+
+	TraceEvent* events = (TraceEvent*)pool_block(&g_pool, (int)(ring - g_rings));
+	const uint32_t head = ring->head.load(std::memory_order_relaxed);
+	TraceEvent* ev = &events[head & (c_nevents - 1)];
+	ev->name = name;
+	ev->ts = ts;
+	ev->dur = dur;
+	ev->phase = phase;
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+void trace_enable(bool enable)
+{
+	// the rings are allocated (and pre-faulted) once, on first use, and
+	// kept for the life of the process
+	if (enable && !g_allocated.load(std::memory_order_relaxed)) {
+		if (!pool_create(&g_pool, sizeof(TraceEvent) * c_nevents, c_nthreads))
+			return;
+		g_allocated.store(true, std::memory_order_release);
+	}
+
+	g_enabled.store(enable, std::memory_order_relaxed);
+}
+
+uint64_t trace_begin()
+{
+	if (!g_enabled.load(std::memory_order_relaxed))
+		return 0;
+	return trace_now();
+}
+
+void trace_end(const char* name, uint64_t begin)
+{
+	if (!begin)
+		return;
+	trace_record(name, begin, trace_now() - begin, 'X');
+}
+
+void trace_marker(const char* name)
+{
+	if (!g_enabled.load(std::memory_order_relaxed))
+		return;
+	trace_record(name, trace_now(), 0, 'i');
+}
+
+void trace_thread_name(const char* name)
+{
+	TraceRing* ring = trace_ring();
+	if (ring)
+		ring->name.store(name, std::memory_order_release);
+}
+
+// Names are plain C strings; keep quotes, backslashes and control
+// characters from breaking the JSON
+static void write_json_string(FILE* fp, const char* str)
+{
+	fputc('"', fp);
+	for (; *str; ++str) {
+		const unsigned char c = (unsigned char)*str;
+		if (c == '"' || c == '\\')
+			fprintf(fp, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(fp, "\\u%04x", c);
+		else
+			fputc(c, fp);
+	}
+	fputc('"', fp);
+}
+
+bool trace_dump(const char* path)
+{
+	FILE* fp = fopen(path, "w");
+	if (!fp)
+		return false;
+
+	const long pid = (long)getpid();
+	const char* separator = "";
+	fprintf(fp, "{\"traceEvents\":[");
+
+	const int nrings = g_allocated.load(std::memory_order_acquire) ? g_nrings.load(std::memory_order_acquire) : 0;
+	for (int ii = 0; ii < nrings; ++ii) {
+		TraceRing* ring = &g_rings[ii];
+		const TraceEvent* events = (const TraceEvent*)pool_block(&g_pool, ii);
+
+		const char* name = ring->name.load(std::memory_order_acquire);
+		if (name) {
+			fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":",
+				separator, pid, ring->tid);
+			write_json_string(fp, name);
+			fprintf(fp, "}}");
+			separator = ",";
+		}
+
+		const uint32_t head = ring->head.load(std::memory_order_acquire);
+		const uint32_t first = (head > c_nevents) ? head - c_nevents : 0;
+		for (uint32_t jj = first; jj != head; ++jj) {
+			const TraceEvent ev = events[jj & (c_nevents - 1)];
+
+			// the owning thread may have lapped us while we were copying
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (ring->head.load(std::memory_order_relaxed) - jj >= c_nevents)
+				continue;
+
+			fprintf(fp, "%s\n{\"name\":", separator);
+			write_json_string(fp, ev.name);
+			if (ev.phase == 'X') {
+				fprintf(fp, ",\"cat\":\"tinyaudio\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%ld}",
+					ev.ts / 1000.0, ev.dur / 1000.0, pid, ring->tid);
+			} else {
+				fprintf(fp, ",\"cat\":\"tinyaudio\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%ld,\"tid\":%ld}",
+					ev.ts / 1000.0, pid, ring->tid);
+			}
+			separator = ",";
+		}
+	}
+
+	fprintf(fp, "\n],\"displayTimeUnit\":\"ns\"}\n");
+	return 0 == fclose(fp);
+}
+
+}
+
+#endif
@@ -0,0 +1,205 @@
+/*-
+ * Copyright 2011-2013 Matthew Endsley
+ * All rights reserved
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted providing that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TINYAUDIO/tinyaudio_verify.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace tinyaudio {
+
+// Silence this long inside the signal is a dropout. A sine above a few tens
+// of Hz never stays this close to zero for more than a sample or two.
+static const int c_dropout_frames = 4;
+
+// Good predictions needed before the phase counts as followed again
+static const int c_lock_frames = 4;
+
+// A block is a duplicate if it matches any of this many before it and the
+// signal jumps where it starts. A steady tone with a whole number of cycles
+// per block matches earlier blocks too, but runs on without a jump.
+static const int c_duplicate_lookback = 4;
+
+#if TINYAUDIO_FLOAT_BUS
+static const float c_quantum = 1.0e-6f;
+static inline float left(const sample_type* samples, int frame) { return samples[frame * 2]; }
+#else
+static const float c_quantum = 3.0f / 32768.0f; // rounding of three samples
+static inline float left(const sample_type* samples, int frame) { return samples[frame * 2] * (1.0f / 32768.0f); }
+#endif
+
+static bool duplicated(const sample_type* samples, const loopback_block* blocks, int index)
+{
+	const loopback_block* b = &blocks[index];
+	for (int ii = 1; ii <= c_duplicate_lookback && ii <= index; ++ii) {
+		const loopback_block* prev = &blocks[index - ii];
+		if (prev->nframes == b->nframes && 0 == memcmp(samples + prev->frame * 2, samples + b->frame * 2, sizeof(sample_type) * 2 * b->nframes))
+			return true;
+	}
+
+	return false;
+}
+
+static void report_error(verify_sine_report* report, int frame)
+{
+	if (report->first_error < 0)
+		report->first_error = frame;
+}
+
+void verify_sine(const sample_type* samples, int nframes, float frequency, int sample_rate,
+	const loopback_block* blocks, int nblocks, verify_sine_report* report)
+{
+	memset(report, 0, sizeof(*report));
+	report->frames = nframes;
+	report->first_error = -1;
+
+	float amplitude = 0.0f;
+	for (int ii = 0; ii < nframes; ++ii)
+		amplitude = std::max(amplitude, fabsf(left(samples, ii)));
+	if (amplitude == 0.0f)
+		return;
+
+	// a sine obeys x[n] = 2cos(w) x[n-1] - x[n-2] whatever its phase and
+	// amplitude, so each sample is predicted from the two before it
+	const float c2 = 2.0f * cosf(6.283185307f * frequency / (float)sample_rate);
+	const float tolerance = amplitude * 0.002f + c_quantum;
+
+	float x1 = 0.0f, x2 = 0.0f;
+	int history = 0;
+	int good = 0;
+	bool locked = false;
+	bool seen_signal = false;
+	bool in_dropout = false;
+	int silence = 0;
+	int block = 0;
+	int expect_jump = 0; // frames left in which a duplicate's jump is excused
+	int jump_out = -1; // end of the last duplicate, where the signal jumps back
+	int pending = -1; // a jump onto silence, unless the silence turns out to be a dropout
+
+	for (int n = 0; n < nframes; ++n) {
+		const float x = left(samples, n);
+
+		if (blocks && block < nblocks && (int)blocks[block].frame == n) {
+			const bool jumped = history >= 2 && fabsf(x - (c2 * x1 - x2)) > tolerance;
+			if (jumped && duplicated(samples, blocks, block)) {
+				++report->duplicated_blocks;
+				report_error(report, n);
+				expect_jump = 2;
+				jump_out = n + blocks[block].nframes;
+			}
+			++block;
+		}
+		if (n == jump_out)
+			expect_jump = 2;
+
+		if (fabsf(x) <= tolerance) {
+			if (++silence == c_dropout_frames && seen_signal) {
+				++report->dropouts;
+				report_error(report, n - silence + 1);
+				in_dropout = true;
+				pending = -1;
+			}
+		} else {
+			if (pending >= 0) {
+				++report->discontinuities;
+				report_error(report, pending);
+				pending = -1;
+			}
+			if (in_dropout) {
+				report->dropout_frames += silence;
+				in_dropout = false;
+				history = 0;
+				good = 0;
+				locked = false;
+			}
+			silence = 0;
+			seen_signal = true;
+		}
+
+		if (in_dropout)
+			continue;
+
+		if (history >= 2) {
+			if (fabsf(x - (c2 * x1 - x2)) > tolerance) {
+				if (locked && !expect_jump && silence) {
+					pending = n;
+				} else if (locked && !expect_jump) {
+					++report->discontinuities;
+					report_error(report, n);
+				}
+				locked = false;
+				good = 0;
+				history = 0;
+			} else if (++good >= c_lock_frames) {
+				locked = true;
+			}
+		}
+
+		if (expect_jump)
+			--expect_jump;
+
+		x2 = x1;
+		x1 = x;
+		if (history < 2)
+			++history;
+	}
+
+	if (in_dropout)
+		report->dropout_frames += silence;
+	if (pending >= 0) {
+		++report->discontinuities;
+		report_error(report, pending);
+	}
+}
+
+void verify_latency(const loopback_block* blocks, int nblocks, verify_latency_report* report)
+{
+	memset(report, 0, sizeof(*report));
+	if (nblocks <= 0)
+		return;
+
+	double* latency = (double*)malloc(sizeof(double) * nblocks);
+	if (!latency)
+		return;
+
+	double sum = 0.0;
+	for (int ii = 0; ii < nblocks; ++ii) {
+		latency[ii] = ((double)blocks[ii].output_ns - (double)blocks[ii].callback_ns) / 1e3;
+		sum += latency[ii];
+	}
+
+	std::sort(latency, latency + nblocks);
+	report->blocks = nblocks;
+	report->min_us = latency[0];
+	report->mean_us = sum / nblocks;
+	report->p99_us = latency[(nblocks - 1) * 99 / 100];
+	report->max_us = latency[nblocks - 1];
+	free(latency);
+}
+
+}
@@ -25,6 +25,7 @@
  */
 
 #include "TINYAUDIO/tinyaudio.h"
+#include "TINYAUDIO/tinyaudio_memory.h"
 #if !defined(_CRT_SECURE_NO_WARNINGS)
 #	define _CRT_SECURE_NO_WARNINGS
 #endif
@@ -43,7 +44,7 @@ struct XAudioMixer : IXAudio2VoiceCallback
 	HANDLE m_thread;
 	samples_callback m_callback;
 	IXAudio2SourceVoice* m_voice;
-	sample_type m_packets[c_npackets][c_nsamples * 2];
+	buffer_pool m_packets;
 
 	void fill_buffer(sample_type* sample_data)
 	{
@@ -76,7 +77,7 @@ struct XAudioMixer : IXAudio2VoiceCallback
 			}
 
 			// submit a buffer
-			mixer->fill_buffer(mixer->m_packets[currentBuffer % c_npackets]);
+			mixer->fill_buffer((sample_type*)pool_block(&mixer->m_packets, currentBuffer % c_npackets));
 			++currentBuffer;
 		}
 
@@ -88,6 +89,7 @@ struct XAudioMixer : IXAudio2VoiceCallback
 		m_bufferEndEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
 		m_shutdownEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
 		m_thread = NULL;
+		m_packets.base = NULL;
 	}
 
 	virtual ~XAudioMixer()
@@ -100,6 +102,7 @@ struct XAudioMixer : IXAudio2VoiceCallback
 		CloseHandle(m_shutdownEvent);
 		CloseHandle(m_thread);
 		CloseHandle(m_bufferEndEvent);
+		pool_destroy(&m_packets);
 	}
 
 	virtual void CALLBACK OnBufferEnd(void* context)
@@ -224,6 +227,11 @@ bool init(int sample_rate, samples_callback callback)
 	g_mixer.m_voice->Discontinuity();
 	g_mixer.m_voice->Start();
 
+	if (!g_mixer.m_packets.base && !pool_create(&g_mixer.m_packets, sizeof(sample_type) * c_nsamples * 2, c_npackets)) {
+		_snprintf(g_lasterror, c_nlasterror, "failed to allocate packet buffers");
+		goto error;
+	}
+
 	g_mixer.m_callback = callback;
 	g_mixer.seed_buffers();
 